@@ -15,6 +15,17 @@ namespace jaffarPlus
 namespace emulator
 {
 
+/**
+ * The core instance, with its frame advance from already parsed controller codes made reachable, so that registered
+ * inputs are not parsed again every frame
+ */
+class A2600HawkInstance final : public libA2600Hawk::EmuInstance
+{
+  public:
+
+  using libA2600Hawk::EmuInstance::advanceStateImpl;
+};
+
 class Atari2600Hawk final : public Emulator
 {
   public:
@@ -53,19 +64,14 @@ class Atari2600Hawk final : public Emulator
     _Atari2600Hawk.initialize();
     _mutex.unlock();
 
-    // Setting controller types
+    // Setting controller types, both in the core and in the parser used to decode registered inputs
     _Atari2600Hawk.setController1Type(_controller1Type);
     _Atari2600Hawk.setController2Type(_controller2Type);
+    _inputParser.setController1Type(getControllerType(_controller1Type));
+    _inputParser.setController2Type(getControllerType(_controller2Type));
 
-    // Reading from ROM file
-    std::string romFileData;
-    bool        status = jaffarCommon::file::loadStringFromFile(romFileData, _romFilePath.c_str());
-    if (status == false) JAFFAR_THROW_LOGIC("Could not find/read from ROM file: %s\n", _romFilePath.c_str());
-
-    // Getting SHA1 of ROM for checksum
-    auto actualRomSHA1 = jaffarCommon::hash::getSHA1String(romFileData);
-    if (_romFileSHA1 != actualRomSHA1)
-      JAFFAR_THROW_LOGIC("ROM file: '%s' expected SHA1 ('%s') does not concide with the one read ('%s')\n", _romFilePath.c_str(), _romFileSHA1.c_str(), actualRomSHA1.c_str());
+    // Verifying the ROM file SHA1 (only done once for all emulator instances). The core loads the ROM from its path
+    loadRomFile(_romFilePath, _romFileSHA1);
 
     // Loading rom into emulator
     _Atari2600Hawk.loadROM(_romFilePath);
@@ -78,9 +84,19 @@ class Atari2600Hawk final : public Emulator
   void advanceState(const std::string &input) override
   {
     _Atari2600Hawk.advanceState(input);
+    updateWorkRam();
+  }
 
-    // Retreiving workram
-    for (size_t i = 0; i < 128; i++) _workRam[i] = _Atari2600Hawk.getWorkRamByte(i);
+  // State advancing function (fast path), running a frame directly with the controller codes decoded at registration
+  __INLINE__ void advanceStateDecoded(const inputHandle_t inputHandle) override
+  {
+    const auto &decodedInput = _decodedInputs[inputHandle];
+
+    // Inputs pressing console buttons (reset, power) are left to the core
+    if (decodedInput.pressesConsoleButtons == true) return advanceState(getRegisteredInput(inputHandle));
+
+    _Atari2600Hawk.advanceStateImpl(decodedInput.controller1Code, decodedInput.controller2Code);
+    updateWorkRam();
   }
 
   __INLINE__ void serializeState(jaffarCommon::serializer::Base &serializer) const override
@@ -146,12 +162,55 @@ class Atari2600Hawk final : public Emulator
 
   __INLINE__ void showRender() override { _Atari2600Hawk.updateRenderer(); }
 
+  protected:
+
+  // Decodes a newly registered input with the core's own parser, so that advancing with it does not parse it again
+  void registerInputImpl(const inputHandle_t inputHandle, const std::string &input) override
+  {
+    bool isInputValid = _inputParser.parseInputString(input);
+    if (isInputValid == false) JAFFAR_THROW_LOGIC("Input provided cannot be parsed by '%s': '%s'\n", getName().c_str(), input.c_str());
+
+    _decodedInputs.resize(inputHandle + 1);
+    _decodedInputs[inputHandle].controller1Code       = _inputParser.getController1Code();
+    _decodedInputs[inputHandle].controller2Code       = _inputParser.getController2Code();
+    _decodedInputs[inputHandle].pressesConsoleButtons = _inputParser.getPowerButtonState() || _inputParser.getResetButtonState();
+  }
+
   private:
 
+  // Retrieves the work RAM from the core, after a frame is run
+  __INLINE__ void updateWorkRam()
+  {
+    for (size_t i = 0; i < 128; i++) _workRam[i] = _Atari2600Hawk.getWorkRamByte(i);
+  }
+
+  // Gets the core's controller type for the given configured name
+  static libA2600Hawk::Controller::controller_t getControllerType(const std::string &type)
+  {
+    if (type == "None") return libA2600Hawk::Controller::controller_t::none;
+    if (type == "Gamepad") return libA2600Hawk::Controller::controller_t::gamepad;
+
+    JAFFAR_THROW_LOGIC("Controller type not recognized: '%s'\n", type.c_str());
+  }
+
   // Collection of state blocks to disable during engine run
   std::vector<std::string> _disabledStateProperties;
 
-  libA2600Hawk::EmuInstance _Atari2600Hawk;
+  A2600HawkInstance _Atari2600Hawk;
+
+  // Input parser, set up as the core's, to decode the registered inputs
+  libA2600Hawk::Controller _inputParser;
+
+  // A registered input, as the core's controller codes
+  struct decodedInput_t
+  {
+    libA2600Hawk::Controller::port_t controller1Code;
+    libA2600Hawk::Controller::port_t controller2Code;
+    bool                             pressesConsoleButtons;
+  };
+
+  // Registered inputs, indexed by their handle
+  std::vector<decodedInput_t> _decodedInputs;
 
   std::string _controller1Type;
   std::string _controller2Type;
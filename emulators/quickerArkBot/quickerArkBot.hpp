@@ -15,6 +15,18 @@ namespace jaffarPlus
 namespace emulator
 {
 
+/**
+ * The core instance, with its frame advance from already parsed controller codes made reachable, so that registered
+ * inputs are not parsed again every frame
+ */
+class ArkBotInstance final : public ark::EmuInstance
+{
+  public:
+
+  using ark::EmuInstance::EmuInstance;
+  using ark::EmuInstance::advanceStateImpl;
+};
+
 class QuickerArkBot final : public Emulator
 {
   public:
@@ -47,16 +59,18 @@ class QuickerArkBot final : public Emulator
 #endif
 
     // Allocating emulator
-    _quickerArkBot = new ark::EmuInstance(_initialLevel, _initialScore, isVerify);
+    _quickerArkBot = new ArkBotInstance(_initialLevel, _initialScore, isVerify);
   };
 
   ~QuickerArkBot() { delete _quickerArkBot; }
 
   void initializeImpl() override
   {
-    // Setting controller types
+    // Setting controller types, both in the core and in the parser used to decode registered inputs
     _quickerArkBot->setController1Type(_controller1Type);
     _quickerArkBot->setController2Type(_controller2Type);
+    _inputParser.setController1Type(getControllerType(_controller1Type));
+    _inputParser.setController2Type(getControllerType(_controller2Type));
 
     // Initializing emulator
     _quickerArkBot->initialize(_romFilePath);
@@ -65,6 +79,17 @@ class QuickerArkBot final : public Emulator
   // State advancing function
   void advanceState(const std::string &input) override { _quickerArkBot->advanceState(input); }
 
+  // State advancing function (fast path), running a frame directly with the controller codes decoded at registration
+  __INLINE__ void advanceStateDecoded(const inputHandle_t inputHandle) override
+  {
+    const auto &decodedInput = _decodedInputs[inputHandle];
+
+    // Inputs pressing console buttons (reset, power) are left to the core
+    if (decodedInput.pressesConsoleButtons == true) return advanceState(getRegisteredInput(inputHandle));
+
+    _quickerArkBot->advanceStateImpl(decodedInput.controller1Code, decodedInput.controller2Code);
+  }
+
   __INLINE__ void serializeState(jaffarCommon::serializer::Base &serializer) const override { _quickerArkBot->serializeState(serializer); };
 
   __INLINE__ void deserializeState(jaffarCommon::deserializer::Base &deserializer) override { _quickerArkBot->deserializeState(deserializer); };
@@ -125,14 +150,52 @@ class QuickerArkBot final : public Emulator
 
   __INLINE__ void showRender() override { _quickerArkBot->updateRenderer(); }
 
+  protected:
+
+  // Decodes a newly registered input with the core's own parser, so that advancing with it does not parse it again
+  void registerInputImpl(const inputHandle_t inputHandle, const std::string &input) override
+  {
+    bool isInputValid = _inputParser.parseInputString(input);
+    if (isInputValid == false) JAFFAR_THROW_LOGIC("Input provided cannot be parsed by '%s': '%s'\n", getName().c_str(), input.c_str());
+
+    _decodedInputs.resize(inputHandle + 1);
+    _decodedInputs[inputHandle].controller1Code       = _inputParser.getController1Code();
+    _decodedInputs[inputHandle].controller2Code       = _inputParser.getController2Code();
+    _decodedInputs[inputHandle].pressesConsoleButtons = _inputParser.getPowerButtonState() || _inputParser.getResetButtonState();
+  }
+
   private:
 
-  ark::EmuInstance *_quickerArkBot;
-  std::string       _romFilePath = "";
-  uint8_t           _initialLevel;
-  uint32_t          _initialScore;
-  std::string       _controller1Type;
-  std::string       _controller2Type;
+  // Gets the core's controller type for the given configured name
+  static ark::Controller::controller_t getControllerType(const std::string &type)
+  {
+    if (type == "None") return ark::Controller::controller_t::none;
+    if (type == "Arkanoid") return ark::Controller::controller_t::arkanoid;
+
+    JAFFAR_THROW_LOGIC("Controller type not recognized: '%s'\n", type.c_str());
+  }
+
+  ArkBotInstance *_quickerArkBot;
+
+  // Input parser, set up as the core's, to decode the registered inputs
+  ark::Controller _inputParser;
+
+  // A registered input, as the core's controller codes
+  struct decodedInput_t
+  {
+    ark::Controller::port_t controller1Code;
+    ark::Controller::port_t controller2Code;
+    bool                    pressesConsoleButtons;
+  };
+
+  // Registered inputs, indexed by their handle
+  std::vector<decodedInput_t> _decodedInputs;
+
+  std::string _romFilePath = "";
+  uint8_t     _initialLevel;
+  uint32_t    _initialScore;
+  std::string _controller1Type;
+  std::string _controller2Type;
 };
 
 } // namespace emulator
@@ -14,6 +14,17 @@ namespace jaffarPlus
 namespace emulator
 {
 
+/**
+ * The core instance, with its frame advance from already parsed controller codes made reachable, so that registered
+ * inputs are not parsed again every frame
+ */
+class GPGXInstance final : public gpgx::EmuInstance
+{
+  public:
+
+  using gpgx::EmuInstance::advanceStateImpl;
+};
+
 class QuickerGPGX final : public Emulator
 {
   public:
@@ -53,19 +64,14 @@ class QuickerGPGX final : public Emulator
     // Initializing emulator
     _quickerGPGX.initialize();
 
-    // Setting controller types
+    // Setting controller types, both in the core and in the parser used to decode registered inputs
     _quickerGPGX.setController1Type(_controller1Type);
     _quickerGPGX.setController2Type(_controller2Type);
+    _inputParser.setController1Type(getControllerType(_controller1Type));
+    _inputParser.setController2Type(getControllerType(_controller2Type));
 
-    // Reading from ROM file
-    std::string romFileData;
-    bool        status = jaffarCommon::file::loadStringFromFile(romFileData, _romFilePath.c_str());
-    if (status == false) JAFFAR_THROW_LOGIC("Could not find/read from ROM file: %s\n", _romFilePath.c_str());
-
-    // Getting SHA1 of ROM for checksum
-    auto actualRomSHA1 = jaffarCommon::hash::getSHA1String(romFileData);
-    if (_romFileSHA1 != actualRomSHA1)
-      JAFFAR_THROW_LOGIC("ROM file: '%s' expected SHA1 ('%s') does not concide with the one read ('%s')\n", _romFilePath.c_str(), _romFileSHA1.c_str(), actualRomSHA1.c_str());
+    // Verifying the ROM file SHA1 (only done once for all emulator instances). The core loads the ROM from its path
+    loadRomFile(_romFilePath, _romFileSHA1);
 
     // Loading rom into emulator
     _quickerGPGX.loadROM(_romFilePath);
@@ -91,6 +97,17 @@ class QuickerGPGX final : public Emulator
   // State advancing function
   void advanceState(const std::string &input) override { _quickerGPGX.advanceState(input); }
 
+  // State advancing function (fast path), running a frame directly with the controller codes decoded at registration
+  __INLINE__ void advanceStateDecoded(const inputHandle_t inputHandle) override
+  {
+    const auto &decodedInput = _decodedInputs[inputHandle];
+
+    // Inputs pressing console buttons (reset, power) are left to the core
+    if (decodedInput.pressesConsoleButtons == true) return advanceState(getRegisteredInput(inputHandle));
+
+    _quickerGPGX.advanceStateImpl(decodedInput.controller1Code, decodedInput.controller2Code);
+  }
+
   __INLINE__ void serializeState(jaffarCommon::serializer::Base &serializer) const override { _quickerGPGX.serializeState(serializer); };
 
   __INLINE__ void deserializeState(jaffarCommon::deserializer::Base &deserializer) override { _quickerGPGX.deserializeState(deserializer); };
@@ -137,12 +154,50 @@ class QuickerGPGX final : public Emulator
 
   __INLINE__ void showRender() override { _quickerGPGX.updateRenderer(); }
 
+  protected:
+
+  // Decodes a newly registered input with the core's own parser, so that advancing with it does not parse it again
+  void registerInputImpl(const inputHandle_t inputHandle, const std::string &input) override
+  {
+    bool isInputValid = _inputParser.parseInputString(input);
+    if (isInputValid == false) JAFFAR_THROW_LOGIC("Input provided cannot be parsed by '%s': '%s'\n", getName().c_str(), input.c_str());
+
+    _decodedInputs.resize(inputHandle + 1);
+    _decodedInputs[inputHandle].controller1Code       = _inputParser.getController1Code();
+    _decodedInputs[inputHandle].controller2Code       = _inputParser.getController2Code();
+    _decodedInputs[inputHandle].pressesConsoleButtons = _inputParser.getPowerButtonState() || _inputParser.getResetButtonState();
+  }
+
   private:
 
+  // Gets the core's controller type for the given configured name
+  static gpgx::Controller::controller_t getControllerType(const std::string &type)
+  {
+    if (type == "None") return gpgx::Controller::controller_t::none;
+    if (type == "Gamepad3B") return gpgx::Controller::controller_t::gamepad3b;
+    if (type == "Gamepad6B") return gpgx::Controller::controller_t::gamepad6b;
+
+    JAFFAR_THROW_LOGIC("Controller type not recognized: '%s'\n", type.c_str());
+  }
+
   // Collection of state blocks to disable during engine run
   std::vector<std::string> _disabledStateProperties;
 
-  gpgx::EmuInstance _quickerGPGX;
+  GPGXInstance _quickerGPGX;
+
+  // Input parser, set up as the core's, to decode the registered inputs
+  gpgx::Controller _inputParser;
+
+  // A registered input, as the core's controller codes
+  struct decodedInput_t
+  {
+    gpgx::Controller::port_t controller1Code;
+    gpgx::Controller::port_t controller2Code;
+    bool                     pressesConsoleButtons;
+  };
+
+  // Registered inputs, indexed by their handle
+  std::vector<decodedInput_t> _decodedInputs;
 
   std::string _systemType;
   std::string _controller1Type;
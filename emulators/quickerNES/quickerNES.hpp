@@ -57,22 +57,17 @@ class QuickerNES final : public Emulator
     // Setting game's internal video buffer
     ((emulator_t *)_quickerNES.getInternalEmulatorPointer())->set_pixels(_videoBuffer, DEFAULT_WIDTH + 8);
 
-    // Setting controller types
+    // Setting controller types, both in the core and in the parser used to decode registered inputs
     _quickerNES.setController1Type(_controller1Type);
     _quickerNES.setController2Type(_controller2Type);
+    _inputParser.setController1Type(getControllerType(_controller1Type));
+    _inputParser.setController2Type(getControllerType(_controller2Type));
 
-    // Reading from ROM file
-    std::string romFileData;
-    bool        status = jaffarCommon::file::loadStringFromFile(romFileData, _romFilePath.c_str());
-    if (status == false) JAFFAR_THROW_LOGIC("Could not find/read from ROM file: %s\n", _romFilePath.c_str());
-
-    // Getting SHA1 of ROM for checksum
-    auto actualRomSHA1 = jaffarCommon::hash::getSHA1String(romFileData);
-    if (_romFileSHA1 != actualRomSHA1)
-      JAFFAR_THROW_LOGIC("ROM file: '%s' expected SHA1 ('%s') does not concide with the one read ('%s')\n", _romFilePath.c_str(), _romFileSHA1.c_str(), actualRomSHA1.c_str());
+    // Reading from ROM file and verifying its SHA1 (only done once, the data is shared by all emulator instances)
+    const auto romFileData = loadRomFile(_romFilePath, _romFileSHA1);
 
     // Loading rom into emulator
-    _quickerNES.loadROM((uint8_t *)romFileData.data(), romFileData.size());
+    _quickerNES.loadROM((uint8_t *)romFileData->data(), romFileData->size());
 
     // If initial state file defined, load it
     if (_initialStateFilePath.empty() == false)
@@ -95,6 +90,19 @@ class QuickerNES final : public Emulator
   // State advancing function
   void advanceState(const std::string &input) override { _quickerNES.advanceState(input); }
 
+  // State advancing function (fast path), running a frame directly with the controller codes decoded at registration
+  __INLINE__ void advanceStateDecoded(const inputHandle_t inputHandle) override
+  {
+    const auto &decodedInput = _decodedInputs[inputHandle];
+
+    // Inputs pressing console buttons (reset, power) are left to the core
+    if (decodedInput.pressesConsoleButtons == true) return advanceState(getRegisteredInput(inputHandle));
+
+    auto *emulator = (emulator_t *)_quickerNES.getInternalEmulatorPointer();
+    if (_isRenderingEnabled == true) emulator->emulate_frame(decodedInput.controller1Code, decodedInput.controller2Code);
+    if (_isRenderingEnabled == false) emulator->emulate_skip_frame(decodedInput.controller1Code, decodedInput.controller2Code);
+  }
+
   __INLINE__ void serializeState(jaffarCommon::serializer::Base &serializer) const override { _quickerNES.serializeState(serializer); };
   __INLINE__ void deserializeState(jaffarCommon::deserializer::Base &deserializer) override { _quickerNES.deserializeState(deserializer); };
 
@@ -189,9 +197,17 @@ class QuickerNES final : public Emulator
     if (m_window) SDL_DestroyWindow(m_window);
   }
 
-  __INLINE__ void enableRendering() override { _quickerNES.enableRendering(); }
+  __INLINE__ void enableRendering() override
+  {
+    _quickerNES.enableRendering();
+    _isRenderingEnabled = true;
+  }
 
-  __INLINE__ void disableRendering() override { _quickerNES.disableRendering(); }
+  __INLINE__ void disableRendering() override
+  {
+    _quickerNES.disableRendering();
+    _isRenderingEnabled = false;
+  }
 
   __INLINE__ void updateRendererState(const size_t stepIdx, const std::string input) override
   {
@@ -251,8 +267,33 @@ class QuickerNES final : public Emulator
     SDL_RenderPresent(m_renderer);
   }
 
+  protected:
+
+  // Decodes a newly registered input with the core's own parser, so that advancing with it does not parse it again
+  void registerInputImpl(const inputHandle_t inputHandle, const std::string &input) override
+  {
+    bool isInputValid = _inputParser.parseInputString(input);
+    if (isInputValid == false) JAFFAR_THROW_LOGIC("Input provided cannot be parsed by '%s': '%s'\n", getName().c_str(), input.c_str());
+
+    _decodedInputs.resize(inputHandle + 1);
+    _decodedInputs[inputHandle].controller1Code       = _inputParser.getController1Code();
+    _decodedInputs[inputHandle].controller2Code       = _inputParser.getController2Code();
+    _decodedInputs[inputHandle].pressesConsoleButtons = _inputParser.getPowerButtonState() || _inputParser.getResetButtonState();
+  }
+
   private:
 
+  // Gets the core's controller type for the given configured name
+  static quickNES::Controller::controller_t getControllerType(const std::string &type)
+  {
+    if (type == "None") return quickNES::Controller::controller_t::none;
+    if (type == "Joypad") return quickNES::Controller::controller_t::joypad;
+    if (type == "FourScore1") return quickNES::Controller::controller_t::fourscore1;
+    if (type == "FourScore2") return quickNES::Controller::controller_t::fourscore2;
+
+    JAFFAR_THROW_LOGIC("Controller type not recognized: '%s'\n", type.c_str());
+  }
+
   void printMemoryBlockHash(const std::string &blockName) const
   {
     auto p    = getProperty(blockName);
@@ -262,6 +303,23 @@ class QuickerNES final : public Emulator
 
   NESInstance _quickerNES;
 
+  // Input parser, set up as the core's, to decode the registered inputs
+  quickNES::Controller _inputParser;
+
+  // A registered input, as the core's controller codes
+  struct decodedInput_t
+  {
+    quickNES::Controller::port_t controller1Code;
+    quickNES::Controller::port_t controller2Code;
+    bool                         pressesConsoleButtons;
+  };
+
+  // Registered inputs, indexed by their handle
+  std::vector<decodedInput_t> _decodedInputs;
+
+  // Whether the core renders the frames it runs (it does, until told otherwise)
+  bool _isRenderingEnabled = true;
+
   std::string _controller1Type;
   std::string _controller2Type;
   std::string _romFilePath;
@@ -15,6 +15,17 @@ namespace jaffarPlus
 namespace emulator
 {
 
+/**
+ * The core instance, with its frame advance from already parsed controller codes made reachable, so that registered
+ * inputs are not parsed again every frame
+ */
+class RAWInstance final : public rawspace::EmuInstance
+{
+  public:
+
+  using rawspace::EmuInstance::advanceStateImpl;
+};
+
 class QuickerRAW final : public Emulator
 {
   public:
@@ -60,6 +71,13 @@ class QuickerRAW final : public Emulator
   // State advancing function
   void advanceState(const std::string &input) override { _quickerRAW.advanceState(input); }
 
+  // State advancing function (fast path), running a frame directly with the controller codes decoded at registration
+  __INLINE__ void advanceStateDecoded(const inputHandle_t inputHandle) override
+  {
+    const auto &decodedInput = _decodedInputs[inputHandle];
+    _quickerRAW.advanceStateImpl(decodedInput.controller1Code, decodedInput.controller2Code);
+  }
+
   __INLINE__ void serializeState(jaffarCommon::serializer::Base &serializer) const override { _quickerRAW.serializeState(serializer); };
 
   __INLINE__ void deserializeState(jaffarCommon::deserializer::Base &deserializer) override { _quickerRAW.deserializeState(deserializer); };
@@ -118,12 +136,38 @@ class QuickerRAW final : public Emulator
 
   __INLINE__ void showRender() override { _quickerRAW.updateRenderer(); }
 
+  protected:
+
+  // Decodes a newly registered input with the core's own parser, so that advancing with it does not parse it again
+  void registerInputImpl(const inputHandle_t inputHandle, const std::string &input) override
+  {
+    bool isInputValid = _inputParser.parseInputString(input);
+    if (isInputValid == false) JAFFAR_THROW_LOGIC("Input provided cannot be parsed by '%s': '%s'\n", getName().c_str(), input.c_str());
+
+    _decodedInputs.resize(inputHandle + 1);
+    _decodedInputs[inputHandle].controller1Code = _inputParser.getController1Code();
+    _decodedInputs[inputHandle].controller2Code = _inputParser.getController2Code();
+  }
+
   private:
 
   // Collection of state blocks to disable during engine run
   std::vector<std::string> _disabledStateProperties;
 
-  rawspace::EmuInstance _quickerRAW;
+  RAWInstance _quickerRAW;
+
+  // Input parser, with the core's default controller types, to decode the registered inputs
+  rawspace::Controller _inputParser;
+
+  // A registered input, as the core's controller codes
+  struct decodedInput_t
+  {
+    rawspace::Controller::port_t controller1Code;
+    rawspace::Controller::port_t controller2Code;
+  };
+
+  // Registered inputs, indexed by their handle
+  std::vector<decodedInput_t> _decodedInputs;
 
   std::string _initialStateFilePath;
   std::string _gameDataPath;
@@ -15,6 +15,18 @@ namespace jaffarPlus
 namespace emulator
 {
 
+/**
+ * The core instance, with its frame advance from an already parsed input made reachable, so that registered inputs
+ * are not parsed again every frame
+ */
+class QuickerSDLPoPInstance final : public SDLPoPInstance
+{
+  public:
+
+  using SDLPoPInstance::SDLPoPInstance;
+  using SDLPoPInstance::advanceStateImpl;
+};
+
 class QuickerSDLPoP final : public Emulator
 {
   public:
@@ -25,7 +37,7 @@ class QuickerSDLPoP final : public Emulator
   QuickerSDLPoP(const nlohmann::json &config)
     : Emulator(config)
   {
-    _QuickerSDLPoP = std::make_unique<SDLPoPInstance>(config);
+    _QuickerSDLPoP = std::make_unique<QuickerSDLPoPInstance>(config);
 
     // Getting initial state file path
     _stateFilePath = jaffarCommon::json::getString(config, "Initial State File");
@@ -66,6 +78,9 @@ class QuickerSDLPoP final : public Emulator
   // State advancing function
   void advanceState(const std::string &input) override { _QuickerSDLPoP->advanceState(input); }
 
+  // State advancing function (fast path), running a frame directly with the input decoded at registration
+  __INLINE__ void advanceStateDecoded(const inputHandle_t inputHandle) override { _QuickerSDLPoP->advanceStateImpl(_decodedInputs[inputHandle]); }
+
   __INLINE__ void serializeState(jaffarCommon::serializer::Base &serializer) const override { _QuickerSDLPoP->serializeState(serializer); };
 
   __INLINE__ void deserializeState(jaffarCommon::deserializer::Base &deserializer) override { _QuickerSDLPoP->deserializeState(deserializer); };
@@ -133,9 +148,27 @@ class QuickerSDLPoP final : public Emulator
 
   __INLINE__ void showRender() override { _QuickerSDLPoP->updateRenderer(_renderStepIdx, _renderInput); }
 
+  protected:
+
+  // Decodes a newly registered input with the core's own parser, so that advancing with it does not parse it again
+  void registerInputImpl(const inputHandle_t inputHandle, const std::string &input) override
+  {
+    bool isInputValid = _inputParser.parseInputString(input);
+    if (isInputValid == false) JAFFAR_THROW_LOGIC("Input provided cannot be parsed by '%s': '%s'\n", getName().c_str(), input.c_str());
+
+    _decodedInputs.resize(inputHandle + 1);
+    _decodedInputs[inputHandle] = _inputParser.getParsedInput();
+  }
+
   private:
 
-  std::unique_ptr<SDLPoPInstance> _QuickerSDLPoP;
+  std::unique_ptr<QuickerSDLPoPInstance> _QuickerSDLPoP;
+
+  // Input parser, as the core's, to decode the registered inputs
+  SDLPoP::Controller _inputParser;
+
+  // Registered inputs, as parsed by the core, indexed by their handle
+  std::vector<SDLPoP::Controller::input_t> _decodedInputs;
 
   // initial state file path
   std::string _stateFilePath;
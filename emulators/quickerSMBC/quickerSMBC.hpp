@@ -15,6 +15,17 @@ namespace jaffarPlus
 namespace emulator
 {
 
+/**
+ * The core instance, with its frame advance from already parsed controller codes made reachable, so that registered
+ * inputs are not parsed again every frame
+ */
+class SMBCInstance final : public smbc::EmuInstance
+{
+  public:
+
+  using smbc::EmuInstance::advanceStateImpl;
+};
+
 class QuickerSMBC final : public Emulator
 {
   public:
@@ -56,15 +67,8 @@ class QuickerSMBC final : public Emulator
 // Only load rom file if using player
 #ifdef _JAFFAR_PLAYER
 
-    // Reading from ROM file
-    std::string romFileData;
-    bool        status = jaffarCommon::file::loadStringFromFile(romFileData, _romFilePath.c_str());
-    if (status == false) JAFFAR_THROW_LOGIC("Could not find/read from ROM file: %s\n", _romFilePath.c_str());
-
-    // Getting SHA1 of ROM for checksum
-    auto actualRomSHA1 = jaffarCommon::hash::getSHA1String(romFileData);
-    if (_romFileSHA1 != actualRomSHA1)
-      JAFFAR_THROW_LOGIC("ROM file: '%s' expected SHA1 ('%s') does not concide with the one read ('%s')\n", _romFilePath.c_str(), _romFileSHA1.c_str(), actualRomSHA1.c_str());
+    // Verifying the ROM file SHA1 (only done once for all emulator instances). The core loads the ROM from its path
+    loadRomFile(_romFilePath, _romFileSHA1);
 
 #endif
 
@@ -91,6 +95,17 @@ class QuickerSMBC final : public Emulator
   // State advancing function
   void advanceState(const std::string &input) override { _quickerSMBC.advanceState(input); }
 
+  // State advancing function (fast path), running a frame directly with the controller codes decoded at registration
+  __INLINE__ void advanceStateDecoded(const inputHandle_t inputHandle) override
+  {
+    const auto &decodedInput = _decodedInputs[inputHandle];
+
+    // Inputs pressing console buttons (reset, power) are left to the core
+    if (decodedInput.pressesConsoleButtons == true) return advanceState(getRegisteredInput(inputHandle));
+
+    _quickerSMBC.advanceStateImpl(decodedInput.controller1Code, decodedInput.controller2Code);
+  }
+
   __INLINE__ void serializeState(jaffarCommon::serializer::Base &serializer) const override { _quickerSMBC.serializeState(serializer); };
 
   __INLINE__ void deserializeState(jaffarCommon::deserializer::Base &deserializer) override { _quickerSMBC.deserializeState(deserializer); };
@@ -145,12 +160,40 @@ class QuickerSMBC final : public Emulator
 
   __INLINE__ void showRender() override { _quickerSMBC.updateRenderer(); }
 
+  protected:
+
+  // Decodes a newly registered input with the core's own parser, so that advancing with it does not parse it again
+  void registerInputImpl(const inputHandle_t inputHandle, const std::string &input) override
+  {
+    bool isInputValid = _inputParser.parseInputString(input);
+    if (isInputValid == false) JAFFAR_THROW_LOGIC("Input provided cannot be parsed by '%s': '%s'\n", getName().c_str(), input.c_str());
+
+    _decodedInputs.resize(inputHandle + 1);
+    _decodedInputs[inputHandle].controller1Code       = _inputParser.getController1Code();
+    _decodedInputs[inputHandle].controller2Code       = _inputParser.getController2Code();
+    _decodedInputs[inputHandle].pressesConsoleButtons = _inputParser.getPowerButtonState() || _inputParser.getResetButtonState();
+  }
+
   private:
 
   // Collection of state blocks to disable during engine run
   std::vector<std::string> _disabledStateProperties;
 
-  smbc::EmuInstance _quickerSMBC;
+  SMBCInstance _quickerSMBC;
+
+  // Input parser, with the core's default controller types, to decode the registered inputs
+  smbc::Controller _inputParser;
+
+  // A registered input, as the core's controller codes
+  struct decodedInput_t
+  {
+    smbc::Controller::port_t controller1Code;
+    smbc::Controller::port_t controller2Code;
+    bool                     pressesConsoleButtons;
+  };
+
+  // Registered inputs, indexed by their handle
+  std::vector<decodedInput_t> _decodedInputs;
 
   std::string _romFilePath = "";
   std::string _romFileSHA1;
@@ -41,13 +41,15 @@ class Hellway final : public jaffarPlus::Game
     _subDistance = (uint8_t *)_propertyMap[jaffarCommon::hash::hashString("SubDistance")]->getPointer();
   }
 
-  __INLINE__ void advanceStateImpl(const std::string &input) override
+  __INLINE__ void advanceStateImpl(const Emulator::inputHandle_t input) override
   {
     // Running emulator
-    _emulator->advanceState(input);
+    _emulator->advanceStateDecoded(input);
   }
 
-  __INLINE__ void computeAdditionalHashing(MetroHash128 &hashEngine) const override { hashEngine.Update(_lowMem, 0x80); }
+  __INLINE__ void registerGameHashSpans() override { registerHashSpan(_lowMem, 0x80); }
+
+  __INLINE__ void computeAdditionalHashing(hashPolicy::Base &hashEngine) const override {}
 
   // Updating derivative values after updating the internal state
   __INLINE__ void stateUpdatePostHook() override {}
@@ -32,13 +32,15 @@ class Arkanoid final : public jaffarPlus::Game
 
   __INLINE__ void registerGameProperties() override { registerGameProperty("Score", &_arkState->score, Property::datatype_t::dt_uint32, Property::endianness_t::little); }
 
-  __INLINE__ void advanceStateImpl(const std::string &input) override
+  __INLINE__ void advanceStateImpl(const Emulator::inputHandle_t input) override
   {
     // Running emulator
-    _emulator->advanceState(input);
+    _emulator->advanceStateDecoded(input);
   }
 
-  __INLINE__ void computeAdditionalHashing(MetroHash128 &hashEngine) const override { hashEngine.Update(*_arkState); }
+  __INLINE__ void registerGameHashSpans() override { registerHashSpan(_arkState, sizeof(*_arkState)); }
+
+  __INLINE__ void computeAdditionalHashing(hashPolicy::Base &hashEngine) const override {}
 
   // Updating derivative values after updating the internal state
   __INLINE__ void stateUpdatePostHook() override {}
@@ -46,13 +46,15 @@ class DinoRunner final : public jaffarPlus::Game
     _playerVelY  = (int16_t *)_propertyMap[jaffarCommon::hash::hashString("Player Vel Y")]->getPointer();
   }
 
-  __INLINE__ void advanceStateImpl(const std::string &input) override
+  __INLINE__ void advanceStateImpl(const Emulator::inputHandle_t input) override
   {
     // Running emulator
-    _emulator->advanceState(input);
+    _emulator->advanceStateDecoded(input);
   }
 
-  __INLINE__ void computeAdditionalHashing(MetroHash128 &hashEngine) const override { hashEngine.Update(_workRAM, 0x2000); }
+  __INLINE__ void registerGameHashSpans() override { registerHashSpan(_workRAM, 0x2000); }
+
+  __INLINE__ void computeAdditionalHashing(hashPolicy::Base &hashEngine) const override {}
 
   // Updating derivative values after updating the internal state
   __INLINE__ void stateUpdatePostHook() override {}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <limits>
 #include <jaffarCommon/json.hpp>
 #include <emulator.hpp>
 #include <game.hpp>
@@ -51,24 +52,32 @@ class Sprilo final : public jaffarPlus::Game
     _lapProgress = (uint8_t *)_propertyMap[jaffarCommon::hash::hashString("Lap Progress")]->getPointer();
   }
 
-  __INLINE__ void advanceStateImpl(const std::string &input) override
+  __INLINE__ void registerInputImpl(const Emulator::inputHandle_t inputHandle, const std::string &input) override
+  {
+    // Remembering the handle of the null input
+    if (input == "|..|........|") _nullInputHandle = inputHandle;
+  }
+
+  __INLINE__ void advanceStateImpl(const Emulator::inputHandle_t input) override
   {
     // Increasing counter if input is null
-    if (input != "|..|........|") _lastInputStep = _currentStep;
+    if (input != _nullInputHandle) _lastInputStep = _currentStep;
 
     // Running emulator
-    _emulator->advanceState(input);
+    _emulator->advanceStateDecoded(input);
 
     // Advancing current step
     _currentStep++;
   }
 
-  __INLINE__ void computeAdditionalHashing(MetroHash128 &hashEngine) const override
+  __INLINE__ void registerGameHashSpans() override
   {
-    hashEngine.Update(&_lowMem[0x0001], 0x0018);
-    hashEngine.Update(&_lowMem[0x001C], 0x0050);
+    registerHashSpan(&_lowMem[0x0001], 0x0018);
+    registerHashSpan(&_lowMem[0x001C], 0x0050);
   }
 
+  __INLINE__ void computeAdditionalHashing(hashPolicy::Base &hashEngine) const override {}
+
   // Updating derivative values after updating the internal state
   __INLINE__ void stateUpdatePostHook() override {}
 
@@ -194,6 +203,9 @@ class Sprilo final : public jaffarPlus::Game
   uint16_t _lastInputStep = 0;
   uint16_t _currentStep   = 0;
 
+  // Handle of the null input, if registered
+  Emulator::inputHandle_t _nullInputHandle = std::numeric_limits<Emulator::inputHandle_t>::max();
+
   // Game-Specific values
   float _player1DistanceToPointX;
   float _player1DistanceToPointY;
@@ -55,18 +55,20 @@ class SuperMarioBros final : public jaffarPlus::Game
     _marioWalkingFrame = (uint8_t *)_propertyMap[jaffarCommon::hash::hashString("Mario Walking Frame")]->getPointer();
   }
 
-  __INLINE__ void advanceStateImpl(const std::string &input) override
+  __INLINE__ void advanceStateImpl(const Emulator::inputHandle_t input) override
   {
     // Running emulator
-    _emulator->advanceState(input);
+    _emulator->advanceStateDecoded(input);
   }
 
-  __INLINE__ void computeAdditionalHashing(MetroHash128 &hashEngine) const override
+  __INLINE__ void registerGameHashSpans() override
   {
-    hashEngine.Update(&_lowMem[0x0001], 0x0018);
-    hashEngine.Update(&_lowMem[0x001C], 0x0050);
+    registerHashSpan(&_lowMem[0x0001], 0x0018);
+    registerHashSpan(&_lowMem[0x001C], 0x0050);
   }
 
+  __INLINE__ void computeAdditionalHashing(hashPolicy::Base &hashEngine) const override {}
+
   // Updating derivative values after updating the internal state
   __INLINE__ void stateUpdatePostHook() override
   {
@@ -87,13 +87,13 @@ class AnotherWorld final : public jaffarPlus::Game
     _fumesState      = (int16_t *)_propertyMap[jaffarCommon::hash::hashString("Fumes State")]->getPointer();
   }
 
-  __INLINE__ void advanceStateImpl(const std::string &input) override
+  __INLINE__ void advanceStateImpl(const Emulator::inputHandle_t input) override
   {
     // Running emulator
-    _emulator->advanceState(input);
+    _emulator->advanceStateDecoded(input);
   }
 
-  __INLINE__ void computeAdditionalHashing(MetroHash128 &hashEngine) const override
+  __INLINE__ void computeAdditionalHashing(hashPolicy::Base &hashEngine) const override
   {
     // Storing current state
     jaffarCommon::serializer::Contiguous s(_tempStorage, _tempStorageSize);
@@ -191,58 +191,60 @@ class PrinceOfPersia final : public jaffarPlus::Game
     }
   }
 
-  __INLINE__ void advanceStateImpl(const std::string &input) override { _emulator->advanceState(input); }
+  __INLINE__ void advanceStateImpl(const Emulator::inputHandle_t input) override { _emulator->advanceStateDecoded(input); }
 
-  __INLINE__ void computeAdditionalHashing(MetroHash128 &hashEngine) const override
+  __INLINE__ void registerGameHashSpans() override
   {
-    hashEngine.Update(_gameState->checkpoint);
-    hashEngine.Update(_gameState->upside_down);
-    hashEngine.Update(_gameState->drawn_room);
-    hashEngine.Update(_gameState->current_level);
-    hashEngine.Update(_gameState->next_level);
-    hashEngine.Update(_gameState->mobs_count);
-    hashEngine.Update(_gameState->trobs_count);
-    hashEngine.Update(_gameState->leveldoor_open);
-    hashEngine.Update(_gameState->Kid);
-    hashEngine.Update(_gameState->hitp_curr);
-    hashEngine.Update(_gameState->hitp_max);
-    hashEngine.Update(_gameState->hitp_beg_lev);
-    hashEngine.Update(_gameState->grab_timer);
-    hashEngine.Update(_gameState->holding_sword);
-    hashEngine.Update(_gameState->united_with_shadow);
-    hashEngine.Update(_gameState->have_sword);
-    hashEngine.Update(_gameState->kid_sword_strike);
-    hashEngine.Update(_gameState->pickup_obj_type);
-    hashEngine.Update(_gameState->offguard);
-    hashEngine.Update(_gameState->Guard);
-    hashEngine.Update(_gameState->guardhp_curr);
-    hashEngine.Update(_gameState->guardhp_max);
-    hashEngine.Update(_gameState->demo_index);
-    hashEngine.Update(_gameState->demo_time);
-    hashEngine.Update(_gameState->curr_guard_color);
-    hashEngine.Update(_gameState->guard_notice_timer);
-    hashEngine.Update(_gameState->guard_skill);
-    hashEngine.Update(_gameState->shadow_initialized);
-    hashEngine.Update(_gameState->guard_refrac);
-    hashEngine.Update(_gameState->justblocked);
-    hashEngine.Update(_gameState->droppedout);
-    hashEngine.Update(_gameState->prev_collision_row);
-    hashEngine.Update(_gameState->flash_color);
-    hashEngine.Update(_gameState->flash_time);
-    hashEngine.Update(_gameState->need_level1_music);
-    hashEngine.Update(_gameState->is_screaming);
-    hashEngine.Update(_gameState->is_feather_fall);
-    hashEngine.Update(_gameState->exit_room_timer);
-    hashEngine.Update(_gameState->is_guard_notice);
-    hashEngine.Update(_gameState->can_guard_see_kid);
-    hashEngine.Update(_gameState->collision_row);
-    hashEngine.Update(_gameState->jumped_through_mirror);
-    hashEngine.Update(_gameState->kidPreviousFrame);
+    registerHashSpan(&_gameState->checkpoint, sizeof(_gameState->checkpoint));
+    registerHashSpan(&_gameState->upside_down, sizeof(_gameState->upside_down));
+    registerHashSpan(&_gameState->drawn_room, sizeof(_gameState->drawn_room));
+    registerHashSpan(&_gameState->current_level, sizeof(_gameState->current_level));
+    registerHashSpan(&_gameState->next_level, sizeof(_gameState->next_level));
+    registerHashSpan(&_gameState->mobs_count, sizeof(_gameState->mobs_count));
+    registerHashSpan(&_gameState->trobs_count, sizeof(_gameState->trobs_count));
+    registerHashSpan(&_gameState->leveldoor_open, sizeof(_gameState->leveldoor_open));
+    registerHashSpan(&_gameState->Kid, sizeof(_gameState->Kid));
+    registerHashSpan(&_gameState->hitp_curr, sizeof(_gameState->hitp_curr));
+    registerHashSpan(&_gameState->hitp_max, sizeof(_gameState->hitp_max));
+    registerHashSpan(&_gameState->hitp_beg_lev, sizeof(_gameState->hitp_beg_lev));
+    registerHashSpan(&_gameState->grab_timer, sizeof(_gameState->grab_timer));
+    registerHashSpan(&_gameState->holding_sword, sizeof(_gameState->holding_sword));
+    registerHashSpan(&_gameState->united_with_shadow, sizeof(_gameState->united_with_shadow));
+    registerHashSpan(&_gameState->have_sword, sizeof(_gameState->have_sword));
+    registerHashSpan(&_gameState->kid_sword_strike, sizeof(_gameState->kid_sword_strike));
+    registerHashSpan(&_gameState->pickup_obj_type, sizeof(_gameState->pickup_obj_type));
+    registerHashSpan(&_gameState->offguard, sizeof(_gameState->offguard));
+    registerHashSpan(&_gameState->Guard, sizeof(_gameState->Guard));
+    registerHashSpan(&_gameState->guardhp_curr, sizeof(_gameState->guardhp_curr));
+    registerHashSpan(&_gameState->guardhp_max, sizeof(_gameState->guardhp_max));
+    registerHashSpan(&_gameState->demo_index, sizeof(_gameState->demo_index));
+    registerHashSpan(&_gameState->demo_time, sizeof(_gameState->demo_time));
+    registerHashSpan(&_gameState->curr_guard_color, sizeof(_gameState->curr_guard_color));
+    registerHashSpan(&_gameState->guard_notice_timer, sizeof(_gameState->guard_notice_timer));
+    registerHashSpan(&_gameState->guard_skill, sizeof(_gameState->guard_skill));
+    registerHashSpan(&_gameState->shadow_initialized, sizeof(_gameState->shadow_initialized));
+    registerHashSpan(&_gameState->guard_refrac, sizeof(_gameState->guard_refrac));
+    registerHashSpan(&_gameState->justblocked, sizeof(_gameState->justblocked));
+    registerHashSpan(&_gameState->droppedout, sizeof(_gameState->droppedout));
+    registerHashSpan(&_gameState->prev_collision_row, sizeof(_gameState->prev_collision_row));
+    registerHashSpan(&_gameState->flash_color, sizeof(_gameState->flash_color));
+    registerHashSpan(&_gameState->flash_time, sizeof(_gameState->flash_time));
+    registerHashSpan(&_gameState->need_level1_music, sizeof(_gameState->need_level1_music));
+    registerHashSpan(&_gameState->is_screaming, sizeof(_gameState->is_screaming));
+    registerHashSpan(&_gameState->is_feather_fall, sizeof(_gameState->is_feather_fall));
+    registerHashSpan(&_gameState->exit_room_timer, sizeof(_gameState->exit_room_timer));
+    registerHashSpan(&_gameState->is_guard_notice, sizeof(_gameState->is_guard_notice));
+    registerHashSpan(&_gameState->can_guard_see_kid, sizeof(_gameState->can_guard_see_kid));
+    registerHashSpan(&_gameState->collision_row, sizeof(_gameState->collision_row));
+    registerHashSpan(&_gameState->jumped_through_mirror, sizeof(_gameState->jumped_through_mirror));
+    registerHashSpan(&_gameState->kidPreviousFrame, sizeof(_gameState->kidPreviousFrame));
 
     // Hashing all mobs by default
-    hashEngine.Update(_gameState->mobs);
+    registerHashSpan(&_gameState->mobs, sizeof(_gameState->mobs));
   }
 
+  __INLINE__ void computeAdditionalHashing(hashPolicy::Base &hashEngine) const override {}
+
   // Updating derivative values after updating the internal state
   __INLINE__ void stateUpdatePostHook() override
   {
@@ -52,13 +52,13 @@ class ChristmasCraze final : public jaffarPlus::Game
     _presentsGrabbed = (uint8_t *)_propertyMap[jaffarCommon::hash::hashString("Presents Grabbed")]->getPointer();
   }
 
-  __INLINE__ void advanceStateImpl(const std::string &input) override
+  __INLINE__ void advanceStateImpl(const Emulator::inputHandle_t input) override
   {
     // Running emulator
-    _emulator->advanceState(input);
+    _emulator->advanceStateDecoded(input);
   }
 
-  __INLINE__ void computeAdditionalHashing(MetroHash128 &hashEngine) const override {}
+  __INLINE__ void computeAdditionalHashing(hashPolicy::Base &hashEngine) const override {}
 
   // Updating derivative values after updating the internal state
   __INLINE__ void stateUpdatePostHook() override {}
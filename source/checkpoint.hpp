@@ -0,0 +1,328 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include <jaffarCommon/logger.hpp>
+
+namespace jaffarPlus
+{
+
+namespace checkpoint
+{
+
+/**
+ * Flushes the entries of a directory (e.g., newly created or renamed files) to disk
+ */
+__INLINE__ void syncDirectory(const std::string &dirPath)
+{
+  const int fd = open(dirPath.c_str(), O_RDONLY | O_DIRECTORY);
+  if (fd < 0) JAFFAR_THROW_RUNTIME("[ERROR] Could not open checkpoint directory '%s': %s\n", dirPath.c_str(), strerror(errno));
+
+  const bool syncFailed = fsync(fd) != 0;
+  ::close(fd);
+  if (syncFailed == true) JAFFAR_THROW_RUNTIME("[ERROR] Could not sync checkpoint directory '%s': %s\n", dirPath.c_str(), strerror(errno));
+}
+
+/**
+ * Gets the directory a checkpoint directory is moved aside to, while it is being replaced on file systems that cannot
+ * exchange two directories atomically
+ */
+__INLINE__ std::string getPreviousDirectoryPath(const std::string &dirPath) { return dirPath + ".old"; }
+
+/**
+ * Replaces a checkpoint directory with a complete, newly written one (in the same file system), and makes it durable.
+ *
+ * The directories are exchanged in a single atomic step, so a crash at any point leaves a complete checkpoint in place,
+ * either the previous or the new one. If the file system does not support the exchange, the previous directory is
+ * first moved aside (see getPreviousDirectoryPath), where it can be resumed from until the new one is in place.
+ */
+__INLINE__ void replaceDirectory(const std::string &newDirPath, const std::string &dirPath)
+{
+  // Making the new directory's entries durable before moving it into place
+  syncDirectory(newDirPath);
+
+  auto parentPath = std::filesystem::path(dirPath).parent_path().string();
+  if (parentPath.empty() == true) parentPath = ".";
+
+  // If there is no previous checkpoint, the new one is simply moved into place
+  if (std::filesystem::exists(dirPath) == false)
+  {
+    if (rename(newDirPath.c_str(), dirPath.c_str()) != 0) JAFFAR_THROW_RUNTIME("[ERROR] Could not move checkpoint '%s' into place: %s\n", dirPath.c_str(), strerror(errno));
+    syncDirectory(parentPath);
+    return;
+  }
+
+  // Otherwise, exchanging it with the previous one, which then takes the new one's name
+  if (renameat2(AT_FDCWD, newDirPath.c_str(), AT_FDCWD, dirPath.c_str(), RENAME_EXCHANGE) != 0)
+  {
+    if (errno != EINVAL && errno != ENOSYS) JAFFAR_THROW_RUNTIME("[ERROR] Could not move checkpoint '%s' into place: %s\n", dirPath.c_str(), strerror(errno));
+
+    // The file system cannot exchange them, so the previous one is moved aside first
+    const auto previousDirPath = getPreviousDirectoryPath(dirPath);
+    std::filesystem::remove_all(previousDirPath);
+    if (rename(dirPath.c_str(), previousDirPath.c_str()) != 0) JAFFAR_THROW_RUNTIME("[ERROR] Could not move previous checkpoint '%s' aside: %s\n", dirPath.c_str(), strerror(errno));
+    syncDirectory(parentPath);
+    if (rename(newDirPath.c_str(), dirPath.c_str()) != 0) JAFFAR_THROW_RUNTIME("[ERROR] Could not move checkpoint '%s' into place: %s\n", dirPath.c_str(), strerror(errno));
+    syncDirectory(parentPath);
+    std::filesystem::remove_all(previousDirPath);
+    return;
+  }
+
+  // Making the exchange durable, and removing the previous checkpoint
+  syncDirectory(parentPath);
+  std::filesystem::remove_all(newDirPath);
+}
+
+/**
+ * Streams a checkpoint file to disk. Data is gathered into large buffers, which are written sequentially by a
+ * background thread while the next buffer is being filled.
+ *
+ * The file is written under a temporary name and only renamed into place when closed, so that an interrupted
+ * checkpoint never replaces a complete one.
+ */
+class Writer final
+{
+  public:
+
+  // Size of each of the two staging buffers
+  static constexpr size_t bufferSize = 64ul * 1024ul * 1024ul;
+
+  Writer(const std::string &filePath)
+    : _filePath(filePath)
+    , _temporaryFilePath(filePath + ".tmp")
+  {
+    _file = fopen(_temporaryFilePath.c_str(), "wb");
+    if (_file == nullptr) JAFFAR_THROW_RUNTIME("[ERROR] Could not open checkpoint file for writing: %s\n", _temporaryFilePath.c_str());
+
+    // Creating staging buffers
+    _buffers[0].resize(bufferSize);
+    _buffers[1].resize(bufferSize);
+
+    // Starting writer thread
+    _writerThread = std::thread([this]() { writerLoop(); });
+  }
+
+  ~Writer()
+  {
+    // If the writer was not closed (e.g., an exception was thrown), abandon the temporary file
+    if (_writerThread.joinable() == true)
+    {
+      finishWriterThread();
+      fclose(_file);
+      remove(_temporaryFilePath.c_str());
+    }
+  }
+
+  /**
+   * Appends the given data to the file
+   */
+  __INLINE__ void push(const void *data, size_t size)
+  {
+    auto *input = (const uint8_t *)data;
+    while (size > 0)
+    {
+      // Copying as much as fits in the current buffer
+      const size_t copySize = std::min(size, bufferSize - _bufferFill);
+      memcpy(&_buffers[_currentBuffer][_bufferFill], input, copySize);
+      _bufferFill += copySize;
+      input += copySize;
+      size -= copySize;
+
+      // If the buffer is full, hand it over to the writer thread
+      if (_bufferFill == bufferSize) flushBuffer();
+    }
+  }
+
+  /**
+   * Appends a single value to the file
+   */
+  template <class T>
+  __INLINE__ void push(const T &value)
+  {
+    push(&value, sizeof(T));
+  }
+
+  /**
+   * Writes any pending data, makes it durable, and moves the file into place
+   */
+  void close()
+  {
+    flushBuffer();
+    finishWriterThread();
+
+    // Flushing the file to disk, so that it is complete (not empty or truncated) once renamed, even after a power loss
+    const bool syncFailed  = fflush(_file) != 0 || fsync(fileno(_file)) != 0;
+    const bool closeFailed = fclose(_file) != 0;
+    if (_writeFailed == true || syncFailed == true || closeFailed == true) JAFFAR_THROW_RUNTIME("[ERROR] Could not write checkpoint file: %s\n", _temporaryFilePath.c_str());
+    if (rename(_temporaryFilePath.c_str(), _filePath.c_str()) != 0) JAFFAR_THROW_RUNTIME("[ERROR] Could not move checkpoint file into place: %s\n", _filePath.c_str());
+  }
+
+  private:
+
+  // Hands the current buffer over to the writer thread, waiting for it to finish with the previous one first
+  __INLINE__ void flushBuffer()
+  {
+    if (_bufferFill == 0) return;
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _condition.wait(lock, [this]() { return _hasPendingBuffer == false; });
+    _pendingBuffer    = _currentBuffer;
+    _pendingSize      = _bufferFill;
+    _hasPendingBuffer = true;
+    lock.unlock();
+    _condition.notify_all();
+
+    _currentBuffer ^= 1;
+    _bufferFill = 0;
+  }
+
+  // Waits for the writer thread to write the pending buffer (if any) and finish
+  __INLINE__ void finishWriterThread()
+  {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _isFinished = true;
+    }
+    _condition.notify_all();
+    _writerThread.join();
+  }
+
+  void writerLoop()
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true)
+    {
+      _condition.wait(lock, [this]() { return _hasPendingBuffer == true || _isFinished == true; });
+      if (_hasPendingBuffer == false) return;
+
+      // Writing the buffer outside the lock, so that the next one can be filled meanwhile
+      lock.unlock();
+      if (fwrite(_buffers[_pendingBuffer].data(), 1, _pendingSize, _file) != _pendingSize) _writeFailed = true;
+      lock.lock();
+
+      _hasPendingBuffer = false;
+      _condition.notify_all();
+    }
+  }
+
+  // Final and temporary file paths
+  const std::string _filePath;
+  const std::string _temporaryFilePath;
+
+  // Output file
+  FILE *_file;
+
+  // Staging buffers, the buffer being filled, and how much of it is filled
+  std::vector<uint8_t> _buffers[2];
+  size_t               _currentBuffer = 0;
+  size_t               _bufferFill    = 0;
+
+  // Buffer handed over to the writer thread
+  size_t _pendingBuffer    = 0;
+  size_t _pendingSize      = 0;
+  bool   _hasPendingBuffer = false;
+
+  // Set when no more buffers will be handed over
+  bool _isFinished = false;
+
+  // Set if any write failed
+  bool _writeFailed = false;
+
+  // Synchronization with the writer thread
+  std::mutex              _mutex;
+  std::condition_variable _condition;
+  std::thread             _writerThread;
+};
+
+/**
+ * Reads a checkpoint file by mapping it into memory, rather than parsing it. Pages are read from disk as they are accessed.
+ */
+class Reader final
+{
+  public:
+
+  Reader(const std::string &filePath)
+    : _filePath(filePath)
+  {
+    const int fd = open(filePath.c_str(), O_RDONLY);
+    if (fd < 0) JAFFAR_THROW_RUNTIME("[ERROR] Could not open checkpoint file for reading: %s\n", filePath.c_str());
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0) JAFFAR_THROW_RUNTIME("[ERROR] Could not get the size of checkpoint file: %s\n", filePath.c_str());
+    _size = fileStat.st_size;
+
+    // Mapping the whole file. The mapping remains valid after closing the descriptor
+    if (_size > 0)
+    {
+      void *mapping = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mapping == MAP_FAILED) JAFFAR_THROW_RUNTIME("[ERROR] Could not map checkpoint file: %s\n", filePath.c_str());
+      _data = (const uint8_t *)mapping;
+
+      // Checkpoint files are mostly read front to back, so aggressive read-ahead pays off
+      madvise((void *)_data, _size, MADV_SEQUENTIAL);
+    }
+
+    ::close(fd);
+  }
+
+  ~Reader()
+  {
+    if (_data != nullptr) munmap((void *)_data, _size);
+  }
+
+  /**
+   * Gets a pointer to the next data of the given size within the mapped file, and advances past it
+   */
+  __INLINE__ const uint8_t *popPointer(const size_t size)
+  {
+    if (_position + size > _size) JAFFAR_THROW_RUNTIME("[ERROR] Checkpoint file '%s' is truncated or corrupt\n", _filePath.c_str());
+    const auto *pointer = &_data[_position];
+    _position += size;
+    return pointer;
+  }
+
+  /**
+   * Copies the next data of the given size from the file
+   */
+  __INLINE__ void pop(void *const data, const size_t size) { memcpy(data, popPointer(size), size); }
+
+  /**
+   * Reads a single value from the file
+   */
+  template <class T>
+  __INLINE__ T pop()
+  {
+    T value;
+    pop(&value, sizeof(T));
+    return value;
+  }
+
+  private:
+
+  // Path to the file, for error reporting
+  const std::string _filePath;
+
+  // Mapped file contents and size
+  const uint8_t *_data = nullptr;
+  size_t         _size = 0;
+
+  // Current read position
+  size_t _position = 0;
+};
+
+} // namespace checkpoint
+
+} // namespace jaffarPlus
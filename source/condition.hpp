@@ -1,12 +1,18 @@
 #pragma once
 
+#include <cstring>
+#include <utility>
 #include <jaffarCommon/bitwise.hpp>
 #include "property.hpp"
 
 namespace jaffarPlus
 {
 
-class Condition
+/**
+ * A condition is stored as a flat, self-contained record (operand pointers, type tag, operator and immediate)
+ * so that a rule set can be compiled into a contiguous array and evaluated without virtual calls
+ */
+class Condition final
 {
   public:
 
@@ -22,12 +28,59 @@ class Condition
     op_bit_false
   };
 
-  Condition(const operator_t opType)
-    : _opType(opType)
-  {}
+  // Creates a condition that compares a property against an immediate value
+  template <typename T>
+  static __INLINE__ Condition createImmediate(const operator_t opType, const Property *property1, const T immediate2)
+  {
+    Condition condition(opType, property1);
+
+    // Storing the immediate's raw bytes
+    std::memcpy(&condition._immediate2, &immediate2, sizeof(T));
+
+    return condition;
+  }
+
+  // Creates a condition that compares a property against another property
+  static __INLINE__ Condition createProperty(const operator_t opType, const Property *property1, const Property *property2)
+  {
+    // Both operands are read with the type of the first one, so they must be equally sized
+    if (property1->getSize() != property2->getSize())
+      JAFFAR_THROW_LOGIC("[ERROR] Properties '%s' and '%s' have incompatible datatypes for comparison\n", property1->getName().c_str(), property2->getName().c_str());
+
+    Condition condition(opType, property1);
+
+    // Storing second operand
+    condition._operand2Pointer     = property2->getPointer();
+    condition._isOperand2BigEndian = property2->getEndianness() == Property::endianness_t::big;
 
-  virtual __INLINE__ bool evaluate() const = 0;
-  virtual ~Condition()                     = default;
+    return condition;
+  }
+
+  // Evaluates the condition by dispatching on its datatype tag
+  __INLINE__ bool evaluate() const
+  {
+    switch (_datatype)
+    {
+    case Property::datatype_t::dt_uint8: return evaluate<uint8_t>();
+    case Property::datatype_t::dt_uint16: return evaluate<uint16_t>();
+    case Property::datatype_t::dt_uint32: return evaluate<uint32_t>();
+    case Property::datatype_t::dt_uint64: return evaluate<uint64_t>();
+    case Property::datatype_t::dt_int8: return evaluate<int8_t>();
+    case Property::datatype_t::dt_int16: return evaluate<int16_t>();
+    case Property::datatype_t::dt_int32: return evaluate<int32_t>();
+    case Property::datatype_t::dt_int64: return evaluate<int64_t>();
+    case Property::datatype_t::dt_bool: return evaluate<bool>();
+    case Property::datatype_t::dt_float32: return evaluate<float>();
+    case Property::datatype_t::dt_float64: return evaluate<double>();
+    }
+
+    return false;
+  }
+
+  // Operand accessors, used to determine which memory the condition reads. The second pointer is null for immediates
+  __INLINE__ const void *getOperand1Pointer() const { return _operand1Pointer; }
+  __INLINE__ const void *getOperand2Pointer() const { return _operand2Pointer; }
+  __INLINE__ size_t      getOperandSize() const { return Property::getDatatypeSize(_datatype); }
 
   static __INLINE__ operator_t getOperatorType(const std::string &operation)
   {
@@ -45,63 +98,68 @@ class Condition
     return op_equal;
   }
 
-  protected:
-
-  const operator_t _opType;
-};
+  private:
 
-template <typename T>
-class _vCondition : public Condition
-{
-  public:
+  Condition(const operator_t opType, const Property *property1)
+    : _operand1Pointer(property1->getPointer())
+    , _datatype(property1->getDatatype())
+    , _opType(opType)
+    , _isOperand1BigEndian(property1->getEndianness() == Property::endianness_t::big)
+  {}
 
-  _vCondition(const operator_t opType, Property *property1, Property *property2, T immediate1, T immediate2)
-    : Condition(opType)
-    , _property1(property1)
-    , _property2(property2)
-    , _immediate1(immediate1)
-    , _immediate2(immediate2)
+  template <typename T>
+  __INLINE__ bool evaluate() const
   {
+    const T a = loadOperand<T>(_operand1Pointer, _isOperand1BigEndian);
+    const T b = _operand2Pointer == nullptr ? loadOperand<T>(&_immediate2, false) : loadOperand<T>(_operand2Pointer, _isOperand2BigEndian);
+
     switch (_opType)
     {
-    case op_equal: _opFcPtr = _opEqual; break;
-    case op_not_equal: _opFcPtr = _opNotEqual; break;
-    case op_greater: _opFcPtr = _opGreater; break;
-    case op_greater_or_equal: _opFcPtr = _opGreaterOrEqual; break;
-    case op_less: _opFcPtr = _opLess; break;
-    case op_less_or_equal: _opFcPtr = _opLessOrEqual; break;
-    case op_bit_true: _opFcPtr = _opBitTrue; break;
-    case op_bit_false: _opFcPtr = _opBitFalse; break;
-    default: break;
+    case op_equal: return a == b;
+    case op_not_equal: return a != b;
+    case op_greater: return a > b;
+    case op_greater_or_equal: return a >= b;
+    case op_less: return a < b;
+    case op_less_or_equal: return a <= b;
+    case op_bit_true: return jaffarCommon::bitwise::getBitFlag(a, b);
+    case op_bit_false: return !jaffarCommon::bitwise::getBitFlag(a, b);
     }
+
+    return false;
   }
 
-  __INLINE__ bool evaluate() const
+  // Reads an operand of the given type from memory, reversing its bytes if it is stored as big endian
+  template <typename T>
+  static __INLINE__ T loadOperand(const void *pointer, const bool isBigEndian)
   {
-    T immediate1 = _immediate1;
-    T immediate2 = _immediate2;
-    if (_property1 != nullptr) immediate1 = _property1->getValue<T>();
-    if (_property2 != nullptr) immediate2 = _property2->getValue<T>();
-    return _opFcPtr(immediate1, immediate2);
+    T value;
+    std::memcpy(&value, pointer, sizeof(T));
+    if (sizeof(T) == 1 || isBigEndian == false) return value;
+
+    // Converting from big endian value byte by byte
+    auto buffer = (uint8_t *)&value;
+    for (size_t i = 0; i < sizeof(T) / 2; i++) std::swap(buffer[i], buffer[sizeof(T) - 1 - i]);
+    return value;
   }
 
-  private:
+  // Pointer to the first operand's data
+  const void *_operand1Pointer;
+
+  // Pointer to the second operand's data. If null, the immediate is used instead
+  const void *_operand2Pointer = nullptr;
+
+  // Raw bytes of the second operand's immediate value
+  uint64_t _immediate2 = 0;
+
+  // Datatype of the operands
+  Property::datatype_t _datatype;
+
+  // Comparison operator
+  operator_t _opType;
 
-  static __INLINE__ bool _opEqual(const T a, const T b) { return a == b; }
-  static __INLINE__ bool _opNotEqual(const T a, const T b) { return a != b; }
-  static __INLINE__ bool _opGreater(const T a, const T b) { return a > b; }
-  static __INLINE__ bool _opGreaterOrEqual(const T a, const T b) { return a >= b; }
-  static __INLINE__ bool _opLess(const T a, const T b) { return a < b; }
-  static __INLINE__ bool _opLessOrEqual(const T a, const T b) { return a <= b; }
-  static __INLINE__ bool _opBitTrue(const T a, const T b) { return jaffarCommon::bitwise::getBitFlag(a, b); }
-  static __INLINE__ bool _opBitFalse(const T a, const T b) { return !jaffarCommon::bitwise::getBitFlag(a, b); }
-
-  bool (*_opFcPtr)(const T, const T);
-
-  Property *const _property1;
-  Property *const _property2;
-  const T         _immediate1;
-  const T         _immediate2;
+  // Operand endianness flags
+  bool _isOperand1BigEndian;
+  bool _isOperand2BigEndian = false;
 };
 
-} // namespace jaffarPlus
\ No newline at end of file
+} // namespace jaffarPlus
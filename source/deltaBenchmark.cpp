@@ -0,0 +1,161 @@
+#include <random>
+#include <string>
+#include <vector>
+#include <argparse/argparse.hpp>
+#include <jaffarCommon/deserializers/differential.hpp>
+#include <jaffarCommon/file.hpp>
+#include <jaffarCommon/json.hpp>
+#include <jaffarCommon/logger.hpp>
+#include <jaffarCommon/serializers/contiguous.hpp>
+#include <jaffarCommon/serializers/differential.hpp>
+#include <jaffarCommon/timing.hpp>
+#include "runner.hpp"
+#include "stateDb/xorDelta.hpp"
+
+// Reports the throughput and average encoded size of a differential encoding, given the time spent encoding and decoding all states
+void reportBenchmark(const std::string &encodingName, const size_t stateSize, const size_t stateCount, const size_t iterations, const size_t encodedBytes, const size_t encodeTime, const size_t decodeTime)
+{
+  const double operationCount = (double)(stateCount * iterations);
+  jaffarCommon::logger::log("[J+]    + %-20s %10.1f bytes/state  %10.2f ns/encode (%8.3f GB/s)  %10.2f ns/decode (%8.3f GB/s)\n",
+                            encodingName.c_str(),
+                            (double)encodedBytes / (double)stateCount,
+                            (double)encodeTime / operationCount,
+                            (double)stateSize * operationCount / (double)encodeTime,
+                            (double)decodeTime / operationCount,
+                            (double)stateSize * operationCount / (double)decodeTime);
+}
+
+int main(int argc, char *argv[])
+{
+  // Parsing command line arguments
+  argparse::ArgumentParser program("jaffar-delta-benchmark", "1.0");
+
+  program.add_argument("configFile").help("path to the Jaffar configuration script (.jaffar) file whose initial state to start from.").required();
+
+  program.add_argument("--iterations").help("number of times each state is encoded and decoded per differential encoding.").default_value(std::string("1000"));
+
+  program.add_argument("--states").help("number of consecutive states to encode, each against the one before it.").default_value(std::string("64"));
+
+  program.add_argument("--stepsPerState").help("number of steps (with random allowed inputs) the emulator advances between consecutive states.").default_value(std::string("1"));
+
+  // Try to parse arguments
+  try
+  {
+    program.parse_args(argc, argv);
+  }
+  catch (const std::runtime_error &err)
+  {
+    JAFFAR_THROW_LOGIC("%s\n%s", err.what(), program.help().str().c_str());
+  }
+
+  // Getting benchmark parameters
+  const std::string configFile    = program.get<std::string>("configFile");
+  const size_t      iterations    = std::stoul(program.get<std::string>("--iterations"));
+  const size_t      stateCount    = std::stoul(program.get<std::string>("--states"));
+  const size_t      stepsPerState = std::stoul(program.get<std::string>("--stepsPerState"));
+
+  // Reading and parsing the configuration file
+  std::string configFileString;
+  if (jaffarCommon::file::loadStringFromFile(configFileString, configFile) == false)
+    JAFFAR_THROW_LOGIC("[ERROR] Could not find or read from Jaffar config file: %s\n", configFile.c_str());
+
+  nlohmann::json config;
+  try
+  {
+    config = nlohmann::json::parse(configFileString);
+  }
+  catch (const std::exception &err)
+  {
+    JAFFAR_THROW_LOGIC("[ERROR] Parsing configuration file %s. Details:\n%s\n", configFile.c_str(), err.what());
+  }
+
+  // Getting component configurations
+  auto emulatorConfig = jaffarCommon::json::getObject(config, "Emulator Configuration");
+  auto gameConfig     = jaffarCommon::json::getObject(config, "Game Configuration");
+  auto runnerConfig   = jaffarCommon::json::getObject(config, "Runner Configuration");
+
+  // The input history is not needed to produce the states
+  runnerConfig["Store Input History"]["Enabled"]          = false;
+  runnerConfig["Store Input History"]["Max Size (Steps)"] = 0;
+
+  // Creating and initializing the runner, which loads the initial state (and plays the initial sequence, if any)
+  auto r = jaffarPlus::Runner::getRunner(emulatorConfig, gameConfig, runnerConfig);
+  r->initialize();
+  const size_t stateSize = r->getStateSize();
+
+  jaffarCommon::logger::log("[J+] Configuration file: '%s' (%lu bytes per state, %lu states, %lu steps apart)\n", configFile.c_str(), stateSize, stateCount, stepsPerState);
+
+  // Producing consecutive states, as the search would: each one advanced from the previous with one of its allowed inputs.
+  // The first one is the initial state, which is only used as a reference
+  std::mt19937             randomGenerator(0);
+  std::vector<std::string> states(stateCount + 1, std::string(stateSize, '\0'));
+  for (size_t i = 0; i < states.size(); i++)
+  {
+    for (size_t step = 0; step < stepsPerState && i > 0; step++)
+    {
+      const auto &allowedInputs = r->getAllowedInputs();
+      if (allowedInputs.empty() == true) JAFFAR_THROW_RUNTIME("[ERROR] No allowed inputs at state %lu, cannot advance\n", i);
+      r->advanceState(allowedInputs[randomGenerator() % allowedInputs.size()]);
+    }
+
+    jaffarCommon::serializer::Contiguous s(states[i].data(), stateSize);
+    r->serializeState(s);
+  }
+
+  // Storage for the encoded states (large enough for any of them) and the decoded state
+  const size_t                      encodedCapacity = 2 * stateSize + jaffarPlus::stateDb::XorDelta::getBitmapSize(stateSize) + 4096;
+  std::vector<std::vector<uint8_t>> encodedStates(stateCount, std::vector<uint8_t>(encodedCapacity));
+  std::vector<size_t>               encodedSizes(stateCount);
+  std::string                       decodedState(stateSize, '\0');
+
+  // Benchmarking the generic differential serializer
+  {
+    auto t0 = jaffarCommon::timing::now();
+    for (size_t i = 0; i < iterations; i++)
+      for (size_t j = 0; j < stateCount; j++)
+      {
+        jaffarCommon::serializer::Differential s(encodedStates[j].data(), encodedCapacity, states[j].data(), stateSize, false);
+        s.push(states[j + 1].data(), stateSize);
+        encodedSizes[j] = s.getOutputSize();
+      }
+    const auto encodeTime = jaffarCommon::timing::timeDeltaNanoseconds(jaffarCommon::timing::now(), t0);
+
+    t0 = jaffarCommon::timing::now();
+    for (size_t i = 0; i < iterations; i++)
+      for (size_t j = 0; j < stateCount; j++)
+      {
+        jaffarCommon::deserializer::Differential d(encodedStates[j].data(), encodedCapacity, states[j].data(), stateSize, false);
+        d.pop(decodedState.data(), stateSize);
+      }
+    const auto decodeTime = jaffarCommon::timing::timeDeltaNanoseconds(jaffarCommon::timing::now(), t0);
+
+    size_t encodedBytes = 0;
+    for (const auto size : encodedSizes) encodedBytes += size;
+    reportBenchmark("Serializer", stateSize, stateCount, iterations, encodedBytes, encodeTime, decodeTime);
+  }
+
+  // Benchmarking the XOR delta encoding
+  {
+    auto t0 = jaffarCommon::timing::now();
+    for (size_t i = 0; i < iterations; i++)
+      for (size_t j = 0; j < stateCount; j++)
+        encodedSizes[j] = jaffarPlus::stateDb::XorDelta::encode(
+          (const uint8_t *)states[j + 1].data(), (const uint8_t *)states[j].data(), stateSize, encodedStates[j].data(), encodedCapacity);
+    const auto encodeTime = jaffarCommon::timing::timeDeltaNanoseconds(jaffarCommon::timing::now(), t0);
+
+    t0 = jaffarCommon::timing::now();
+    for (size_t i = 0; i < iterations; i++)
+      for (size_t j = 0; j < stateCount; j++)
+        jaffarPlus::stateDb::XorDelta::decode(encodedStates[j].data(), (const uint8_t *)states[j].data(), stateSize, (uint8_t *)decodedState.data());
+    const auto decodeTime = jaffarCommon::timing::timeDeltaNanoseconds(jaffarCommon::timing::now(), t0);
+
+    // Checking the last state was decoded correctly
+    if (stateCount > 0 && decodedState != states[stateCount]) JAFFAR_THROW_RUNTIME("[ERROR] XOR delta decoding did not reproduce the original state\n");
+
+    size_t encodedBytes = 0;
+    for (const auto size : encodedSizes) encodedBytes += size;
+    reportBenchmark(std::string("XOR Delta (") + jaffarPlus::stateDb::XorDelta::getInstructionSetName() + ")", stateSize, stateCount, iterations, encodedBytes, encodeTime, decodeTime);
+  }
+
+  return 0;
+}
@@ -2,6 +2,7 @@
 
 #include <limits>
 #include <cstdlib>
+#include <filesystem>
 #include "engine.hpp"
 #include "game.hpp"
 #include "runner.hpp"
@@ -50,6 +51,18 @@ class Driver final
     _saveIntermediateBestStatePath        = jaffarCommon::json::getString(saveIntermediateResultsJs, "Best State Path");
     _saveIntermediateWorstStatePath       = jaffarCommon::json::getString(saveIntermediateResultsJs, "Worst State Path");
 
+    // Getting checkpoint configuration
+    const auto &saveCheckpointsJs = jaffarCommon::json::getObject(driverConfig, "Save Checkpoints");
+    _saveCheckpointsEnabled       = jaffarCommon::json::getBoolean(saveCheckpointsJs, "Enabled");
+    _saveCheckpointFrequency      = jaffarCommon::json::getNumber<size_t>(saveCheckpointsJs, "Frequency (Steps)");
+    _saveCheckpointPath           = jaffarCommon::json::getString(saveCheckpointsJs, "Path");
+    if (_saveCheckpointsEnabled == true && _saveCheckpointFrequency == 0) JAFFAR_THROW_LOGIC("The checkpoint frequency must be at least one step");
+    if (_saveCheckpointsEnabled == true && std::filesystem::path(_saveCheckpointPath).has_filename() == false)
+      JAFFAR_THROW_LOGIC("The checkpoint path '%s' must name a directory, without a trailing separator", _saveCheckpointPath.c_str());
+
+    // For testing purposes, the run can be interrupted at a given step (after saving any checkpoint due then), as if it were stopped
+    if (auto *value = std::getenv("JAFFAR_DRIVER_OVERRIDE_INTERRUPT_STEP")) _interruptStep = std::stoul(value);
+
     // Getting component configurations
     auto emulatorConfig = jaffarCommon::json::getObject(config, "Emulator Configuration");
     auto gameConfig     = jaffarCommon::json::getObject(config, "Game Configuration");
@@ -65,6 +78,9 @@ class Driver final
 
     // Creating engine from the configuration
     _engine = std::make_unique<Engine>(emulatorConfig, gameConfig, runnerConfig, engineConfig);
+
+    // The driver's runner loads the engine's states, so it needs to read the engine's input history log
+    _runner->setInputHistoryLog(_engine->getInputHistoryLog());
   }
 
   ~Driver() {}
@@ -103,6 +119,9 @@ class Driver final
     // Resetting engine
     _engine->reset();
 
+    // If resuming, restore the search from the checkpoint now
+    if (_resumeCheckpointPath.empty() == false) loadCheckpoint(_resumeCheckpointPath);
+
     // Internal flag to indicate we are still running
     _hasFinished = false;
 
@@ -156,6 +175,16 @@ class Driver final
 
       // Increasing step counter
       _currentStep++;
+
+      // Saving a checkpoint, if it is due
+      if (_saveCheckpointsEnabled == true && _currentStep % _saveCheckpointFrequency == 0) saveCheckpoint();
+
+      // If interrupted (for testing purposes), finish now
+      if (_interruptStep > 0 && _currentStep >= _interruptStep)
+      {
+        exitReason = exitReason_t::maximumStepReached;
+        break;
+      }
     }
 
     // Setting finalized flag
@@ -178,6 +207,77 @@ class Driver final
     return exitReason;
   }
 
+  /**
+   * Sets a checkpoint directory from which to resume the search when running
+   */
+  void setResumeCheckpointPath(const std::string &checkpointPath) { _resumeCheckpointPath = checkpointPath; }
+
+  /**
+   * Writes a checkpoint of the search into the configured directory. It is written into a fresh directory first, which
+   * then replaces the previous checkpoint at once, so that a crash while saving never leaves an incomplete one behind.
+   * The driver's own file is written last, so that its presence marks a complete checkpoint.
+   */
+  void saveCheckpoint()
+  {
+    const auto t0 = jaffarCommon::timing::now();
+
+    // Creating a fresh directory for the new checkpoint, next to the previous one
+    const auto newCheckpointPath = _saveCheckpointPath + ".new";
+    std::filesystem::remove_all(newCheckpointPath);
+    std::filesystem::create_directories(newCheckpointPath);
+
+    // Saving engine checkpoint
+    _engine->saveCheckpoint(newCheckpointPath);
+
+    // Saving the driver's counters and best state
+    checkpoint::Writer writer(newCheckpointPath + "/driver.bin");
+    writer.push<size_t>(_currentStep);
+    writer.push<size_t>(_winStatesFound);
+    writer.push<float>(_bestWinStateReward);
+    writer.push<float>(_bestStateReward);
+    writer.push(_bestStateStorage.data(), _stateSize);
+    writer.push<size_t>(_bestSolutionStorage.size());
+    writer.push(_bestSolutionStorage.data(), _bestSolutionStorage.size());
+    writer.close();
+
+    // Replacing the previous checkpoint with the new one
+    checkpoint::replaceDirectory(newCheckpointPath, _saveCheckpointPath);
+
+    jaffarCommon::logger::log("[J+] Checkpoint saved to '%s' in %.3fs\n", _saveCheckpointPath.c_str(), 1.0e-9 * (double)jaffarCommon::timing::timeDeltaNanoseconds(jaffarCommon::timing::now(), t0));
+  }
+
+  /**
+   * Resumes the search from a checkpoint directory
+   */
+  void loadCheckpoint(std::string checkpointPath)
+  {
+    const auto t0 = jaffarCommon::timing::now();
+
+    // If the run stopped while replacing the checkpoint, the previous one may have been left aside
+    const auto previousCheckpointPath = checkpoint::getPreviousDirectoryPath(checkpointPath);
+    if (std::filesystem::exists(checkpointPath + "/driver.bin") == false && std::filesystem::exists(previousCheckpointPath + "/driver.bin") == true)
+      checkpointPath = previousCheckpointPath;
+
+    // Checking the checkpoint is complete
+    if (std::filesystem::exists(checkpointPath + "/driver.bin") == false)
+      JAFFAR_THROW_RUNTIME("[ERROR] No complete checkpoint found in '%s'\n", checkpointPath.c_str());
+
+    // Loading engine checkpoint
+    _engine->loadCheckpoint(checkpointPath);
+
+    // Loading the driver's counters and best state
+    checkpoint::Reader reader(checkpointPath + "/driver.bin");
+    _currentStep        = reader.pop<size_t>();
+    _winStatesFound     = reader.pop<size_t>();
+    _bestWinStateReward = reader.pop<float>();
+    _bestStateReward    = reader.pop<float>();
+    reader.pop(_bestStateStorage.data(), _stateSize);
+    _bestSolutionStorage.resize(reader.pop<size_t>());
+    reader.pop(_bestSolutionStorage.data(), _bestSolutionStorage.size());
+
+    jaffarCommon::logger::log("[J+] Resumed from checkpoint '%s' (step %lu) in %.3fs\n", checkpointPath.c_str(), _currentStep, 1.0e-9 * (double)jaffarCommon::timing::timeDeltaNanoseconds(jaffarCommon::timing::now(), t0));
+  }
+
   void saveBestStateInformation()
   {
     // Making sure the main thread is not currently writing
@@ -232,6 +332,17 @@ class Driver final
     }
   }
 
+  /**
+   * Decodes a state, as stored in the state database, into its raw form and keeps it in the given storage. The stored
+   * state may be compressed or in a smaller size class, so it cannot be copied as is. The state is left loaded in the
+   * runner.
+   */
+  void storeRawState(std::string &storage, const void *statePtr)
+  {
+    const void *rawStatePtr = _engine->getStateDb()->decodeState(*_runner, statePtr, storage.data());
+    if (rawStatePtr != storage.data()) memcpy(storage.data(), rawStatePtr, _stateSize);
+  }
+
   void updateWorstState()
   {
     // If no states in database, there is nothing to update
@@ -243,11 +354,8 @@ class Driver final
     // Getting worst state so far
     auto worstState = _engine->getStateDb()->getWorstState();
 
-    // Saving worst state into the storage
-    memcpy(_worstStateStorage.data(), worstState, _stateSize);
-
-    // Loading worst state state into runner
-    _engine->getStateDb()->loadStateIntoRunner(*_runner, _worstStateStorage.data());
+    // Saving worst state into the storage, also loading it into the runner
+    storeRawState(_worstStateStorage, worstState);
 
     // Saving worst solution into storage
     _worstSolutionStorage = _runner->getInputHistoryString();
@@ -267,6 +375,10 @@ class Driver final
     // Making sure the intermediate result thread is not currently reading
     _updateIntermediateResultMutex.lock();
 
+    // Whether the best state was replaced in this call. If not, its solution is already stored, and its input history
+    // records may no longer be valid, since the log is collected between steps.
+    bool isNewBestState = false;
+
     // If we haven't found any winning state, simply use the currently best state
     if (_winStatesFound == 0)
     {
@@ -274,7 +386,8 @@ class Driver final
       auto bestState = _engine->getStateDb()->getBestState();
 
       // Saving best state into the storage
-      memcpy(_bestStateStorage.data(), bestState, _stateSize);
+      storeRawState(_bestStateStorage, bestState);
+      isNewBestState = true;
     }
 
     // If we have found a winning state in this step that improves on the current best, save it now
@@ -290,18 +403,19 @@ class Driver final
         _bestWinStateReward = winStateEntry.reward;
 
         // Saving win state into the storage
-        memcpy(_bestStateStorage.data(), winStateEntry.stateData, _stateSize);
+        storeRawState(_bestStateStorage, winStateEntry.stateData);
+        isNewBestState = true;
       }
     }
 
     // Loading best state state into runner
-    _engine->getStateDb()->loadStateIntoRunner(*_runner, _bestStateStorage.data());
+    _engine->getStateDb()->loadRawStateIntoRunner(*_runner, _bestStateStorage.data());
 
     // Updating best state reward
     _bestStateReward = _runner->getGame()->getReward();
 
     // Storing best solution
-    _bestSolutionStorage = _runner->getInputHistoryString();
+    if (isNewBestState == true) _bestSolutionStorage = _runner->getInputHistoryString();
 
     // Making sure the intermediate result thread is not currently reading
     _updateIntermediateResultMutex.unlock();
@@ -329,7 +443,7 @@ class Driver final
     _engine->printInfo();
 
     // Loading best state into runner
-    _engine->getStateDb()->loadStateIntoRunner(*_runner, _bestStateStorage.data());
+    _engine->getStateDb()->loadRawStateIntoRunner(*_runner, _bestStateStorage.data());
 
     // Printing best state information to screen
     jaffarCommon::logger::log("[J+] Runner Information (Best State): \n");
@@ -388,10 +502,10 @@ class Driver final
   // Reward for the best (win or otherwise) state found to far
   float _worstStateReward;
 
-  // Storage for the current best (win or otherwise) state
+  // Storage for the current best (win or otherwise) state, in raw form
   std::string _bestStateStorage;
 
-  // Storage for the current worst (win or otherwise) state
+  // Storage for the current worst (win or otherwise) state, in raw form
   std::string _worstStateStorage;
 
   // Storage for the current best (win or otherwise) state
@@ -428,6 +542,23 @@ class Driver final
 
   // Update intermediate result mutex
   std::mutex _updateIntermediateResultMutex;
+
+  /////////////// Checkpoints
+
+  // Whether to save checkpoints at all
+  bool _saveCheckpointsEnabled;
+
+  // Number of steps between checkpoints
+  size_t _saveCheckpointFrequency;
+
+  // Directory to save checkpoints into
+  std::string _saveCheckpointPath;
+
+  // Directory of the checkpoint to resume from (empty if not resuming)
+  std::string _resumeCheckpointPath;
+
+  // Step at which to interrupt the run, for testing purposes (zero if not interrupting)
+  size_t _interruptStep = 0;
 };
 
 } // namespace jaffarPlus
\ No newline at end of file
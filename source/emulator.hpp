@@ -1,8 +1,13 @@
 #pragma once
 
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include <jaffarCommon/deserializers/contiguous.hpp>
 #include <jaffarCommon/file.hpp>
+#include <jaffarCommon/hash.hpp>
 #include <jaffarCommon/json.hpp>
 #include <jaffarCommon/serializers/contiguous.hpp>
 #include <SDL2/SDL.h>
@@ -46,9 +51,44 @@ class Emulator
     _isInitialized = true;
   }
 
-  // State advancing function
+  // Handle to an input registered with the emulator
+  typedef uint32_t inputHandle_t;
+
+  /**
+   * Registers an input, so that it is decoded only once (at registration) rather than every time it is used.
+   * Returns the handle with which to advance state through the fast path. Registering the same input again returns the same handle.
+   */
+  __INLINE__ inputHandle_t registerInput(const std::string &input)
+  {
+    // If the input was already registered, return its handle
+    const auto itr = _inputHandleMap.find(input);
+    if (itr != _inputHandleMap.end()) return itr->second;
+
+    // Otherwise, create a new handle for it
+    const inputHandle_t inputHandle = _registeredInputs.size();
+    _registeredInputs.push_back(input);
+    _inputHandleMap[input] = inputHandle;
+
+    // Performing emulator-specific decoding
+    registerInputImpl(inputHandle, input);
+
+    return inputHandle;
+  }
+
+  // Gets the string of a registered input
+  __INLINE__ const std::string &getRegisteredInput(const inputHandle_t inputHandle) const { return _registeredInputs[inputHandle]; }
+
+  // State advancing function (string-based path, the input is parsed every time)
   virtual void advanceState(const std::string &move) = 0;
 
+  /**
+   * State advancing function (fast path) with a previously registered input.
+   *
+   * Emulators whose core can advance from a native (already parsed) controller value should decode it in registerInputImpl
+   * and override this function to use it. By default, it falls back to the string-based path with the stored input.
+   */
+  virtual void advanceStateDecoded(const inputHandle_t inputHandle) { advanceState(_registeredInputs[inputHandle]); }
+
   // State serialization / deserialization functions
   size_t getStateSize() const
   {
@@ -118,6 +158,39 @@ class Emulator
 
   protected:
 
+  /**
+   * Loads a ROM file and verifies its SHA1. This is done only once per process and file: the emulators of all the
+   * runners share the same (read-only) ROM data.
+   */
+  static std::shared_ptr<const std::string> loadRomFile(const std::string &romFilePath, const std::string &romFileSHA1)
+  {
+    static std::mutex                                                          romFilesMutex;
+    static std::unordered_map<std::string, std::shared_ptr<const std::string>> romFiles;
+
+    // Only a single thread loads a given ROM file, while the others wait for it
+    std::lock_guard<std::mutex> lock(romFilesMutex);
+
+    // If the ROM was already loaded and verified, share it
+    const auto itr = romFiles.find(romFilePath);
+    if (itr != romFiles.end()) return itr->second;
+
+    // Reading from ROM file
+    auto romFileData = std::make_shared<std::string>();
+    bool status      = jaffarCommon::file::loadStringFromFile(*romFileData, romFilePath.c_str());
+    if (status == false) JAFFAR_THROW_LOGIC("Could not find/read from ROM file: %s\n", romFilePath.c_str());
+
+    // Getting SHA1 of ROM for checksum
+    auto actualRomSHA1 = jaffarCommon::hash::getSHA1String(*romFileData);
+    if (romFileSHA1 != actualRomSHA1)
+      JAFFAR_THROW_LOGIC("ROM file: '%s' expected SHA1 ('%s') does not concide with the one read ('%s')\n", romFilePath.c_str(), romFileSHA1.c_str(), actualRomSHA1.c_str());
+
+    romFiles[romFilePath] = romFileData;
+    return romFileData;
+  }
+
+  // Optional hook for decoding a newly registered input into the emulator's native representation
+  virtual void registerInputImpl(const inputHandle_t inputHandle, const std::string &input){};
+
   virtual void enableStateProperty(const std::string &property) = 0;
 
   virtual void disableStateProperty(const std::string &property) = 0;
@@ -130,6 +203,12 @@ class Emulator
 
   // Collection of state blocks to disable during engine run
   std::vector<std::string> _disabledStateProperties;
+
+  // Registered inputs, indexed by their handle
+  std::vector<std::string> _registeredInputs;
+
+  // Map to find the handle of an already registered input
+  std::unordered_map<std::string, inputHandle_t> _inputHandleMap;
 };
 
 } // namespace jaffarPlus
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <semaphore>
+#include <thread>
 #include <jaffarCommon/deserializers/base.hpp>
 #include <jaffarCommon/hash.hpp>
 #include <jaffarCommon/json.hpp>
@@ -9,11 +11,13 @@
 #include <jaffarCommon/parallel.hpp>
 #include <gameList.hpp>
 #include <emulatorList.hpp>
+#include "checkpoint.hpp"
 #include "game.hpp"
 #include "hashDb.hpp"
 #include "runner.hpp"
 #include "stateDb/numa.hpp"
 #include "stateDb/plain.hpp"
+#include "stateDb/tiered.hpp"
 
 namespace jaffarPlus
 {
@@ -37,6 +41,12 @@ class Engine final
     // Creating storage for the runnners (one per thread)
     _runners.resize(_threadCount);
 
+    // Creating storage for the decoded base states (one per thread)
+    _rawBaseStates.resize(_threadCount);
+
+    // Creating storage for the per-thread statistics
+    _threadStatistics.resize(_threadCount);
+
     // Creating runners, one per thread
     JAFFAR_PARALLEL
     {
@@ -53,6 +63,9 @@ class Engine final
     // Grabbing a runner to do continue build the state databases
     auto &r = *_runners[0];
 
+    // All runners share the same input history log, since states are loaded across them
+    for (auto &runner : _runners) runner->setInputHistoryLog(r.getInputHistoryLog());
+
     // Creating State database
     const auto &stateDatabaseJs             = jaffarCommon::json::getObject(engineConfig, "State Database");
     const auto &stateDatabaseType           = jaffarCommon::json::getString(stateDatabaseJs, "Type");
@@ -69,10 +82,43 @@ class Engine final
       _stateDb                    = std::make_unique<jaffarPlus::stateDb::Numa>(r, jaffarCommon::json::getObject(engineConfig, "State Database"));
       stateDatabaseTypeRecognized = true;
     }
+
+    if (stateDatabaseType == "Tiered")
+    {
+      _stateDb                    = std::make_unique<jaffarPlus::stateDb::Tiered>(r, jaffarCommon::json::getObject(engineConfig, "State Database"));
+      stateDatabaseTypeRecognized = true;
+    }
     if (stateDatabaseTypeRecognized == false) JAFFAR_THROW_LOGIC("State database type '%s' not recognized", stateDatabaseType.c_str());
 
     // Creating hash database
     _hashDb = std::make_unique<jaffarPlus::HashDb>(jaffarCommon::json::getObject(engineConfig, "Hash Database"));
+
+    // Parsing profiling mode
+    const auto &profilingMode           = jaffarCommon::json::getString(engineConfig, "Profiling Mode");
+    bool        profilingModeRecognized = false;
+
+    if (profilingMode == "Full")
+    {
+      _profilingMode          = profilingMode_t::full;
+      profilingModeRecognized = true;
+    }
+
+    if (profilingMode == "Sampled")
+    {
+      _profilingMode          = profilingMode_t::sampled;
+      profilingModeRecognized = true;
+    }
+
+    if (profilingMode == "Off")
+    {
+      _profilingMode          = profilingMode_t::off;
+      profilingModeRecognized = true;
+    }
+
+    if (profilingModeRecognized == false) JAFFAR_THROW_LOGIC("Profiling mode '%s' not recognized", profilingMode.c_str());
+
+    // Parsing whether to initialize all runners as copies of a single (prototype) runner
+    _initializeRunnersFromPrototype = jaffarCommon::json::getBoolean(engineConfig, "Initialize Runners From Prototype");
   };
 
   /**
@@ -80,6 +126,18 @@ class Engine final
    */
   void initialize()
   {
+    const auto t0 = jaffarCommon::timing::now();
+
+    // If initializing from a prototype, only the first runner plays the initial sequence. The others copy its full state
+    std::string                prototypeState;
+    jaffarCommon::hash::hash_t prototypeHash;
+    if (_initializeRunnersFromPrototype == true)
+    {
+      _runners[0]->initialize();
+      prototypeState = _runners[0]->serializeFullState();
+      prototypeHash  = _runners[0]->computeHash();
+    }
+
     // Initializing runners, one per thread
     JAFFAR_PARALLEL
     {
@@ -90,15 +148,35 @@ class Engine final
       auto &r = _runners[threadId];
 
       // Initializing runner
-      r->initialize();
+      if (_initializeRunnersFromPrototype == false) r->initialize();
+      if (_initializeRunnersFromPrototype == true && threadId != 0) r->initializeFromPrototype(prototypeState);
+
+      // Allocating this thread's decoded base state buffer (first touch happens in the thread that uses it)
+      _rawBaseStates[threadId].resize(r->getStateSize());
     }
 
+    // Verifying that every copy matches its prototype. A copy only carries what the full state serializes, so anything else
+    // set while initializing the prototype (e.g., by the post-initial sequence hook) would be missing from it
+    if (_initializeRunnersFromPrototype == true)
+      for (size_t runnerId = 1; runnerId < _runners.size(); runnerId++)
+      {
+        const bool isStateEqual = _runners[runnerId]->serializeFullState() == prototypeState;
+        const bool isHashEqual  = _runners[runnerId]->computeHash() == prototypeHash;
+        if (isStateEqual == false || isHashEqual == false)
+          JAFFAR_THROW_LOGIC("[ERROR] Runner %lu differs from the prototype it was copied from. Set 'Initialize Runners From Prototype' to false for this game\n", runnerId);
+      }
+
+    jaffarCommon::logger::log("[J+] Runners initialized in %.3fs\n", 1.0e-9 * (double)jaffarCommon::timing::timeDeltaNanoseconds(jaffarCommon::timing::now(), t0));
+
     // Initializing State Db
     _stateDb->initialize();
 
     // Initializing hash database
     _hashDb->initialize();
 
+    // Starting the worker that advances the hash database at the end of every step
+    _hashDbAdvanceThread = std::thread([this]() { hashDbAdvanceWorker(); });
+
     // Grabbing a runner to do continue initialization
     auto &r = *_runners[0];
 
@@ -121,12 +199,6 @@ class Engine final
     // Evaluate game rules on the initial state
     r.getGame()->evaluateRules();
 
-    // Determining new game state type
-    r.getGame()->updateGameStateType();
-
-    // Running game-specific rule actions
-    r.getGame()->runGameSpecificRuleActions();
-
     // Updating game reward
     r.getGame()->updateReward();
 
@@ -156,18 +228,20 @@ class Engine final
     _totalNewStatesProcessed  = 0;
 
     // Initializing cumulative timing
-    _runnerStateAdvanceAverageCumulativeTime = 0;
-    _runnerStateLoadAverageCumulativeTime    = 0;
-    _runnerStateSaveAverageCumulativeTime    = 0;
-    _calculateHashAverageCumulativeTime      = 0;
-    _checkHashAverageCumulativeTime          = 0;
-    _ruleCheckingAverageCumulativeTime       = 0;
-    _getFreeStateAverageCumulativeTime       = 0;
-    _returnFreeStateAverageCumulativeTime    = 0;
-    _calculateRewardAverageCumulativeTime    = 0;
-    _advanceHashDbAverageCumulativeTime      = 0;
-    _advanceStateDbAverageCumulativeTime     = 0;
-    _popBaseStateDbAverageCumulativeTime     = 0;
+    _baseStateDecodeAverageCumulativeTime     = 0;
+    _runnerStateAdvanceAverageCumulativeTime  = 0;
+    _runnerStateLoadAverageCumulativeTime     = 0;
+    _runnerStateSaveAverageCumulativeTime     = 0;
+    _calculateHashAverageCumulativeTime       = 0;
+    _checkHashAverageCumulativeTime           = 0;
+    _ruleCheckingAverageCumulativeTime        = 0;
+    _getFreeStateAverageCumulativeTime        = 0;
+    _returnFreeStateAverageCumulativeTime     = 0;
+    _calculateRewardAverageCumulativeTime     = 0;
+    _advanceHashDbAverageCumulativeTime       = 0;
+    _advanceStateDbAverageCumulativeTime      = 0;
+    _collectInputHistoryAverageCumulativeTime = 0;
+    _popBaseStateDbAverageCumulativeTime      = 0;
 
     // Resetting total running time
     _totalRunningTime = 0;
@@ -199,18 +273,20 @@ class Engine final
     const auto tStep = jaffarCommon::timing::now();
 
     // Clearing step timing
-    _runnerStateAdvanceThreadRawTime = 0;
-    _runnerStateLoadThreadRawTime    = 0;
-    _runnerStateSaveThreadRawTime    = 0;
-    _calculateHashThreadRawTime      = 0;
-    _checkHashThreadRawTime          = 0;
-    _ruleCheckingThreadRawTime       = 0;
-    _getFreeStateThreadRawTime       = 0;
-    _returnFreeStateThreadRawTime    = 0;
-    _calculateRewardThreadRawTime    = 0;
-    _advanceHashDbThreadRawTime      = 0;
-    _advanceStateDbThreadRawTime     = 0;
-    _popBaseStateDbThreadRawTime     = 0;
+    _baseStateDecodeThreadRawTime     = 0;
+    _runnerStateAdvanceThreadRawTime  = 0;
+    _runnerStateLoadThreadRawTime     = 0;
+    _runnerStateSaveThreadRawTime     = 0;
+    _calculateHashThreadRawTime       = 0;
+    _checkHashThreadRawTime           = 0;
+    _ruleCheckingThreadRawTime        = 0;
+    _getFreeStateThreadRawTime        = 0;
+    _returnFreeStateThreadRawTime     = 0;
+    _calculateRewardThreadRawTime     = 0;
+    _advanceHashDbThreadRawTime       = 0;
+    _advanceStateDbThreadRawTime      = 0;
+    _collectInputHistoryThreadRawTime = 0;
+    _popBaseStateDbThreadRawTime      = 0;
 
     // Clearing step counters
     _stepBaseStatesProcessed = 0;
@@ -219,21 +295,62 @@ class Engine final
     // Clearing win state reward
     _stepBestWinState.reward = -std::numeric_limits<float>::infinity();
 
-    // Performing one computation step in parallel
+    // Performing one computation step in parallel, with the configured profiling mode
     JAFFAR_PARALLEL
-    workerFunction();
+    {
+      if (_profilingMode == profilingMode_t::full) workerFunction<profilingMode_t::full>();
+      if (_profilingMode == profilingMode_t::sampled) workerFunction<profilingMode_t::sampled>();
+      if (_profilingMode == profilingMode_t::off) workerFunction<profilingMode_t::off>();
+    }
 
-    // Advancing hash database state
-    const auto t0 = jaffarCommon::timing::now();
-    _hashDb->advanceStep();
-    _advanceHashDbThreadRawTime += jaffarCommon::timing::timeDeltaNanoseconds(jaffarCommon::timing::now(), t0);
+    // Reducing the per-thread statistics into the step timing and state counters
+    for (const auto &stats : _threadStatistics)
+    {
+      // If only some base states were profiled, their timing is extrapolated to all the base states processed by the thread
+      const double timingScale = stats.profiledBaseStates > 0 ? (double)stats.baseStatesProcessed / (double)stats.profiledBaseStates : 0.0;
+
+      _baseStateDecodeThreadRawTime += timingScale * (double)stats.baseStateDecodeTime;
+      _runnerStateAdvanceThreadRawTime += timingScale * (double)stats.runnerStateAdvanceTime;
+      _runnerStateLoadThreadRawTime += timingScale * (double)stats.runnerStateLoadTime;
+      _runnerStateSaveThreadRawTime += timingScale * (double)stats.runnerStateSaveTime;
+      _calculateHashThreadRawTime += timingScale * (double)stats.calculateHashTime;
+      _checkHashThreadRawTime += timingScale * (double)stats.checkHashTime;
+      _ruleCheckingThreadRawTime += timingScale * (double)stats.ruleCheckingTime;
+      _getFreeStateThreadRawTime += timingScale * (double)stats.getFreeStateTime;
+      _returnFreeStateThreadRawTime += timingScale * (double)stats.returnFreeStateTime;
+      _calculateRewardThreadRawTime += timingScale * (double)stats.calculateRewardTime;
+      _popBaseStateDbThreadRawTime += timingScale * (double)stats.popBaseStateDbTime;
+      _stepBaseStatesProcessed += stats.baseStatesProcessed;
+      _stepNewStatesProcessed += stats.newStatesProcessed;
+      _normalStates += stats.normalStates;
+      _repeatedStates += stats.repeatedStates;
+      _failedStates += stats.failedStates;
+      _winStates += stats.winStates;
+      _droppedStatesNoStorage += stats.droppedStatesNoStorage;
+      _droppedStatesFailedSerialization += stats.droppedStatesFailedSerialization;
+      _droppedStatesCheckpoint += stats.droppedStatesCheckpoint;
+    }
+
+    // Advancing hash database state. This is done by its worker, so that the rotation of the hash stores (which may
+    // involve releasing a large one) overlaps with the state database advance
+    _hashDbAdvanceRequest.release();
 
     // Swapping next and current state databases
     const auto t1 = jaffarCommon::timing::now();
     _stateDb->advanceStep();
     _advanceStateDbThreadRawTime += jaffarCommon::timing::timeDeltaNanoseconds(jaffarCommon::timing::now(), t1);
 
+    // Waiting for the hash database to finish advancing
+    _hashDbAdvanceCompletion.acquire();
+
+    // Removing the input history records no longer reachable from the states just stored
+    const auto t2 = jaffarCommon::timing::now();
+    if (_runners[0]->getInputHistoryLog() != nullptr) _runners[0]->getInputHistoryLog()->collect();
+    _collectInputHistoryThreadRawTime += jaffarCommon::timing::timeDeltaNanoseconds(jaffarCommon::timing::now(), t2);
+
     // Processing step and cumulative timing
+    _baseStateDecodeAverageTime = _baseStateDecodeThreadRawTime / _threadCount;
+    _baseStateDecodeAverageCumulativeTime += _baseStateDecodeAverageTime;
     _runnerStateAdvanceAverageTime = _runnerStateAdvanceThreadRawTime / _threadCount;
     _runnerStateAdvanceAverageCumulativeTime += _runnerStateAdvanceAverageTime;
     _runnerStateLoadAverageTime = _runnerStateLoadThreadRawTime / _threadCount;
@@ -254,10 +371,12 @@ class Engine final
     _calculateRewardAverageCumulativeTime += _calculateRewardAverageTime;
     _popBaseStateDbAverageTime = _popBaseStateDbThreadRawTime / _threadCount;
     _popBaseStateDbAverageCumulativeTime += _popBaseStateDbAverageTime;
-    _advanceHashDbAverageTime = _advanceHashDbThreadRawTime.load();
+    _advanceHashDbAverageTime = _advanceHashDbThreadRawTime;
     _advanceHashDbAverageCumulativeTime += _advanceHashDbAverageTime;
-    _advanceStateDbAverageTime = _advanceStateDbThreadRawTime.load();
+    _advanceStateDbAverageTime = _advanceStateDbThreadRawTime;
     _advanceStateDbAverageCumulativeTime += _advanceStateDbAverageTime;
+    _collectInputHistoryAverageTime = _collectInputHistoryThreadRawTime;
+    _collectInputHistoryAverageCumulativeTime += _collectInputHistoryAverageTime;
 
     // Processing state counters
     _totalBaseStatesProcessed += _stepBaseStatesProcessed;
@@ -273,14 +392,66 @@ class Engine final
     _currentStep++;
   }
 
-  ~Engine() = default;
+  /**
+   * Writes a checkpoint of the search into the given directory: the state and hash databases, the input history and
+   * the engine counters. This must run between steps.
+   */
+  void saveCheckpoint(const std::string &dirPath)
+  {
+    _stateDb->saveCheckpoint(dirPath + "/stateDb.bin");
+    _hashDb->saveCheckpoint(dirPath + "/hashDb.bin");
+    if (getInputHistoryLog() != nullptr) getInputHistoryLog()->saveCheckpoint(dirPath + "/inputHistory.bin");
+
+    checkpoint::Writer writer(dirPath + "/engine.bin");
+    writer.push<size_t>(_currentStep);
+    writer.push<size_t>(_checkpointLevel);
+    writer.push<size_t>(_checkpointTolerance);
+    writer.push<size_t>(_checkpointCutoff);
+    writer.push<size_t>(_normalStates);
+    writer.push<size_t>(_repeatedStates);
+    writer.push<size_t>(_failedStates);
+    writer.push<size_t>(_winStates);
+    writer.close();
+  }
+
+  /**
+   * Resumes the search from a checkpoint written by saveCheckpoint. The engine must be initialized and reset first
+   */
+  void loadCheckpoint(const std::string &dirPath)
+  {
+    _stateDb->loadCheckpoint(dirPath + "/stateDb.bin");
+    _hashDb->loadCheckpoint(dirPath + "/hashDb.bin");
+    if (getInputHistoryLog() != nullptr) getInputHistoryLog()->loadCheckpoint(dirPath + "/inputHistory.bin");
+
+    checkpoint::Reader reader(dirPath + "/engine.bin");
+    _currentStep         = reader.pop<size_t>();
+    _checkpointLevel     = reader.pop<size_t>();
+    _checkpointTolerance = reader.pop<size_t>();
+    _checkpointCutoff    = reader.pop<size_t>();
+    _normalStates        = reader.pop<size_t>();
+    _repeatedStates      = reader.pop<size_t>();
+    _failedStates        = reader.pop<size_t>();
+    _winStates           = reader.pop<size_t>();
+  }
+
+  ~Engine()
+  {
+    // Stopping the hash database advance worker, if it was started
+    if (_hashDbAdvanceThread.joinable() == true)
+    {
+      _isHashDbAdvanceWorkerExiting = true;
+      _hashDbAdvanceRequest.release();
+      _hashDbAdvanceThread.join();
+    }
+  }
 
   // Relevant data for the driver
 
   auto &getStateDb() const { return _stateDb; }
   auto  getStepBestWinState() const { return _stepBestWinState; }
-  auto  getWinStatesFound() const { return _winStates.load(); }
+  auto  getWinStatesFound() const { return _winStates; }
   auto  getStateCount() const { return _stateDb->getStateCount(); }
+  auto &getInputHistoryLog() const { return _runners[0]->getInputHistoryLog(); }
 
   /**
    * Information printing function
@@ -288,6 +459,11 @@ class Engine final
   void printInfo()
   {
     // Printing information
+    if (_profilingMode == profilingMode_t::full) jaffarCommon::logger::log("[J+] Profiling Mode:                                Full\n");
+    if (_profilingMode == profilingMode_t::sampled)
+      jaffarCommon::logger::log("[J+] Profiling Mode:                                Sampled (1 in %lu base states, extrapolated)\n", _profilingSampleInterval);
+    if (_profilingMode == profilingMode_t::off) jaffarCommon::logger::log("[J+] Profiling Mode:                                Off\n");
+    jaffarCommon::logger::log("[J+] Initialize Runners From Prototype:           %s\n", _initializeRunnersFromPrototype ? "true" : "false");
     jaffarCommon::logger::log("[J+] Elapsed Time (Step/Total):                  %9.3fs (%7.3f%%) / %9.3fs (%3.3f%%)\n",
                               1.0e-9 * (double)(_currentStepTime),
                               100.0,
@@ -300,6 +476,12 @@ class Engine final
                               1.0e-9 * (double)(_runnerStateAdvanceAverageCumulativeTime),
                               100.0 * ((double)_runnerStateAdvanceAverageCumulativeTime) / (double)(_totalRunningTime));
 
+    jaffarCommon::logger::log("[J+]  + Base State Decode (Step/Total):          %9.3fs (%7.3f%%) / %9.3fs (%3.3f%%)\n",
+                              1.0e-9 * (double)(_baseStateDecodeAverageTime),
+                              100.0 * ((double)(_baseStateDecodeAverageTime) / (double)(_currentStepTime)),
+                              1.0e-9 * (double)(_baseStateDecodeAverageCumulativeTime),
+                              100.0 * ((double)_baseStateDecodeAverageCumulativeTime) / (double)(_totalRunningTime));
+
     jaffarCommon::logger::log("[J+]  + Runner State Load (Step/Total):          %9.3fs (%7.3f%%) / %9.3fs (%3.3f%%)\n",
                               1.0e-9 * (double)(_runnerStateLoadAverageTime),
                               100.0 * ((double)(_runnerStateLoadAverageTime) / (double)(_currentStepTime)),
@@ -366,6 +548,12 @@ class Engine final
                               1.0e-9 * (double)(_advanceStateDbAverageCumulativeTime),
                               100.0 * ((double)_advanceStateDbAverageCumulativeTime) / (double)(_totalRunningTime));
 
+    jaffarCommon::logger::log("[J+]  + Collect Input History (Step/Total):      %9.3fs (%7.3f%%) / %9.3fs (%3.3f%%)\n",
+                              1.0e-9 * (double)(_collectInputHistoryAverageTime),
+                              100.0 * ((double)(_collectInputHistoryAverageTime) / (double)(_currentStepTime)),
+                              1.0e-9 * (double)(_collectInputHistoryAverageCumulativeTime),
+                              100.0 * ((double)_collectInputHistoryAverageCumulativeTime) / (double)(_totalRunningTime));
+
     jaffarCommon::logger::log("[J+] Checkpoint (Level/Tolerance/Cutoff):         %lu / %lu / %lu\n", _checkpointLevel, _checkpointTolerance, _checkpointCutoff);
     jaffarCommon::logger::log("[J+] Base States Processed:                       %.3f Mstates (Total: %.3f Mstates)\n",
                               1.0e-6 * (double)_stepBaseStatesProcessed,
@@ -382,26 +570,26 @@ class Engine final
                               1.0e-6 * (double)_totalNewStatesProcessed / (1.0e-9 * (double)_totalRunningTime));
 
     jaffarCommon::logger::log("[J+] Dropped States (No Storage Available):       %lu (%5.3f%% of New States Processed) \n",
-                              _droppedStatesNoStorage.load(),
-                              100.0 * (double)_droppedStatesNoStorage.load() / (double)_totalNewStatesProcessed);
+                              _droppedStatesNoStorage,
+                              100.0 * (double)_droppedStatesNoStorage / (double)_totalNewStatesProcessed);
     jaffarCommon::logger::log("[J+] Dropped States (Failed Serialization):       %lu (%5.3f%% of New States Processed) \n",
-                              _droppedStatesFailedSerialization.load(),
-                              100.0 * (double)_droppedStatesFailedSerialization.load() / (double)_totalNewStatesProcessed);
+                              _droppedStatesFailedSerialization,
+                              100.0 * (double)_droppedStatesFailedSerialization / (double)_totalNewStatesProcessed);
     jaffarCommon::logger::log("[J+] Dropped States (Checkpoint):                 %lu (%5.3f%% of New States Processed) \n",
-                              _droppedStatesCheckpoint.load(),
-                              100.0 * (double)_droppedStatesCheckpoint.load() / (double)_totalNewStatesProcessed);
+                              _droppedStatesCheckpoint,
+                              100.0 * (double)_droppedStatesCheckpoint / (double)_totalNewStatesProcessed);
     jaffarCommon::logger::log("[J+] Failed States:                               %lu (%5.3f%% of New States Processed) \n",
-                              _failedStates.load(),
-                              100.0 * (double)_failedStates.load() / (double)_totalNewStatesProcessed);
+                              _failedStates,
+                              100.0 * (double)_failedStates / (double)_totalNewStatesProcessed);
     jaffarCommon::logger::log("[J+] Repeated States:                             %lu (%5.3f%% of New States Processed) \n",
-                              _repeatedStates.load(),
-                              100.0 * (double)_repeatedStates.load() / (double)_totalNewStatesProcessed);
+                              _repeatedStates,
+                              100.0 * (double)_repeatedStates / (double)_totalNewStatesProcessed);
     jaffarCommon::logger::log("[J+] Normal States:                               %lu (%5.3f%% of New States Processed) \n",
-                              _normalStates.load(),
-                              100.0 * (double)_normalStates.load() / (double)_totalNewStatesProcessed);
+                              _normalStates,
+                              100.0 * (double)_normalStates / (double)_totalNewStatesProcessed);
     jaffarCommon::logger::log("[J+] Win States:                                  %lu (%5.3f%% of New States Processed) \n",
-                              _winStates.load(),
-                              100.0 * (double)_winStates.load() / (double)_totalNewStatesProcessed);
+                              _winStates,
+                              100.0 * (double)_winStates / (double)_totalNewStatesProcessed);
 
     // Print state database information
     jaffarCommon::logger::log("[J+] State Database Information:\n");
@@ -421,6 +609,24 @@ class Engine final
 
   private:
 
+  /**
+   * Advances the hash database whenever requested at the end of a step, until the engine is destroyed
+   */
+  void hashDbAdvanceWorker()
+  {
+    while (true)
+    {
+      _hashDbAdvanceRequest.acquire();
+      if (_isHashDbAdvanceWorkerExiting == true) return;
+
+      const auto t0 = jaffarCommon::timing::now();
+      _hashDb->advanceStep();
+      _advanceHashDbThreadRawTime += jaffarCommon::timing::timeDeltaNanoseconds(jaffarCommon::timing::now(), t0);
+
+      _hashDbAdvanceCompletion.release();
+    }
+  }
+
   enum inputResult_t
   {
     repeated,
@@ -432,15 +638,102 @@ class Engine final
     win
   };
 
+  /**
+   * Whether (and how often) the worker hot path is timed
+   */
+  enum profilingMode_t
+  {
+    /**
+     * Every operation is timed
+     */
+    full,
+
+    /**
+     * Only one in every '_profilingSampleInterval' base states (and all the inputs tried on it) is timed, and the totals are extrapolated
+     */
+    sampled,
+
+    /**
+     * Timers are compiled out of the worker hot path
+     */
+    off
+  };
+
+  /**
+   * Decides whether the operations on a given base state are to be timed, given the number of base states processed before it
+   */
+  template <profilingMode_t mode>
+  static __INLINE__ bool isBaseStateProfiled(const size_t baseStatesProcessed)
+  {
+    if constexpr (mode == profilingMode_t::full) return true;
+    if constexpr (mode == profilingMode_t::sampled) return baseStatesProcessed % _profilingSampleInterval == 0;
+    if constexpr (mode == profilingMode_t::off) return false;
+  }
+
+  /**
+   * Takes the starting time point for a profiled operation. It does not read the clock if profiling is off or the operation is not sampled
+   */
+  template <profilingMode_t mode>
+  static __INLINE__ auto profilingNow(const bool isProfiled)
+  {
+    decltype(jaffarCommon::timing::now()) timePoint{};
+    if constexpr (mode != profilingMode_t::off)
+      if (isProfiled == true) timePoint = jaffarCommon::timing::now();
+    return timePoint;
+  }
+
+  /**
+   * Adds the time elapsed since the starting time point to the given accumulator, if the operation is profiled
+   */
+  template <profilingMode_t mode, class timePoint_t>
+  static __INLINE__ void profilingAdd(size_t &accumulator, const bool isProfiled, const timePoint_t &timePoint)
+  {
+    if constexpr (mode != profilingMode_t::off)
+      if (isProfiled == true) accumulator += jaffarCommon::timing::timeDeltaNanoseconds(jaffarCommon::timing::now(), timePoint);
+  }
+
   struct winState
   {
     float reward;
     void *stateData;
   };
 
+  /**
+   * Statistics gathered by a single worker thread during a step. Each thread writes only to its own block, which
+   * is padded to a cache line to prevent false sharing. The blocks are reduced into the engine totals after every step.
+   */
+  struct alignas(64) threadStatistics_t
+  {
+    // State counters
+    size_t baseStatesProcessed              = 0;
+    size_t profiledBaseStates               = 0;
+    size_t newStatesProcessed               = 0;
+    size_t normalStates                     = 0;
+    size_t repeatedStates                   = 0;
+    size_t failedStates                     = 0;
+    size_t winStates                        = 0;
+    size_t droppedStatesNoStorage           = 0;
+    size_t droppedStatesFailedSerialization = 0;
+    size_t droppedStatesCheckpoint          = 0;
+
+    // Timing (nanoseconds)
+    size_t baseStateDecodeTime    = 0;
+    size_t runnerStateAdvanceTime = 0;
+    size_t runnerStateLoadTime    = 0;
+    size_t runnerStateSaveTime    = 0;
+    size_t calculateHashTime      = 0;
+    size_t checkHashTime          = 0;
+    size_t ruleCheckingTime       = 0;
+    size_t getFreeStateTime       = 0;
+    size_t returnFreeStateTime    = 0;
+    size_t calculateRewardTime    = 0;
+    size_t popBaseStateDbTime     = 0;
+  };
+
   /**
    * The main worker function -- executes entirely in parallel
    */
+  template <profilingMode_t mode>
   void workerFunction()
   {
     // Getting my thread id
@@ -449,35 +742,46 @@ class Engine final
     // Getting my runner
     auto &r = _runners[threadId];
 
+    // Getting my decoded base state buffer
+    auto rawBaseStateBuffer = _rawBaseStates[threadId].data();
+
+    // Getting my statistics block and clearing it for this step
+    auto &stats = _threadStatistics[threadId];
+    stats       = threadStatistics_t();
+
+    // Determining whether the first base state (including its retrieval) is to be profiled
+    bool isProfiled = isBaseStateProfiled<mode>(stats.baseStatesProcessed);
+
     // Current base state to process
-    const auto t             = jaffarCommon::timing::now();
+    const auto t             = profilingNow<mode>(isProfiled);
     void      *baseStateData = _stateDb->popState();
-    _popBaseStateDbThreadRawTime += jaffarCommon::timing::timeDeltaNanoseconds(jaffarCommon::timing::now(), t);
+    profilingAdd<mode>(stats.popBaseStateDbTime, isProfiled, t);
 
     // While there are still states in the database, keep on grabbing them
     while (baseStateData != nullptr)
     {
-      // Increasing base state counter
-      _stepBaseStatesProcessed++;
+      // Increasing base state counters
+      stats.baseStatesProcessed++;
+      if (isProfiled == true) stats.profiledBaseStates++;
 
-      // Load state into runner via the state database
-      const auto t0 = jaffarCommon::timing::now();
-      _stateDb->loadStateIntoRunner(*r, baseStateData);
-      _runnerStateLoadThreadRawTime += jaffarCommon::timing::timeDeltaNanoseconds(jaffarCommon::timing::now(), t0);
+      // Decoding the base state only once, loading it into the runner and keeping its raw form for the inputs to restore from
+      const auto  t0               = profilingNow<mode>(isProfiled);
+      const void *rawBaseStateData = _stateDb->decodeState(*r, baseStateData, rawBaseStateBuffer);
+      profilingAdd<mode>(stats.baseStateDecodeTime, isProfiled, t0);
 
       // Getting possible inputs
       const auto &possibleInputs = r->getAllowedInputs();
 
       // Trying out each possible input in the set
-      for (auto inputItr = possibleInputs.begin(); inputItr != possibleInputs.end(); inputItr++) runNewInput(*r, baseStateData, *inputItr);
+      for (auto inputItr = possibleInputs.begin(); inputItr != possibleInputs.end(); inputItr++) runNewInput<mode>(*r, stats, isProfiled, rawBaseStateData, *inputItr);
 
       // Getting candidate moves
-      auto candidateInputs = r->getCandidateInputs();
+      const auto &candidateInputs = r->getCandidateInputs();
 
       // Finding unique candidate inputs
       std::vector<InputSet::inputIndex_t> uniqueCandidateInputs;
       for (const auto &input : candidateInputs)
-        if (possibleInputs.contains(input) == false) uniqueCandidateInputs.push_back(input);
+        if (std::binary_search(possibleInputs.begin(), possibleInputs.end(), input) == false) uniqueCandidateInputs.push_back(input);
 
       // Run each candidate input
       for (const auto input : uniqueCandidateInputs)
@@ -490,45 +794,49 @@ class Engine final
           if (_candidateInputsDetected[stateInputHash].contains(input)) continue;
 
         // Running input
-        const auto result = runNewInput(*r, baseStateData, input);
+        const auto result = runNewInput<mode>(*r, stats, isProfiled, rawBaseStateData, input);
 
         // If this is not a repeated state, store it as new candidate input
         if (result != inputResult_t::repeated) _candidateInputsDetected[stateInputHash].insert(input);
       }
 
       // Return base state to the free state queue
-      const auto t8 = jaffarCommon::timing::now();
+      const auto t8 = profilingNow<mode>(isProfiled);
       _stateDb->returnFreeState(baseStateData);
-      _returnFreeStateThreadRawTime += jaffarCommon::timing::timeDeltaNanoseconds(jaffarCommon::timing::now(), t8);
+      profilingAdd<mode>(stats.returnFreeStateTime, isProfiled, t8);
+
+      // Determining whether the next base state is to be profiled
+      isProfiled = isBaseStateProfiled<mode>(stats.baseStatesProcessed);
 
       // Pulling next state from the database
-      const auto t9 = jaffarCommon::timing::now();
+      const auto t9 = profilingNow<mode>(isProfiled);
       baseStateData = _stateDb->popState();
-      _popBaseStateDbThreadRawTime += jaffarCommon::timing::timeDeltaNanoseconds(jaffarCommon::timing::now(), t9);
+      profilingAdd<mode>(stats.popBaseStateDbTime, isProfiled, t9);
     }
   }
 
-  __INLINE__ inputResult_t runNewInput(Runner &r, const void *baseStateData, const InputSet::inputIndex_t input)
+  template <profilingMode_t mode>
+  __INLINE__ inputResult_t runNewInput(Runner &r, threadStatistics_t &stats, const bool isProfiled, const void *rawBaseStateData, const InputSet::inputIndex_t input)
   {
     // Increasing new state counter
-    _stepNewStatesProcessed++;
+    stats.newStatesProcessed++;
 
-    // Re-loading base state
-    const auto t0 = jaffarCommon::timing::now();
-    _stateDb->loadStateIntoRunner(r, baseStateData);
-    _runnerStateLoadThreadRawTime += jaffarCommon::timing::timeDeltaNanoseconds(jaffarCommon::timing::now(), t0);
+    // Re-loading base state from its already decoded (raw) form
+    const auto t0 = profilingNow<mode>(isProfiled);
+    _stateDb->loadRawStateIntoRunner(r, rawBaseStateData);
+    profilingAdd<mode>(stats.runnerStateLoadTime, isProfiled, t0);
 
     // Running input
-    const auto result = runInput(r, input);
+    const auto result = runInput<mode>(r, stats, isProfiled, input);
 
     // Update counters depending on the outcomes
-    if (result == inputResult_t::normal) _normalStates++;
-    if (result == inputResult_t::repeated) _repeatedStates++;
-    if (result == inputResult_t::failed) _failedStates++;
-    if (result == inputResult_t::win) _winStates++;
-    if (result == inputResult_t::droppedNoStorage) _droppedStatesNoStorage++;
-    if (result == inputResult_t::droppedFailedSerialization) _droppedStatesFailedSerialization++;
-    if (result == inputResult_t::droppedCheckpoint) _droppedStatesCheckpoint++;
+    if (result == inputResult_t::normal) stats.normalStates++;
+    if (result == inputResult_t::repeated) stats.repeatedStates++;
+    if (result == inputResult_t::failed) stats.failedStates++;
+    if (result == inputResult_t::win) stats.winStates++;
+    if (result == inputResult_t::droppedNoStorage) stats.droppedStatesNoStorage++;
+    if (result == inputResult_t::droppedFailedSerialization) stats.droppedStatesFailedSerialization++;
+    if (result == inputResult_t::droppedCheckpoint) stats.droppedStatesCheckpoint++;
 
     // Checking whether this state's checkpoint is new
     const auto stateCheckpointLevel     = r.getGame()->getCheckpointLevel();
@@ -544,28 +852,29 @@ class Engine final
     return result;
   }
 
-  __INLINE__ inputResult_t runInput(Runner &r, const InputSet::inputIndex_t input)
+  template <profilingMode_t mode>
+  __INLINE__ inputResult_t runInput(Runner &r, threadStatistics_t &stats, const bool isProfiled, const InputSet::inputIndex_t input)
   {
     // Now advancing state with the provided input
-    const auto t1 = jaffarCommon::timing::now();
+    const auto t1 = profilingNow<mode>(isProfiled);
     r.advanceState(input);
-    _runnerStateAdvanceThreadRawTime += jaffarCommon::timing::timeDeltaNanoseconds(jaffarCommon::timing::now(), t1);
+    profilingAdd<mode>(stats.runnerStateAdvanceTime, isProfiled, t1);
 
     // Computing runner hash
-    const auto t2   = jaffarCommon::timing::now();
+    const auto t2   = profilingNow<mode>(isProfiled);
     const auto hash = r.computeHash();
-    _calculateHashThreadRawTime += jaffarCommon::timing::timeDeltaNanoseconds(jaffarCommon::timing::now(), t2);
+    profilingAdd<mode>(stats.calculateHashTime, isProfiled, t2);
 
     // Checking if hash is repeated (i.e., has been seen before)
-    const auto t3         = jaffarCommon::timing::now();
+    const auto t3         = profilingNow<mode>(isProfiled);
     bool       hashExists = _hashDb->checkHashExists(hash);
-    _checkHashThreadRawTime += jaffarCommon::timing::timeDeltaNanoseconds(jaffarCommon::timing::now(), t3);
+    profilingAdd<mode>(stats.checkHashTime, isProfiled, t3);
 
     // If state is repeated then we are not interested in it, continue
     if (hashExists == true) return inputResult_t::repeated;
 
     // Evaluating game rules based on the new state
-    const auto t4 = jaffarCommon::timing::now();
+    const auto t4 = profilingNow<mode>(isProfiled);
     r.getGame()->evaluateRules();
 
     // Checking whether this state meets checkpoint
@@ -577,31 +886,28 @@ class Engine final
       if (stateCheckpointLevel < _checkpointLevel) return inputResult_t::droppedCheckpoint;
     }
 
-    // Determining state type
-    r.getGame()->updateGameStateType();
-
     // Getting state type
     const auto stateType = r.getGame()->getStateType();
-    _ruleCheckingThreadRawTime += jaffarCommon::timing::timeDeltaNanoseconds(jaffarCommon::timing::now(), t4);
+    profilingAdd<mode>(stats.ruleCheckingTime, isProfiled, t4);
 
     // Now we have determined the state is not repeated, check if it's not a failed state
     if (stateType == Game::stateType_t::fail) return inputResult_t::failed;
 
     // Now that the state is not failed nor repeated, this is effectively a new state to add
-    const auto t5           = jaffarCommon::timing::now();
+    const auto t5           = profilingNow<mode>(isProfiled);
     void      *newStateData = _stateDb->getFreeState();
-    _getFreeStateThreadRawTime += jaffarCommon::timing::timeDeltaNanoseconds(jaffarCommon::timing::now(), t5);
+    profilingAdd<mode>(stats.getFreeStateTime, isProfiled, t5);
 
     // If couldn't get any memory, simply drop the state
     if (newStateData == nullptr) return inputResult_t::droppedNoStorage;
 
     // Updating state reward
-    const auto t6 = jaffarCommon::timing::now();
+    const auto t6 = profilingNow<mode>(isProfiled);
     r.getGame()->updateReward();
 
     // Getting state reward
     const auto reward = r.getGame()->getReward();
-    _calculateRewardThreadRawTime += jaffarCommon::timing::timeDeltaNanoseconds(jaffarCommon::timing::now(), t6);
+    profilingAdd<mode>(stats.calculateRewardTime, isProfiled, t6);
 
     // If this is a win state, register it and return
     if (stateType == Game::stateType_t::win)
@@ -618,9 +924,9 @@ class Engine final
       _stepBestWinStateLock.unlock();
 
       // Freeing up the state data
-      const auto t7 = jaffarCommon::timing::now();
+      const auto t7 = profilingNow<mode>(isProfiled);
       _stateDb->returnFreeState(newStateData);
-      _returnFreeStateThreadRawTime += jaffarCommon::timing::timeDeltaNanoseconds(jaffarCommon::timing::now(), t7);
+      profilingAdd<mode>(stats.returnFreeStateTime, isProfiled, t7);
 
       // Returning a win result
       return inputResult_t::win;
@@ -630,9 +936,9 @@ class Engine final
     if (stateType == Game::stateType_t::normal)
     {
       // If this is a normal state, push into the state database
-      const auto t8      = jaffarCommon::timing::now();
+      const auto t8      = profilingNow<mode>(isProfiled);
       auto       success = _stateDb->pushState(reward, r, newStateData);
-      _runnerStateSaveThreadRawTime += jaffarCommon::timing::timeDeltaNanoseconds(jaffarCommon::timing::now(), t8);
+      profilingAdd<mode>(stats.runnerStateSaveTime, isProfiled, t8);
 
       // Attempting to serialize state and push it into the database
       // This might fail when using differential serialization due to insufficient space for differentials
@@ -640,9 +946,9 @@ class Engine final
       if (success == false)
       {
         // Freeing up state memory
-        const auto t9 = jaffarCommon::timing::now();
+        const auto t9 = profilingNow<mode>(isProfiled);
         _stateDb->returnFreeState(newStateData);
-        _returnFreeStateThreadRawTime += jaffarCommon::timing::timeDeltaNanoseconds(jaffarCommon::timing::now(), t9);
+        profilingAdd<mode>(stats.returnFreeStateTime, isProfiled, t9);
 
         // Returning dropped result by failed serialization
         return inputResult_t::droppedFailedSerialization;
@@ -662,12 +968,24 @@ class Engine final
   // Collection of runners for the workers to use
   std::vector<std::unique_ptr<Runner>> _runners;
 
+  // Per-thread buffers holding the current base state in its decoded (raw) form
+  std::vector<std::vector<uint8_t>> _rawBaseStates;
+
+  // Per-thread statistics blocks, reduced after every step
+  std::vector<threadStatistics_t> _threadStatistics;
+
   // The thread-safe state database that contains current and next step's states.
   std::unique_ptr<jaffarPlus::stateDb::Base> _stateDb;
 
   // The thread-safe hash database to check for repeated states
   std::unique_ptr<jaffarPlus::HashDb> _hashDb;
 
+  // Worker thread advancing the hash database, kept across steps. It is signaled to start advancing (or to exit), and signals back once done
+  std::thread           _hashDbAdvanceThread;
+  std::binary_semaphore _hashDbAdvanceRequest{0};
+  std::binary_semaphore _hashDbAdvanceCompletion{0};
+  bool                  _isHashDbAdvanceWorkerExiting = false;
+
   // Set of win states found
   std::mutex _stepBestWinStateLock;
   winState   _stepBestWinState;
@@ -682,6 +1000,15 @@ class Engine final
   // Thread count (set by openMP)
   size_t _threadCount;
 
+  // Profiling mode for the worker hot path
+  profilingMode_t _profilingMode;
+
+  // Whether runners are initialized as copies of a single runner, rather than each playing the initial sequence
+  bool _initializeRunnersFromPrototype;
+
+  // When profiling is sampled, one in how many base states are timed
+  static constexpr size_t _profilingSampleInterval = 64;
+
   //////////////// Statistics
 
   // Running time of current step
@@ -691,93 +1018,103 @@ class Engine final
   size_t _totalRunningTime;
 
   // Counter for dropped states due to lack of free states
-  std::atomic<size_t> _droppedStatesNoStorage;
+  size_t _droppedStatesNoStorage;
 
   // Counter for dropped states due to failed (differential) serialization
-  std::atomic<size_t> _droppedStatesFailedSerialization;
+  size_t _droppedStatesFailedSerialization;
 
   // Counter for dropped states due to not meeting checkpoint
-  std::atomic<size_t> _droppedStatesCheckpoint;
+  size_t _droppedStatesCheckpoint;
 
   // Counter for repeated states (detected via hash collision)
-  std::atomic<size_t> _repeatedStates;
+  size_t _repeatedStates;
 
   // Counter for failed states (reached a point in the game that is considered a loss)
-  std::atomic<size_t> _failedStates;
+  size_t _failedStates;
 
   // Counter for win states
-  std::atomic<size_t> _winStates;
+  size_t _winStates;
 
   // Counter for normal states
-  std::atomic<size_t> _normalStates;
+  size_t _normalStates;
 
   // Counter for the number of base states processed
-  std::atomic<size_t> _stepBaseStatesProcessed;
-  std::atomic<size_t> _totalBaseStatesProcessed;
+  size_t _stepBaseStatesProcessed;
+  size_t _totalBaseStatesProcessed;
 
   // Counter for the number of new states processed
-  std::atomic<size_t> _stepNewStatesProcessed;
-  std::atomic<size_t> _totalNewStatesProcessed;
+  size_t _stepNewStatesProcessed;
+  size_t _totalNewStatesProcessed;
+
+  // Time spent decoding base states into their raw form
+  size_t _baseStateDecodeThreadRawTime;
+  size_t _baseStateDecodeAverageTime;
+  size_t _baseStateDecodeAverageCumulativeTime;
 
   // Time spent advancing runner state per step
-  std::atomic<size_t> _runnerStateAdvanceThreadRawTime;
-  std::atomic<size_t> _runnerStateAdvanceAverageTime;
-  std::atomic<size_t> _runnerStateAdvanceAverageCumulativeTime;
+  size_t _runnerStateAdvanceThreadRawTime;
+  size_t _runnerStateAdvanceAverageTime;
+  size_t _runnerStateAdvanceAverageCumulativeTime;
 
   // Time spent loading states into the runner
-  std::atomic<size_t> _runnerStateLoadThreadRawTime;
-  std::atomic<size_t> _runnerStateLoadAverageTime;
-  std::atomic<size_t> _runnerStateLoadAverageCumulativeTime;
+  size_t _runnerStateLoadThreadRawTime;
+  size_t _runnerStateLoadAverageTime;
+  size_t _runnerStateLoadAverageCumulativeTime;
 
   // Time spent saving runner states into the state db
-  std::atomic<size_t> _runnerStateSaveThreadRawTime;
-  std::atomic<size_t> _runnerStateSaveAverageTime;
-  std::atomic<size_t> _runnerStateSaveAverageCumulativeTime;
+  size_t _runnerStateSaveThreadRawTime;
+  size_t _runnerStateSaveAverageTime;
+  size_t _runnerStateSaveAverageCumulativeTime;
 
   // Time spent calculating hash
-  std::atomic<size_t> _calculateHashThreadRawTime;
-  std::atomic<size_t> _calculateHashAverageTime;
-  std::atomic<size_t> _calculateHashAverageCumulativeTime;
+  size_t _calculateHashThreadRawTime;
+  size_t _calculateHashAverageTime;
+  size_t _calculateHashAverageCumulativeTime;
 
   // Time spent checking hash
-  std::atomic<size_t> _checkHashThreadRawTime;
-  std::atomic<size_t> _checkHashAverageTime;
-  std::atomic<size_t> _checkHashAverageCumulativeTime;
+  size_t _checkHashThreadRawTime;
+  size_t _checkHashAverageTime;
+  size_t _checkHashAverageCumulativeTime;
 
   // Rule checking time
-  std::atomic<size_t> _ruleCheckingThreadRawTime;
-  std::atomic<size_t> _ruleCheckingAverageTime;
-  std::atomic<size_t> _ruleCheckingAverageCumulativeTime;
+  size_t _ruleCheckingThreadRawTime;
+  size_t _ruleCheckingAverageTime;
+  size_t _ruleCheckingAverageCumulativeTime;
 
   // Get free state time
-  std::atomic<size_t> _getFreeStateThreadRawTime;
-  std::atomic<size_t> _getFreeStateAverageTime;
-  std::atomic<size_t> _getFreeStateAverageCumulativeTime;
+  size_t _getFreeStateThreadRawTime;
+  size_t _getFreeStateAverageTime;
+  size_t _getFreeStateAverageCumulativeTime;
 
   // Return free state time
-  std::atomic<size_t> _returnFreeStateThreadRawTime;
-  std::atomic<size_t> _returnFreeStateAverageTime;
-  std::atomic<size_t> _returnFreeStateAverageCumulativeTime;
+  size_t _returnFreeStateThreadRawTime;
+  size_t _returnFreeStateAverageTime;
+  size_t _returnFreeStateAverageCumulativeTime;
 
   // Reward calculation time
-  std::atomic<size_t> _calculateRewardThreadRawTime;
-  std::atomic<size_t> _calculateRewardAverageTime;
-  std::atomic<size_t> _calculateRewardAverageCumulativeTime;
+  size_t _calculateRewardThreadRawTime;
+  size_t _calculateRewardAverageTime;
+  size_t _calculateRewardAverageCumulativeTime;
 
   // Advance Hash DB time
-  std::atomic<size_t> _advanceHashDbThreadRawTime;
-  std::atomic<size_t> _advanceHashDbAverageTime;
-  std::atomic<size_t> _advanceHashDbAverageCumulativeTime;
+  size_t _advanceHashDbThreadRawTime;
+  size_t _advanceHashDbAverageTime;
+  size_t _advanceHashDbAverageCumulativeTime;
 
   // Advance State DB time
-  std::atomic<size_t> _advanceStateDbThreadRawTime;
-  std::atomic<size_t> _advanceStateDbAverageTime;
-  std::atomic<size_t> _advanceStateDbAverageCumulativeTime;
+  size_t _advanceStateDbThreadRawTime;
+  size_t _advanceStateDbAverageTime;
+  size_t _advanceStateDbAverageCumulativeTime;
+
+  // Input history log collection time
+  size_t _collectInputHistoryThreadRawTime;
+  size_t _collectInputHistoryAverageTime;
+  size_t _collectInputHistoryAverageCumulativeTime;
 
   // Popping states from the State DB time
-  std::atomic<size_t> _popBaseStateDbThreadRawTime;
-  std::atomic<size_t> _popBaseStateDbAverageTime;
-  std::atomic<size_t> _popBaseStateDbAverageCumulativeTime;
+  size_t _popBaseStateDbThreadRawTime;
+  size_t _popBaseStateDbAverageTime;
+  size_t _popBaseStateDbAverageCumulativeTime;
 };
 
 } // namespace jaffarPlus
\ No newline at end of file
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <algorithm>
+#include <cstring>
 #include <map>
 #include <memory>
+#include <set>
 #include <unordered_set>
 #include <utility>
 #include <vector>
@@ -11,6 +14,7 @@
 #include <jaffarCommon/json.hpp>
 #include <jaffarCommon/serializers/base.hpp>
 #include "emulator.hpp"
+#include "hashPolicy/base.hpp"
 #include "rule.hpp"
 
 namespace jaffarPlus
@@ -85,6 +89,12 @@ class Game
       _propertyHashVector.push_back(_propertyMap.at(propertyHash).get());
     }
 
+    // Getting game-specific memory spans to hash
+    registerGameHashSpans();
+
+    // Compiling hashable properties and spans into coalesced memory spans
+    compileHashSpans();
+
     // Now parsing rules
     parseRules(_rulesJs);
 
@@ -95,19 +105,36 @@ class Game
   Game()          = delete;
   virtual ~Game() = default;
 
-  // Function to advance state.
-  __INLINE__ void advanceState(const std::string &input)
+  /**
+   * Registers an input with the emulator, so that it is decoded only once. Returns the handle to advance state with it
+   */
+  __INLINE__ Emulator::inputHandle_t registerInput(const std::string &input)
+  {
+    // Registering input in the emulator
+    const auto inputHandle = _emulator->registerInput(input);
+
+    // Letting the game pre-process the input, if needed
+    registerInputImpl(inputHandle, input);
+
+    return inputHandle;
+  }
+
+  // Function to advance state with a registered input
+  __INLINE__ void advanceState(const Emulator::inputHandle_t inputHandle)
   {
     // Calling the pre-update hook
     stateUpdatePreHook();
 
     // Performing the requested input
-    advanceStateImpl(input);
+    advanceStateImpl(inputHandle);
 
     // Calling the post-update hook
     stateUpdatePostHook();
   }
 
+  // Function to advance state with an input string. The input is registered first, if it wasn't already
+  __INLINE__ void advanceState(const std::string &input) { advanceState(registerInput(input)); }
+
   // Differential serialization routine
   __INLINE__ void serializeState(jaffarCommon::serializer::Base &serializer) const
   {
@@ -160,8 +187,11 @@ class Game
     // Deserializing rules status
     deserializer.popContiguous(_rulesStatus.data(), _rulesStatus.size());
 
-    // Running game specific rule actions
-    runGameSpecificRuleActions();
+    // Taking the snapshot of the watched memory spans, as the rules status corresponds to their current values
+    takeWatchedSpansSnapshot();
+
+    // Running rule actions and restoring the values derived from the satisfied rules
+    updateSatisfiedRules();
 
     // Calling the post-rule update hook
     ruleUpdatePostHook();
@@ -184,10 +214,15 @@ class Game
   }
 
   // This function computes the hash for the current state
-  __INLINE__ void computeHash(MetroHash128 &hashEngine) const
+  __INLINE__ void computeHash(hashPolicy::Base &hashEngine) const
   {
-    // Processing hashable game properties
-    for (const auto &p : _propertyHashVector) hashEngine.Update(p->getPointer(), p->getSize());
+    // Gathering the small hash spans into the scratch buffer, and hashing them with a single call
+    auto gatherBuffer = (uint8_t *)_hashGatherBuffer.data();
+    for (const auto &span : _hashGatheredSpans) std::memcpy(&gatherBuffer[span.gatherOffset], span.pointer, span.size);
+    if (_hashGatherSize > 0) hashEngine.Update(gatherBuffer, _hashGatherSize);
+
+    // Hashing the large spans directly
+    for (const auto &span : _hashDirectSpans) hashEngine.Update(span.pointer, span.size);
 
     // Processing any additional game-specific hash
     computeAdditionalHashing(hashEngine);
@@ -250,122 +285,47 @@ class Game
     printInfoImpl();
   }
 
-  // Evaluates the rule set on a given frame. Returns true if it is a fail.
+  // Evaluates the rule set on a given frame. This also determines the state type, checkpoint level and rule reward
   __INLINE__ void evaluateRules()
   {
     // Calling the pre-update hook
     ruleUpdatePreHook();
 
-    // Second, check which unsatisfied rules have been satisfied now
-    for (auto &entry : _rules)
-    {
-      // Getting rule
-      auto &rule = *entry.second;
+    // Determining which of the watched memory spans changed since the rules were last evaluated or the state was loaded
+    updateWatchedSpans();
 
-      // Getting rule index
-      const auto ruleIdx = rule.getIndex();
+    // First, check which unsatisfied rules have been satisfied now
+    for (size_t i = 0; i < _compiledRules.size(); i++)
+    {
+      // Getting compiled rule
+      const auto &rule = _compiledRules[i];
 
-      // Evaluate rule only if it's not yet satisfied
-      if (jaffarCommon::bitwise::getBitValue(_rulesStatus.data(), ruleIdx) == false)
+      // Evaluate rule only if it's not yet satisfied and any of the memory it reads has changed.
+      // An unsatisfied rule whose memory is unchanged is known to still evaluate to false.
+      if (jaffarCommon::bitwise::getBitValue(_rulesStatus.data(), rule.statusIdx) == false && isCompiledRuleAffected(rule))
       {
         // Checking if conditions are met
-        bool isSatisfied = rule.evaluate();
+        bool isSatisfied = evaluateCompiledRule(rule);
 
-        // If it's achieved, update its status and run its actions
-        if (isSatisfied) satisfyRule(rule);
+        // If it's achieved, update its status and that of the rules it satisfies
+        if (isSatisfied) satisfyRule(i);
       }
     }
 
-    // Running game-specific rule actions
-    runGameSpecificRuleActions();
+    // Then, run actions and gather state type, checkpoint and reward from the satisfied rules in a single pass
+    updateSatisfiedRules();
 
-    // Calling the pre-update hook
+    // Calling the post-update hook
     ruleUpdatePostHook();
   }
 
-  __INLINE__ void runGameSpecificRuleActions()
-  {
-    // First, checking if the rules have been satisfied
-    for (auto &entry : _rules)
-    {
-      // Getting rule
-      auto &rule = *entry.second;
-
-      // Getting rule index
-      const auto ruleIdx = rule.getIndex();
-
-      // Run ations only if rule is satisfied
-      if (jaffarCommon::bitwise::getBitValue(_rulesStatus.data(), ruleIdx) == true)
-        for (const auto &action : rule.getActions()) action();
-    }
-  }
-
-  __INLINE__ void updateGameStateType()
-  {
-    // Clearing game state type before we evaluate satisfied rules
-    _stateType = stateType_t::normal;
-
-    // Clearing checkpoint level and tolerance
-    _checkpointLevel = 0;
-
-    // Second, we run the specified actions for the satisfied rules in label order
-    for (auto &entry : _rules)
-    {
-      // Getting rule
-      auto &rule = *entry.second;
-
-      // Getting rule index
-      const auto ruleIdx = rule.getIndex();
-
-      // Run actions
-      if (jaffarCommon::bitwise::getBitValue(_rulesStatus.data(), ruleIdx) == true)
-      {
-        // Modify game state, depending on rule type
-
-        // Evaluate checkpoint rule and store tolerance if specified
-        if (rule.isCheckpointRule())
-        {
-          _checkpointLevel++;
-          _checkpointTolerance = rule.getCheckpointTolerance();
-        }
-
-        // Winning in the same rule superseeds checkpoint, and failing superseed everything
-        if (rule.isWinRule()) _stateType = stateType_t::win;
-        if (rule.isFailRule()) _stateType = stateType_t::fail;
-      }
-    }
-  }
-
   __INLINE__ void updateReward()
   {
-    // First, we resetting reward to zero
-    _reward = 0.0;
-
-    // Second, we get the reward from every satisfied rule
-    for (auto &entry : _rules)
-    {
-      // Getting rule
-      auto &rule = *entry.second;
-
-      // Getting rule index
-      const auto ruleIdx = rule.getIndex();
-
-      // Run actions
-      if (jaffarCommon::bitwise::getBitValue(_rulesStatus.data(), ruleIdx) == true)
-      {
-        // Getting reward from satisfied rule
-        const auto ruleReward = rule.getReward();
-
-        // Adding it to the state reward
-        _reward += ruleReward;
-      }
-    }
-
-    // Adding any game-specific rewards
-    _reward += calculateGameSpecificReward();
+    // The state reward is that of the satisfied rules, plus any game-specific rewards
+    _reward = _satisfiedRulesReward + calculateGameSpecificReward();
   }
 
-  std::unique_ptr<Condition> parseCondition(const nlohmann::json &conditionJs)
+  Condition parseCondition(const nlohmann::json &conditionJs)
   {
     // Parsing operator name
     const auto &opName = jaffarCommon::json::getString(conditionJs, "Op");
@@ -396,19 +356,19 @@ class Game
     // If value is a number, take it as immediate
     if (conditionJs["Value"].is_number())
     {
-      if (datatype1 == Property::datatype_t::dt_uint8) return std::make_unique<_vCondition<uint8_t>>(opType, property1, nullptr, 0, conditionJs["Value"].get<uint8_t>());
-      if (datatype1 == Property::datatype_t::dt_uint16) return std::make_unique<_vCondition<uint16_t>>(opType, property1, nullptr, 0, conditionJs["Value"].get<uint16_t>());
-      if (datatype1 == Property::datatype_t::dt_uint32) return std::make_unique<_vCondition<uint32_t>>(opType, property1, nullptr, 0, conditionJs["Value"].get<uint32_t>());
-      if (datatype1 == Property::datatype_t::dt_uint64) return std::make_unique<_vCondition<uint64_t>>(opType, property1, nullptr, 0, conditionJs["Value"].get<uint64_t>());
-
-      if (datatype1 == Property::datatype_t::dt_int8) return std::make_unique<_vCondition<int8_t>>(opType, property1, nullptr, 0, conditionJs["Value"].get<int8_t>());
-      if (datatype1 == Property::datatype_t::dt_int16) return std::make_unique<_vCondition<int16_t>>(opType, property1, nullptr, 0, conditionJs["Value"].get<int16_t>());
-      if (datatype1 == Property::datatype_t::dt_int32) return std::make_unique<_vCondition<int32_t>>(opType, property1, nullptr, 0, conditionJs["Value"].get<int32_t>());
-      if (datatype1 == Property::datatype_t::dt_int64) return std::make_unique<_vCondition<int64_t>>(opType, property1, nullptr, 0, conditionJs["Value"].get<int64_t>());
-
-      if (datatype1 == Property::datatype_t::dt_float32) return std::make_unique<_vCondition<float>>(opType, property1, nullptr, 0, conditionJs["Value"].get<float>());
-      if (datatype1 == Property::datatype_t::dt_float64) return std::make_unique<_vCondition<double>>(opType, property1, nullptr, 0, conditionJs["Value"].get<double>());
-      if (datatype1 == Property::datatype_t::dt_bool) return std::make_unique<_vCondition<bool>>(opType, property1, nullptr, 0, conditionJs["Value"].get<bool>());
+      if (datatype1 == Property::datatype_t::dt_uint8) return Condition::createImmediate<uint8_t>(opType, property1, conditionJs["Value"].get<uint8_t>());
+      if (datatype1 == Property::datatype_t::dt_uint16) return Condition::createImmediate<uint16_t>(opType, property1, conditionJs["Value"].get<uint16_t>());
+      if (datatype1 == Property::datatype_t::dt_uint32) return Condition::createImmediate<uint32_t>(opType, property1, conditionJs["Value"].get<uint32_t>());
+      if (datatype1 == Property::datatype_t::dt_uint64) return Condition::createImmediate<uint64_t>(opType, property1, conditionJs["Value"].get<uint64_t>());
+
+      if (datatype1 == Property::datatype_t::dt_int8) return Condition::createImmediate<int8_t>(opType, property1, conditionJs["Value"].get<int8_t>());
+      if (datatype1 == Property::datatype_t::dt_int16) return Condition::createImmediate<int16_t>(opType, property1, conditionJs["Value"].get<int16_t>());
+      if (datatype1 == Property::datatype_t::dt_int32) return Condition::createImmediate<int32_t>(opType, property1, conditionJs["Value"].get<int32_t>());
+      if (datatype1 == Property::datatype_t::dt_int64) return Condition::createImmediate<int64_t>(opType, property1, conditionJs["Value"].get<int64_t>());
+
+      if (datatype1 == Property::datatype_t::dt_float32) return Condition::createImmediate<float>(opType, property1, conditionJs["Value"].get<float>());
+      if (datatype1 == Property::datatype_t::dt_float64) return Condition::createImmediate<double>(opType, property1, conditionJs["Value"].get<double>());
+      if (datatype1 == Property::datatype_t::dt_bool) return Condition::createImmediate<bool>(opType, property1, conditionJs["Value"].get<bool>());
     }
 
     // If value is a string, take value as property number 2
@@ -426,24 +386,21 @@ class Game
       // Getting property object
       const auto property2 = _propertyMap[property2NameHash].get();
 
-      if (datatype1 == Property::datatype_t::dt_uint8) return std::make_unique<_vCondition<uint8_t>>(opType, property1, property2, 0, 0);
-      if (datatype1 == Property::datatype_t::dt_uint16) return std::make_unique<_vCondition<uint16_t>>(opType, property1, property2, 0, 0);
-      if (datatype1 == Property::datatype_t::dt_uint32) return std::make_unique<_vCondition<uint32_t>>(opType, property1, property2, 0, 0);
-      if (datatype1 == Property::datatype_t::dt_uint64) return std::make_unique<_vCondition<uint64_t>>(opType, property1, property2, 0, 0);
-
-      if (datatype1 == Property::datatype_t::dt_int8) return std::make_unique<_vCondition<int8_t>>(opType, property1, property2, 0, 0);
-      if (datatype1 == Property::datatype_t::dt_int16) return std::make_unique<_vCondition<int16_t>>(opType, property1, property2, 0, 0);
-      if (datatype1 == Property::datatype_t::dt_int32) return std::make_unique<_vCondition<int32_t>>(opType, property1, property2, 0, 0);
-      if (datatype1 == Property::datatype_t::dt_int64) return std::make_unique<_vCondition<int64_t>>(opType, property1, property2, 0, 0);
-
-      if (datatype1 == Property::datatype_t::dt_float32) return std::make_unique<_vCondition<float>>(opType, property1, property2, 0, 0);
-      if (datatype1 == Property::datatype_t::dt_float64) return std::make_unique<_vCondition<double>>(opType, property1, property2, 0, 0);
-      if (datatype1 == Property::datatype_t::dt_bool) return std::make_unique<_vCondition<bool>>(opType, property1, property2, 0, 0);
+      // Both operands are read with the first property's datatype
+      return Condition::createProperty(opType, property1, property2);
     }
 
     JAFFAR_THROW_LOGIC("[ERROR] Rule contains an invalid 'Value' key.\n", conditionJs["Value"].dump().c_str());
   }
 
+  // Returns pointer to a registered property, by name
+  __INLINE__ const Property *getProperty(const std::string &propertyName) const
+  {
+    const auto propertyNameHash = jaffarCommon::hash::hashString(propertyName);
+    if (_propertyMap.contains(propertyNameHash) == false) JAFFAR_THROW_LOGIC("[ERROR] Property '%s' has not been declared.\n", propertyName.c_str());
+    return _propertyMap.at(propertyNameHash).get();
+  }
+
   // Returns pointer to the internal emulator
   __INLINE__ Emulator *getEmulator() const { return _emulator.get(); }
 
@@ -492,6 +449,41 @@ class Game
     _propertyMap[propertyNameHash] = std::move(property);
   }
 
+  // Registers a game-specific memory span to be hashed. Must be called from registerGameHashSpans
+  void registerHashSpan(const void *pointer, const size_t size) { _hashSpanRanges.push_back({(uintptr_t)pointer, (uintptr_t)pointer + size}); }
+
+  // Sorts the hashable property and game-specific memory ranges, and merges them into contiguous spans
+  void compileHashSpans()
+  {
+    // Adding the memory of the hashable properties
+    for (const auto &p : _propertyHashVector) _hashSpanRanges.push_back({(uintptr_t)p->getPointer(), (uintptr_t)p->getPointer() + p->getSize()});
+
+    // Sorting ranges by address, so that overlapping or adjacent ones can be merged
+    std::sort(_hashSpanRanges.begin(), _hashSpanRanges.end());
+
+    // Creating spans. Small ones are gathered into the scratch buffer, large ones are hashed directly
+    _hashGatheredSpans.clear();
+    _hashDirectSpans.clear();
+    _hashGatherSize = 0;
+    for (size_t i = 0; i < _hashSpanRanges.size();)
+    {
+      auto start = _hashSpanRanges[i].first;
+      auto end   = _hashSpanRanges[i].second;
+      for (i++; i < _hashSpanRanges.size() && _hashSpanRanges[i].first <= end; i++) end = std::max(end, _hashSpanRanges[i].second);
+
+      const auto span = hashSpan_t{.pointer = (const uint8_t *)start, .size = end - start, .gatherOffset = _hashGatherSize};
+      if (span.size > _hashGatherMaxSpanSize) _hashDirectSpans.push_back(span);
+      if (span.size <= _hashGatherMaxSpanSize)
+      {
+        _hashGatheredSpans.push_back(span);
+        _hashGatherSize += span.size;
+      }
+    }
+
+    // Allocating scratch buffer, in whole cache lines
+    _hashGatherBuffer.resize((_hashGatherSize + sizeof(hashGatherBlock_t) - 1) / sizeof(hashGatherBlock_t));
+  }
+
   // Parsing game rules
   void parseRules(const nlohmann::json &rulesJson)
   {
@@ -531,6 +523,109 @@ class Game
 
     // Clearing the status vector evaluation
     for (size_t i = 0; i < _rules.size(); i++) jaffarCommon::bitwise::setBitValue(_rulesStatus.data(), i, false);
+
+    // Compiling the parsed rules into flat arrays for evaluation
+    compileRules();
+  }
+
+  // Flattens the parsed rules (in label order) and their conditions into contiguous arrays, so that they can be evaluated without indirection
+  void compileRules()
+  {
+    // Reset the compiled rule containers
+    _compiledRules.clear();
+    _compiledConditions.clear();
+    _compiledSatisfyRules.clear();
+    _compiledRuleWatchedSpans.clear();
+
+    // Determining the memory spans read by the rule conditions
+    compileWatchedSpans();
+
+    // Assigning each rule its position in the compiled array, following label order
+    std::map<Rule::label_t, uint32_t> rulePositions;
+    uint32_t                          rulePosition = 0;
+    for (const auto &entry : _rules) rulePositions[entry.first] = rulePosition++;
+
+    for (const auto &entry : _rules)
+    {
+      // Getting rule
+      const auto &rule = *entry.second;
+
+      // Creating compiled rule record
+      compiledRule_t compiledRule;
+      compiledRule.statusIdx           = rule.getIndex();
+      compiledRule.conditionOffset     = _compiledConditions.size();
+      compiledRule.conditionCount      = rule.getConditions().size();
+      compiledRule.satisfyRuleOffset   = _compiledSatisfyRules.size();
+      compiledRule.satisfyRuleCount    = rule.getSatisfyRuleLabels().size();
+      compiledRule.watchedSpanOffset   = _compiledRuleWatchedSpans.size();
+      compiledRule.reward              = rule.getReward();
+      compiledRule.isWinRule           = rule.isWinRule();
+      compiledRule.isFailRule          = rule.isFailRule();
+      compiledRule.isCheckpointRule    = rule.isCheckpointRule();
+      compiledRule.checkpointTolerance = rule.getCheckpointTolerance();
+      compiledRule.actions             = &rule.getActions();
+
+      // Appending its conditions and the positions of the rules it satisfies
+      for (const auto &condition : rule.getConditions()) _compiledConditions.push_back(condition);
+      for (const auto &label : rule.getSatisfyRuleLabels()) _compiledSatisfyRules.push_back(rulePositions.at(label));
+
+      // Appending the watched spans read by its conditions, without repetitions
+      std::set<uint32_t> ruleSpans;
+      for (const auto &condition : rule.getConditions())
+      {
+        ruleSpans.insert(getWatchedSpanIndex(condition.getOperand1Pointer()));
+        if (condition.getOperand2Pointer() != nullptr) ruleSpans.insert(getWatchedSpanIndex(condition.getOperand2Pointer()));
+      }
+      for (const auto spanIdx : ruleSpans) _compiledRuleWatchedSpans.push_back(spanIdx);
+      compiledRule.watchedSpanCount = ruleSpans.size();
+
+      _compiledRules.push_back(compiledRule);
+    }
+  }
+
+  // Gathers the memory read by all rule conditions and coalesces it into contiguous spans, each with its place in the snapshot buffer
+  void compileWatchedSpans()
+  {
+    // Getting the address range read by every operand
+    std::vector<std::pair<uintptr_t, uintptr_t>> ranges;
+    for (const auto &entry : _rules)
+      for (const auto &condition : entry.second->getConditions())
+      {
+        const auto operandSize = condition.getOperandSize();
+        ranges.push_back({(uintptr_t)condition.getOperand1Pointer(), (uintptr_t)condition.getOperand1Pointer() + operandSize});
+        if (condition.getOperand2Pointer() != nullptr) ranges.push_back({(uintptr_t)condition.getOperand2Pointer(), (uintptr_t)condition.getOperand2Pointer() + operandSize});
+      }
+
+    // Sorting ranges by address, so that overlapping or adjacent ones can be merged
+    std::sort(ranges.begin(), ranges.end());
+
+    // Creating spans
+    _watchedSpans.clear();
+    size_t snapshotSize = 0;
+    for (size_t i = 0; i < ranges.size();)
+    {
+      auto start = ranges[i].first;
+      auto end   = ranges[i].second;
+      for (i++; i < ranges.size() && ranges[i].first <= end; i++) end = std::max(end, ranges[i].second);
+
+      _watchedSpans.push_back(watchedSpan_t{.pointer = (const uint8_t *)start, .snapshotOffset = snapshotSize, .size = end - start});
+      snapshotSize += end - start;
+    }
+
+    // Allocating snapshot and span change flags. The snapshot is not valid until a state is loaded or the rules are evaluated
+    _watchedSpansSnapshot.resize(snapshotSize);
+    _watchedSpanChanged.resize(_watchedSpans.size());
+    _isWatchedSpansSnapshotValid = false;
+  }
+
+  // Finds the watched span that contains the given address
+  uint32_t getWatchedSpanIndex(const void *pointer) const
+  {
+    const auto address = (uintptr_t)pointer;
+    for (uint32_t i = 0; i < _watchedSpans.size(); i++)
+      if (address >= (uintptr_t)_watchedSpans[i].pointer && address < (uintptr_t)_watchedSpans[i].pointer + _watchedSpans[i].size) return i;
+
+    JAFFAR_THROW_LOGIC("[ERROR] Condition operand address %p is not within any watched span\n", pointer);
   }
 
   // Individual rule parser
@@ -605,41 +700,139 @@ class Game
     if (recognizedActionType == false) JAFFAR_THROW_LOGIC("[ERROR] Unrecognized action '%s' in rule %lu\n", actionType.c_str(), rule.getLabel());
   }
 
-  // Marks the given rule as satisfied, executes its actions, and recursively runs on its sub-satisfied rules
-  __INLINE__ void satisfyRule(Rule &rule)
+  // Flat record of a rule, as compiled for evaluation
+  struct compiledRule_t
   {
-    // Recursively run actions for the yet unsatisfied rules that are satisfied by this one and mark them as satisfied
-    for (const auto &satisfyRuleLabel : rule.getSatisfyRuleLabels())
+    // Position of the rule in the status vector
+    size_t statusIdx;
+
+    // Range of its conditions in the compiled condition array
+    uint32_t conditionOffset;
+    uint32_t conditionCount;
+
+    // Range of the rules it satisfies in the compiled satisfy array
+    uint32_t satisfyRuleOffset;
+    uint32_t satisfyRuleCount;
+
+    // Range of the memory spans its conditions read, in the compiled rule watched span array
+    uint32_t watchedSpanOffset;
+    uint32_t watchedSpanCount;
+
+    // Effects of meeting this rule
+    float  reward;
+    bool   isWinRule;
+    bool   isFailRule;
+    bool   isCheckpointRule;
+    size_t checkpointTolerance;
+
+    // Game-specific actions, owned by the parsed rule
+    const std::vector<std::function<void()>> *actions;
+  };
+
+  // Compares the watched spans against the snapshot, flagging those that changed and updating the snapshot with their current values
+  __INLINE__ void updateWatchedSpans()
+  {
+    for (size_t i = 0; i < _watchedSpans.size(); i++)
     {
-      // Making sure referenced label exists
-      auto it = _rules.find(satisfyRuleLabel);
-      if (it == _rules.end()) JAFFAR_THROW_LOGIC("[ERROR] Unrecognized rule label %lu in satisfy array\n", satisfyRuleLabel);
-      auto &subRule = it->second;
+      const auto &span     = _watchedSpans[i];
+      const auto  snapshot = &_watchedSpansSnapshot[span.snapshotOffset];
+
+      _watchedSpanChanged[i] = _isWatchedSpansSnapshotValid == false || std::memcmp(snapshot, span.pointer, span.size) != 0;
+      if (_watchedSpanChanged[i]) std::memcpy(snapshot, span.pointer, span.size);
+    }
+
+    _isWatchedSpansSnapshotValid = true;
+  }
+
+  // Stores the current values of the watched spans as the snapshot
+  __INLINE__ void takeWatchedSpansSnapshot()
+  {
+    for (const auto &span : _watchedSpans) std::memcpy(&_watchedSpansSnapshot[span.snapshotOffset], span.pointer, span.size);
+    _isWatchedSpansSnapshotValid = true;
+  }
 
-      // Getting index from the subrule
-      auto subRuleIdx = subRule->getIndex();
+  // Checks whether any of the memory read by a compiled rule has changed. Rules that read no memory are always evaluated
+  __INLINE__ bool isCompiledRuleAffected(const compiledRule_t &rule) const
+  {
+    if (rule.watchedSpanCount == 0) return true;
+    for (uint32_t i = 0; i < rule.watchedSpanCount; i++)
+      if (_watchedSpanChanged[_compiledRuleWatchedSpans[rule.watchedSpanOffset + i]]) return true;
+    return false;
+  }
+
+  // Checks whether all the conditions of a compiled rule are met
+  __INLINE__ bool evaluateCompiledRule(const compiledRule_t &rule) const
+  {
+    const auto conditions = &_compiledConditions[rule.conditionOffset];
+    for (uint32_t i = 0; i < rule.conditionCount; i++)
+      if (conditions[i].evaluate() == false) return false;
+    return true;
+  }
+
+  // Marks the given compiled rule as satisfied, and recursively does so for its sub-satisfied rules
+  __INLINE__ void satisfyRule(const size_t rulePosition)
+  {
+    // Getting compiled rule
+    const auto &rule = _compiledRules[rulePosition];
+
+    // Setting status to satisfied
+    jaffarCommon::bitwise::setBitValue(_rulesStatus.data(), rule.statusIdx, true);
+
+    // Recursively mark the yet unsatisfied rules that are satisfied by this one
+    for (uint32_t i = 0; i < rule.satisfyRuleCount; i++)
+    {
+      // Getting position of the subrule
+      const auto subRulePosition = _compiledSatisfyRules[rule.satisfyRuleOffset + i];
 
       // Only activate it if it hasn't been activated before
-      if (jaffarCommon::bitwise::getBitValue(_rulesStatus.data(), subRuleIdx) == false) satisfyRule(*subRule);
+      if (jaffarCommon::bitwise::getBitValue(_rulesStatus.data(), _compiledRules[subRulePosition].statusIdx) == false) satisfyRule(subRulePosition);
     }
+  }
 
-    // Getting rule index
-    const auto ruleIdx = rule.getIndex();
+  // Runs the actions of the satisfied rules in label order, while determining the state type, checkpoint level and rule reward
+  __INLINE__ void updateSatisfiedRules()
+  {
+    // Clearing game state type, checkpoint level and reward before we evaluate satisfied rules
+    _stateType            = stateType_t::normal;
+    _checkpointLevel      = 0;
+    _satisfiedRulesReward = 0.0;
 
-    // Setting status to satisfied
-    jaffarCommon::bitwise::setBitValue(_rulesStatus.data(), ruleIdx, true);
+    for (const auto &rule : _compiledRules)
+    {
+      // Skip rule if not satisfied
+      if (jaffarCommon::bitwise::getBitValue(_rulesStatus.data(), rule.statusIdx) == false) continue;
+
+      // Running game-specific actions
+      for (const auto &action : *rule.actions) action();
+
+      // Evaluate checkpoint rule and store tolerance if specified
+      if (rule.isCheckpointRule)
+      {
+        _checkpointLevel++;
+        _checkpointTolerance = rule.checkpointTolerance;
+      }
+
+      // Winning in the same rule superseeds checkpoint, and failing superseed everything
+      if (rule.isWinRule) _stateType = stateType_t::win;
+      if (rule.isFailRule) _stateType = stateType_t::fail;
+
+      // Adding its reward
+      _satisfiedRulesReward += rule.reward;
+    }
   }
 
   virtual void  registerGameProperties()                                                                       = 0;
   virtual void  serializeStateImpl(jaffarCommon::serializer::Base &serializer) const                           = 0;
   virtual void  deserializeStateImpl(jaffarCommon::deserializer::Base &deserializer)                           = 0;
   virtual float calculateGameSpecificReward() const                                                            = 0;
-  virtual void  computeAdditionalHashing(MetroHash128 &hashEngine) const                                       = 0;
+  virtual void  computeAdditionalHashing(hashPolicy::Base &hashEngine) const                                   = 0;
   virtual void  printInfoImpl() const                                                                          = 0;
-  virtual void  advanceStateImpl(const std::string &input)                                                     = 0;
+  virtual void  advanceStateImpl(const Emulator::inputHandle_t inputHandle)                                    = 0;
   virtual bool  parseRuleActionImpl(Rule &rule, const std::string &actionType, const nlohmann::json &actionJs) = 0;
 
   // Optional hooks
+  virtual __INLINE__ void registerGameHashSpans(){};
+  virtual __INLINE__ void registerInputImpl(const Emulator::inputHandle_t inputHandle, const std::string &input){};
   virtual __INLINE__ void stateUpdatePreHook(){};
   virtual __INLINE__ void stateUpdatePostHook(){};
   virtual __INLINE__ void ruleUpdatePreHook(){};
@@ -651,6 +844,9 @@ class Game
   // Current game state reward
   float _reward = 0.0;
 
+  // Reward accumulated from the currently satisfied rules
+  float _satisfiedRulesReward = 0.0;
+
   // Represents the current state's checkpoint level
   size_t _checkpointLevel = 0;
 
@@ -666,6 +862,43 @@ class Game
   // Storage for status vector indicating whether the rules have been satisfied
   std::vector<uint8_t> _rulesStatus;
 
+  // Compiled rules, in label order
+  std::vector<compiledRule_t> _compiledRules;
+
+  // Conditions of all compiled rules, stored contiguously
+  std::vector<Condition> _compiledConditions;
+
+  // Positions (in the compiled rule array) of the rules satisfied by each compiled rule
+  std::vector<uint32_t> _compiledSatisfyRules;
+
+  // Indexes of the watched spans read by each compiled rule
+  std::vector<uint32_t> _compiledRuleWatchedSpans;
+
+  // Contiguous memory span read by rule conditions
+  struct watchedSpan_t
+  {
+    // Start of the span in memory
+    const uint8_t *pointer;
+
+    // Position of the span's copy in the snapshot buffer
+    size_t snapshotOffset;
+
+    // Size of the span in bytes
+    size_t size;
+  };
+
+  // Coalesced memory spans read by the rule conditions, sorted by address
+  std::vector<watchedSpan_t> _watchedSpans;
+
+  // Copy of the watched spans' values at the last time the rules status was known to correspond to them
+  std::vector<uint8_t> _watchedSpansSnapshot;
+
+  // Per-span flag indicating whether it changed in the latest rule evaluation
+  std::vector<uint8_t> _watchedSpanChanged;
+
+  // Whether the snapshot holds valid values
+  bool _isWatchedSpansSnapshotValid = false;
+
   // Storage for the parse property names that are meant to be printed
   std::vector<std::string> _printablePropertyNames;
 
@@ -675,6 +908,43 @@ class Game
   // Property hash set to quickly distinguish states from each other. Its a vector to keep the ordering
   std::vector<const Property *> _propertyHashVector;
 
+  // Address ranges to hash, as registered by hashable properties and the game
+  std::vector<std::pair<uintptr_t, uintptr_t>> _hashSpanRanges;
+
+  // Contiguous memory span to hash
+  struct hashSpan_t
+  {
+    // Start of the span in memory
+    const uint8_t *pointer;
+
+    // Size of the span in bytes
+    size_t size;
+
+    // Position of the span in the scratch buffer, if gathered
+    size_t gatherOffset;
+  };
+
+  // Spans up to this size are gathered into the scratch buffer. Larger ones are hashed in place
+  static constexpr size_t _hashGatherMaxSpanSize = 256;
+
+  // Spans gathered into the scratch buffer before hashing, sorted by address
+  std::vector<hashSpan_t> _hashGatheredSpans;
+
+  // Spans hashed directly, sorted by address
+  std::vector<hashSpan_t> _hashDirectSpans;
+
+  // Cache-line aligned block of the scratch buffer
+  struct alignas(64) hashGatherBlock_t
+  {
+    uint8_t data[64];
+  };
+
+  // Scratch buffer where the small spans are gathered. Each game instance belongs to a single thread, so it is not shared
+  mutable std::vector<hashGatherBlock_t> _hashGatherBuffer;
+
+  // Number of bytes gathered into the scratch buffer
+  size_t _hashGatherSize = 0;
+
   // Property print vector for printing game information to screen. Its a vector to keep the ordering
   std::vector<const Property *> _propertyPrintVector;
 
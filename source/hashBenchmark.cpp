@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+#include <argparse/argparse.hpp>
+#include <jaffarCommon/file.hpp>
+#include <jaffarCommon/hash.hpp>
+#include <jaffarCommon/logger.hpp>
+#include <jaffarCommon/timing.hpp>
+#include "hashPolicy/metroHash128.hpp"
+#include "hashPolicy/wideLane.hpp"
+#include "hashPolicy/xxh3.hpp"
+
+// Hashes the given data repeatedly with a hash policy, and reports its throughput
+template <class hashPolicy_t>
+void runBenchmark(const std::string &policyName, const std::string &data, const size_t iterations)
+{
+  // Storage for the resulting hash
+  jaffarCommon::hash::hash_t hash;
+
+  const auto t0 = jaffarCommon::timing::now();
+  for (size_t i = 0; i < iterations; i++)
+  {
+    // Compiler barrier, so that the hash is not computed only once for the whole loop
+    asm volatile("" : : "r"(data.data()) : "memory");
+
+    hashPolicy_t hashEngine;
+    hashEngine.Update(data.data(), data.size());
+    hash = hashEngine.Finalize();
+  }
+  const auto elapsedNanoseconds = jaffarCommon::timing::timeDeltaNanoseconds(jaffarCommon::timing::now(), t0);
+
+  // Reporting results
+  const double nanosecondsPerHash = (double)elapsedNanoseconds / (double)iterations;
+  const double gigabytesPerSecond = (double)data.size() / nanosecondsPerHash;
+  jaffarCommon::logger::log("[J+]    + %-14s %10.2f ns/hash  %8.3f GB/s  (Hash: %s)\n",
+                            policyName.c_str(),
+                            nanosecondsPerHash,
+                            gigabytesPerSecond,
+                            jaffarCommon::hash::hashToString(hash).c_str());
+}
+
+// Stripe size to check permutations of, the widest block any of the hash policies consumes at a time
+constexpr size_t permutationStripeSize = 64;
+
+// Maximum number of leading stripes whose pairwise swaps are checked
+constexpr size_t permutationMaxStripes = 32;
+
+// Hashes the given data with every pair of its leading 64-byte stripes swapped, and fails if any swap does not change the hash.
+// States differing only by the order of some blocks (e.g., swapped object slots) would otherwise be taken as already seen
+template <class hashPolicy_t>
+void checkStripePermutations(const std::string &policyName, const std::string &data)
+{
+  const auto computeHash = [](const std::string &input)
+  {
+    hashPolicy_t hashEngine;
+    hashEngine.Update(input.data(), input.size());
+    return hashEngine.Finalize();
+  };
+
+  const auto   originalHash = computeHash(data);
+  const size_t stripeCount  = std::min(data.size() / permutationStripeSize, permutationMaxStripes);
+  size_t       checkCount   = 0;
+  size_t       collisions   = 0;
+
+  std::string permutedData = data;
+  for (size_t i = 0; i < stripeCount; i++)
+    for (size_t j = i + 1; j < stripeCount; j++)
+    {
+      // Swapping identical stripes does not change the data
+      if (data.compare(i * permutationStripeSize, permutationStripeSize, data, j * permutationStripeSize, permutationStripeSize) == 0) continue;
+
+      std::swap_ranges(&permutedData[i * permutationStripeSize], &permutedData[(i + 1) * permutationStripeSize], &permutedData[j * permutationStripeSize]);
+      if (computeHash(permutedData) == originalHash)
+      {
+        jaffarCommon::logger::log("[J+]    + %-14s swapping stripes %lu and %lu does not change the hash\n", policyName.c_str(), i, j);
+        collisions++;
+      }
+      std::swap_ranges(&permutedData[i * permutationStripeSize], &permutedData[(i + 1) * permutationStripeSize], &permutedData[j * permutationStripeSize]);
+      checkCount++;
+    }
+
+  if (collisions > 0) JAFFAR_THROW_RUNTIME("[ERROR] Hash function %s produced %lu collisions out of %lu stripe swaps\n", policyName.c_str(), collisions, checkCount);
+  jaffarCommon::logger::log("[J+]    + %-14s %lu stripe swaps checked, no collisions\n", policyName.c_str(), checkCount);
+}
+
+// Runs the stripe permutation check on the given data with all the available hash policies
+void checkAllStripePermutations(const std::string &data)
+{
+  checkStripePermutations<jaffarPlus::hashPolicy::MetroHash128>("MetroHash128", data);
+#ifdef JAFFAR_USE_XXHASH
+  checkStripePermutations<jaffarPlus::hashPolicy::XXH3>("XXH3-128", data);
+#endif
+  checkStripePermutations<jaffarPlus::hashPolicy::WideLane>("Wide Lane", data);
+}
+
+int main(int argc, char *argv[])
+{
+  // Parsing command line arguments
+  argparse::ArgumentParser program("jaffar-hash-benchmark", "1.0");
+
+  program.add_argument("--iterations").help("number of times each state is hashed per hash function.").default_value(std::string("100000"));
+
+  program.add_argument("stateFiles").help("paths to the state (.state) files to hash.").remaining();
+
+  // Try to parse arguments
+  try
+  {
+    program.parse_args(argc, argv);
+  }
+  catch (const std::runtime_error &err)
+  {
+    JAFFAR_THROW_LOGIC("%s\n%s", err.what(), program.help().str().c_str());
+  }
+
+  // Getting iteration count
+  const size_t iterations = std::stoul(program.get<std::string>("--iterations"));
+
+  // Getting state files
+  const auto stateFiles = program.get<std::vector<std::string>>("stateFiles");
+
+  // Checking stripe permutations on random data first, where all stripes differ
+  std::mt19937 randomGenerator(0);
+  std::string  randomData(permutationStripeSize * permutationMaxStripes, '\0');
+  for (auto &c : randomData) c = (char)randomGenerator();
+  jaffarCommon::logger::log("[J+] Random data (%lu bytes)\n", randomData.size());
+  checkAllStripePermutations(randomData);
+
+  for (const auto &stateFile : stateFiles)
+  {
+    // Loading state file contents
+    std::string stateData;
+    if (jaffarCommon::file::loadStringFromFile(stateData, stateFile) == false) JAFFAR_THROW_RUNTIME("[ERROR] Could not find or read from state file: %s\n", stateFile.c_str());
+
+    jaffarCommon::logger::log("[J+] State file: '%s' (%lu bytes)\n", stateFile.c_str(), stateData.size());
+
+    // Running all the available hash policies on it
+    runBenchmark<jaffarPlus::hashPolicy::MetroHash128>("MetroHash128", stateData, iterations);
+#ifdef JAFFAR_USE_XXHASH
+    runBenchmark<jaffarPlus::hashPolicy::XXH3>("XXH3-128", stateData, iterations);
+#endif
+    runBenchmark<jaffarPlus::hashPolicy::WideLane>("Wide Lane", stateData, iterations);
+
+    // Checking that reordering its stripes changes the hash
+    checkAllStripePermutations(stateData);
+  }
+
+  return 0;
+}
@@ -4,6 +4,9 @@
 #include <jaffarCommon/concurrent.hpp>
 #include <jaffarCommon/hash.hpp>
 #include <jaffarCommon/json.hpp>
+#include "checkpoint.hpp"
+#include "hashStore/set.hpp"
+#include "hashStore/table.hpp"
 
 namespace jaffarPlus
 {
@@ -13,35 +16,63 @@ class HashDb final
   public:
 
   /**
-   * A hash store represents a hash set, containing hashes of previously found states
-   * It also contains an age, indicating how long ago it was created. The older
-   * hash stores are discarded first.
+   * Types of hash store supported
    */
-  struct hashStore_t
+  enum storeType_t
   {
-    // The store id
-    const size_t id;
-
-    // The store age
-    const size_t age;
-
-    // The internal set for the hash store
-    jaffarCommon::concurrent::HashSet_t<jaffarCommon::hash::hash_t> hashSet = {};
+    /**
+     * General-purpose concurrent hash set, grows as entries are inserted
+     */
+    hashSet,
+
+    /**
+     * Preallocated lock-free open-addressing table of 128-bit keys
+     */
+    lockFreeTable
   };
 
   HashDb(const nlohmann::json &config)
   {
     _maxStoreCount  = jaffarCommon::json::getNumber<size_t>(config, "Max Store Count");
     _maxStoreSizeMb = jaffarCommon::json::getNumber<double>(config, "Max Store Size (Mb)");
+
+    // Parsing store type
+    const auto &storeTypeString     = jaffarCommon::json::getString(config, "Type");
+    bool        storeTypeRecognized = false;
+
+    if (storeTypeString == "Hash Set")
+    {
+      _storeType          = storeType_t::hashSet;
+      storeTypeRecognized = true;
+    }
+
+    if (storeTypeString == "Lock-Free Table")
+    {
+      _storeType          = storeType_t::lockFreeTable;
+      storeTypeRecognized = true;
+    }
+
+    if (storeTypeRecognized == false) JAFFAR_THROW_LOGIC("Hash database type '%s' not recognized", storeTypeString.c_str());
+
+    // Parsing fingerprint size. Only widths that can be stored packed and updated atomically are supported
+    _fingerprintBits = jaffarCommon::json::getNumber<size_t>(config, "Fingerprint Bits");
+    if (_fingerprintBits != 32 && _fingerprintBits != 64 && _fingerprintBits != 128)
+      JAFFAR_THROW_LOGIC("Hash database fingerprint bits must be 32, 64 or 128. Provided: %lu", _fingerprintBits);
+
+    // Getting the page backing to use for the lock-free tables
+    _hugePageMode = hugePages::parseMode(config);
   }
 
   __INLINE__ void initialize()
   {
-    // Calculating the maximum store size in entries
-    _maxStoreEntries = std::floor((_maxStoreSizeMb / _bytesPerEntry) * 1024.0 * 1024.0);
+    // Calculating the maximum store size in entries, depending on the key size
+    const size_t maxStoreSizeBytes = std::floor(_maxStoreSizeMb * 1024.0 * 1024.0);
+    if (_fingerprintBits == 32) calculateStoreLimits<uint32_t>(maxStoreSizeBytes);
+    if (_fingerprintBits == 64) calculateStoreLimits<uint64_t>(maxStoreSizeBytes);
+    if (_fingerprintBits == 128) calculateStoreLimits<jaffarCommon::hash::hash_t>(maxStoreSizeBytes);
 
     // Creating first hash db store
-    _hashStores.push_back(hashStore_t({.id = _currentHashStoreId++, .age = _currentAge}));
+    _hashStores.push_back(createHashStore());
 
     // Resizing counter vectors
     for (size_t i = 0; i < _maxStoreCount; i++)
@@ -56,30 +87,46 @@ class HashDb final
   // Function to print relevant information
   void printInfo() const
   {
+    if (_storeType == storeType_t::hashSet) jaffarCommon::logger::log("[J+]  + Type:                          Hash Set\n");
+    if (_storeType == storeType_t::lockFreeTable) jaffarCommon::logger::log("[J+]  + Type:                          Lock-Free Table\n");
+    jaffarCommon::logger::log("[J+]  + Fingerprint Bits:              %lu\n", _fingerprintBits);
+    if (_storeType == storeType_t::lockFreeTable) jaffarCommon::logger::log("[J+]  + Use Huge Pages:                %s\n", hugePages::getModeName(_hugePageMode));
     jaffarCommon::logger::log("[J+]  + Max Store Count:               %lu\n", _maxStoreCount);
     jaffarCommon::logger::log("[J+]  + Max Store Size:                %f Mb (%.2f Gb)\n", _maxStoreSizeMb, _maxStoreSizeMb / 1024.0);
     jaffarCommon::logger::log("[J+]  + Max Store Entries:             %lu (%.2f Mentries)\n", _maxStoreEntries, (double)_maxStoreEntries / (1024.0 * 1024.0));
     jaffarCommon::logger::log(
       "[J+]  + Total Max Entries:             %lu (%.2f Mentries)\n", _maxStoreEntries * _maxStoreCount, ((double)_maxStoreEntries * _maxStoreCount) / (1024.0 * 1024.0));
 
+    // Printing the expected false positive rate: the chance that a new state's fingerprint matches that of any of the stored entries
+    size_t totalEntries = 0;
+    for (const auto &hashStore : _hashStores) totalEntries += hashStore->size();
+    jaffarCommon::logger::log("[J+]  + Expected False Positive Rate:  %.3e (%lu entries)\n", getFalsePositiveRate(totalEntries), totalEntries);
+
     // Printing hash store information
     jaffarCommon::logger::log("[J+]  + Hash Stores (%lu / %lu):\n", _hashStores.size(), _maxStoreCount);
 
     auto   itr             = _hashStores.rbegin();
     size_t curHashStoreIdx = 0;
+    size_t totalOverflows  = 0;
     while (itr != _hashStores.rend())
     {
-      jaffarCommon::logger::log("[J+]    + [%02lu] - Age: %lu, Entries: %.3f M, Size: %.3f Mb, Check Count: %lu, Collision Count: %lu (Rate %.3f%%)\n",
-                                itr->id,
-                                itr->age,
-                                (double)itr->hashSet.size() / (1024.0 * 1024.0),
-                                (_bytesPerEntry * (double)itr->hashSet.size()) / (1024.0 * 1024.0),
+      jaffarCommon::logger::log("[J+]    + [%02lu] - Age: %lu, Entries: %.3f M, Size: %.3f Mb, Check Count: %lu, Collision Count: %lu (Rate %.3f%%), Overflow Count: %lu\n",
+                                (*itr)->getId(),
+                                (*itr)->getAge(),
+                                (double)(*itr)->size() / (1024.0 * 1024.0),
+                                (double)(*itr)->getSizeBytes() / (1024.0 * 1024.0),
                                 _queryCounters[curHashStoreIdx]->load(),
                                 _collisionCounters[curHashStoreIdx]->load(),
-                                100.0 * (double)_collisionCounters[curHashStoreIdx]->load() / (double)_queryCounters[curHashStoreIdx]->load());
+                                100.0 * (double)_collisionCounters[curHashStoreIdx]->load() / (double)_queryCounters[curHashStoreIdx]->load(),
+                                (*itr)->getOverflowCount());
+      totalOverflows += (*itr)->getOverflowCount();
       itr++;
       curHashStoreIdx++;
     }
+
+    // Hashes not inserted are not recognized if their states are found again, so the search may repeat work
+    if (totalOverflows > 0)
+      jaffarCommon::logger::log("[J+]  + Warning: %lu hashes did not fit in their store and were not inserted. Consider a larger 'Max Store Size (Mb)'\n", totalOverflows);
   }
 
   /**
@@ -101,10 +148,10 @@ class HashDb final
       bool collisionFound = false;
 
       // If it is the first hash db, check at the same time as we insert
-      if (curHashStoreIdx == 0) collisionFound = itr->hashSet.insert(hash).second == false;
+      if (curHashStoreIdx == 0) collisionFound = (*itr)->checkAndInsert(hash);
 
       // Otherwise, we simply check (no inserts)
-      if (curHashStoreIdx > 0) collisionFound = itr->hashSet.contains(hash);
+      if (curHashStoreIdx > 0) collisionFound = (*itr)->contains(hash);
 
       // If collision is found, register it and return
       if (collisionFound == true)
@@ -135,7 +182,7 @@ class HashDb final
     auto &currentHashStore = *itr;
 
     // Inserting hash
-    currentHashStore.hashSet.insert(hash);
+    currentHashStore->checkAndInsert(hash);
   }
 
   /**
@@ -149,27 +196,143 @@ class HashDb final
     auto  itr              = _hashStores.rbegin();
     auto &currentHashStore = *itr;
 
-    // If the current hash store exceeds the entry limit, push put a new one in
-    if (currentHashStore.hashSet.size() > _maxStoreEntries)
+    // If the current hash store reached the entry limit, push put a new one in
+    if (currentHashStore->size() >= _maxStoreEntries)
     {
       // First, if we already reached the maximum hash stores, then discard the oldest one first
       if (_hashStores.size() == _maxStoreCount) _hashStores.pop_front();
 
       // Now create the new one, by pushing it from the back
-      _hashStores.push_back(hashStore_t({.id = _currentHashStoreId++, .age = _currentAge}));
+      _hashStores.push_back(createHashStore());
     }
 
     // Increasing age
     _currentAge++;
   }
 
+  /**
+   * Writes the hash stores, with their identifiers and ages, into a checkpoint file
+   */
+  void saveCheckpoint(const std::string &filePath) const
+  {
+    checkpoint::Writer writer(filePath);
+
+    // Writing the configuration the stores were created with, to check it on resume
+    writer.push<size_t>(_fingerprintBits);
+    writer.push<storeType_t>(_storeType);
+
+    // Writing the database counters
+    writer.push<size_t>(_currentAge);
+    writer.push<size_t>(_currentHashStoreId);
+
+    // Writing the stores, oldest first
+    writer.push<size_t>(_hashStores.size());
+    for (const auto &hashStore : _hashStores)
+    {
+      writer.push<size_t>(hashStore->getId());
+      writer.push<size_t>(hashStore->getAge());
+      hashStore->saveCheckpoint(writer);
+    }
+
+    writer.close();
+  }
+
+  /**
+   * Replaces the hash stores with the ones in a checkpoint file
+   */
+  void loadCheckpoint(const std::string &filePath)
+  {
+    checkpoint::Reader reader(filePath);
+
+    // Checking the stores were created with the same configuration
+    const auto fingerprintBits = reader.pop<size_t>();
+    const auto storeType       = reader.pop<storeType_t>();
+    if (fingerprintBits != _fingerprintBits || storeType != _storeType)
+      JAFFAR_THROW_LOGIC("[ERROR] The checkpoint hash database type or fingerprint bits (%lu) differ from the configured ones (%lu)\n", fingerprintBits, _fingerprintBits);
+
+    // Reading the database counters
+    const auto currentAge         = reader.pop<size_t>();
+    const auto currentHashStoreId = reader.pop<size_t>();
+
+    // Reading the stores, each created with its original identifier and age
+    _hashStores.clear();
+    const auto storeCount = reader.pop<size_t>();
+    for (size_t i = 0; i < storeCount; i++)
+    {
+      _currentHashStoreId = reader.pop<size_t>();
+      _currentAge         = reader.pop<size_t>();
+      _hashStores.push_back(createHashStore());
+      _hashStores.back()->loadCheckpoint(reader);
+    }
+
+    _currentAge         = currentAge;
+    _currentHashStoreId = currentHashStoreId;
+
+    // Resetting counters
+    for (size_t i = 0; i < _maxStoreCount; i++)
+    {
+      _queryCounters[i]->store(0);
+      _collisionCounters[i]->store(0);
+    }
+  }
+
   private:
 
   /**
-   * Calculated empirically, by filling a hash set with a huge number of distinct hashes
-   * and measuring the maximum resident (memory) set size after execution.
+   * Creates a new hash store of the configured type, with the current age
+   */
+  __INLINE__ std::unique_ptr<hashStore::Base> createHashStore()
+  {
+    if (_fingerprintBits == 32) return createHashStore<uint32_t>();
+    if (_fingerprintBits == 64) return createHashStore<uint64_t>();
+    return createHashStore<jaffarCommon::hash::hash_t>();
+  }
+
+  template <class key_t>
+  __INLINE__ std::unique_ptr<hashStore::Base> createHashStore()
+  {
+    if (_storeType == storeType_t::lockFreeTable) return std::make_unique<hashStore::Table<key_t>>(_currentHashStoreId++, _currentAge, _tableCapacity, _hugePageMode);
+    return std::make_unique<hashStore::Set<key_t>>(_currentHashStoreId++, _currentAge);
+  }
+
+  /**
+   * Calculates how many entries (and table slots) fit in a store of the given size, for the given key type
+   */
+  template <class key_t>
+  __INLINE__ void calculateStoreLimits(const size_t maxStoreSizeBytes)
+  {
+    if (_storeType == storeType_t::hashSet) _maxStoreEntries = std::floor((double)maxStoreSizeBytes / hashStore::Set<key_t>::bytesPerEntry);
+    if (_storeType == storeType_t::lockFreeTable)
+    {
+      _tableCapacity   = hashStore::Table<key_t>::getCapacityForSize(maxStoreSizeBytes);
+      _maxStoreEntries = std::floor((double)_tableCapacity * hashStore::Table<key_t>::maxLoadFactor);
+    }
+  }
+
+  /**
+   * Gets the probability that a new state is wrongly considered as repeated, given the number of stored fingerprints
+   */
+  __INLINE__ double getFalsePositiveRate(const size_t entryCount) const { return std::min(1.0, (double)entryCount / std::exp2((double)_fingerprintBits)); }
+
+  /**
+   * Number of bits of the state hash that are stored per entry
+   */
+  size_t _fingerprintBits;
+
+  /**
+   * Page backing for the lock-free tables. Hash sets manage their own memory
+   */
+  hugePages::hugePageMode_t _hugePageMode;
+
+  /**
+   * The type of hash store to use
+   */
+  storeType_t _storeType;
+
+  /**
+   * Number of slots per store (lock-free table only)
    */
-  const double _bytesPerEntry = 32.0;
+  size_t _tableCapacity = 0;
 
   /**
    * Identifier count for hash db stores
@@ -205,7 +368,7 @@ class HashDb final
    * The past hash stores are read only. They are only used to check whether the hash collides
    * but are not updated in the process.
    */
-  std::deque<hashStore_t> _hashStores;
+  std::deque<std::unique_ptr<hashStore::Base>> _hashStores;
 
   /**
    * Counter to store how many checks and collisions happened so far
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <jaffarCommon/hash.hpp>
+
+namespace jaffarPlus
+{
+
+namespace hashPolicy
+{
+
+/**
+ * A hash policy is a streaming hash function used to compute state hashes. Data is fed through successive
+ * calls to Update, and the result only depends on the concatenation of the bytes passed, not on how they were split.
+ * Policies are instantiated as their concrete (final) types by the runner, but games receive them through this interface.
+ */
+class Base
+{
+  public:
+
+  Base()          = default;
+  virtual ~Base() = default;
+
+  /**
+   * Feeds the given bytes into the hash
+   */
+  virtual void Update(const void *data, const size_t size) = 0;
+
+  /**
+   * Feeds the bytes of the given value into the hash
+   */
+  template <class T>
+  __INLINE__ void Update(const T &value)
+  {
+    Update(&value, sizeof(T));
+  }
+
+  /**
+   * Produces the final hash from all the data fed so far
+   */
+  virtual jaffarCommon::hash::hash_t Finalize() = 0;
+};
+
+} // namespace hashPolicy
+
+} // namespace jaffarPlus
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <jaffarCommon/hash.hpp>
+#include "base.hpp"
+
+namespace jaffarPlus
+{
+
+namespace hashPolicy
+{
+
+/**
+ * Hash policy based on MetroHash128, as provided by jaffarCommon. This is the default.
+ */
+class MetroHash128 final : public hashPolicy::Base
+{
+  public:
+
+  using hashPolicy::Base::Update;
+
+  MetroHash128()  = default;
+  ~MetroHash128() = default;
+
+  __INLINE__ void Update(const void *data, const size_t size) override { _hashEngine.Update(data, size); }
+
+  __INLINE__ jaffarCommon::hash::hash_t Finalize() override
+  {
+    jaffarCommon::hash::hash_t result;
+    _hashEngine.Finalize(reinterpret_cast<uint8_t *>(&result));
+    return result;
+  }
+
+  private:
+
+  ::MetroHash128 _hashEngine;
+};
+
+} // namespace hashPolicy
+
+} // namespace jaffarPlus
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <jaffarCommon/hash.hpp>
+#include "base.hpp"
+
+namespace jaffarPlus
+{
+
+namespace hashPolicy
+{
+
+// Produces the wide-lane hash key words from a fixed seed with splitmix64
+template <size_t N>
+constexpr std::array<uint64_t, N> generateWideLaneKey()
+{
+  std::array<uint64_t, N> key{};
+  uint64_t                state = 0x243F6A8885A308D3ull;
+  for (auto &k : key)
+  {
+    state += 0x9E3779B97F4A7C15ull;
+    uint64_t z = state;
+    z          = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z          = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    k          = z ^ (z >> 31);
+  }
+  return key;
+}
+
+/**
+ * Wide-lane hash policy. Input is consumed in 64-byte stripes, each split across eight independent 64-bit
+ * accumulators. Every lane accumulates the 32x32->64 bit product of the key-mixed input word (as XXH3 does),
+ * so the stripe loop has no cross-lane dependencies and is vectorized by the compiler on SSE2/AVX2/NEON.
+ * As in XXH3, each stripe of a scramble window is mixed with the key advanced by one word per stripe, so that
+ * swapping two stripes changes the hash. The accumulators are scrambled periodically and folded into 128 bits
+ * with full 64x64->128 bit multiplies at the end.
+ */
+class WideLane final : public hashPolicy::Base
+{
+  public:
+
+  using hashPolicy::Base::Update;
+
+  WideLane()
+  {
+    // Initializing accumulators from the key
+    for (size_t i = 0; i < _laneCount; i++) _accumulators[i] = _key[i];
+  }
+  ~WideLane() = default;
+
+  __INLINE__ void Update(const void *data, const size_t size) override
+  {
+    auto   input     = (const uint8_t *)data;
+    size_t remaining = size;
+    _totalSize += size;
+
+    // Completing the pending stripe first, if any
+    if (_pendingSize > 0)
+    {
+      const auto count = std::min(remaining, _stripeSize - _pendingSize);
+      std::memcpy(&_pending[_pendingSize], input, count);
+      _pendingSize += count;
+      input += count;
+      remaining -= count;
+
+      // A full stripe is only processed once more data follows it, the same as below
+      if (_pendingSize < _stripeSize || remaining == 0) return;
+      processStripe(_pending);
+      _pendingSize = 0;
+    }
+
+    // Processing full stripes directly from the input. The last stripe is always kept pending, so that Finalize has data to process
+    for (; remaining > _stripeSize; input += _stripeSize, remaining -= _stripeSize) processStripe(input);
+
+    // Storing the remainder
+    std::memcpy(_pending, input, remaining);
+    _pendingSize = remaining;
+  }
+
+  __INLINE__ jaffarCommon::hash::hash_t Finalize() override
+  {
+    // Processing the last, zero-padded stripe. The total size is mixed in below, so the padding is not ambiguous
+    std::memset(&_pending[_pendingSize], 0, _stripeSize - _pendingSize);
+    processStripe(_pending);
+
+    // Folding the accumulators into two 64-bit words, each with a different set of keys
+    uint64_t low  = _totalSize * 0x9E3779B185EBCA87ull;
+    uint64_t high = ~_totalSize * 0xC2B2AE3D27D4EB4Full;
+    for (size_t i = 0; i < _laneCount; i += 2)
+    {
+      low += multiplyFold(_accumulators[i] ^ _key[_stripeKeyCount + i], _accumulators[i + 1] ^ _key[_stripeKeyCount + i + 1]);
+      high += multiplyFold(_accumulators[i] ^ _key[_stripeKeyCount + i + 1], _accumulators[i + 1] ^ _key[_stripeKeyCount + i]);
+    }
+
+    return jaffarCommon::hash::hash_t{avalanche(low), avalanche(high)};
+  }
+
+  private:
+
+  // Number of 64-bit accumulators
+  static constexpr size_t _laneCount = 8;
+
+  // Bytes consumed per stripe, one word per lane
+  static constexpr size_t _stripeSize = _laneCount * sizeof(uint64_t);
+
+  // Number of stripes accumulated before scrambling
+  static constexpr size_t _stripesPerScramble = 16;
+
+  // Key words mixed into the input, starting one word further for each stripe of a scramble window
+  static constexpr size_t _stripeKeyCount = _laneCount + _stripesPerScramble - 1;
+
+  // Key words mixed into the input (the first ones) and into the accumulators when scrambling and folding them (the last ones)
+  static constexpr std::array<uint64_t, _stripeKeyCount + _laneCount> _key = generateWideLaneKey<_stripeKeyCount + _laneCount>();
+
+  // Accumulates a stripe into the lanes. Each lane's input word is also added to its neighbour, so no input bits are lost in the product
+  __INLINE__ void processStripe(const uint8_t *stripe)
+  {
+    uint64_t words[_laneCount];
+    std::memcpy(words, stripe, _stripeSize);
+
+    // The key depends on the stripe position within the scramble window, otherwise stripes could be reordered without changing the sums
+    const uint64_t *stripeKey = &_key[_stripeCount % _stripesPerScramble];
+
+    for (size_t i = 0; i < _laneCount; i++)
+    {
+      const uint64_t mixed = words[i] ^ stripeKey[i];
+      _accumulators[i ^ 1] += words[i];
+      _accumulators[i] += (mixed & 0xFFFFFFFFull) * (mixed >> 32);
+    }
+
+    // Scrambling the accumulators periodically, so that high bits propagate to the low ones
+    if (++_stripeCount % _stripesPerScramble == 0)
+      for (size_t i = 0; i < _laneCount; i++)
+      {
+        uint64_t a       = _accumulators[i];
+        a                = (a ^ (a >> 47)) ^ _key[_stripeKeyCount + i];
+        _accumulators[i] = a * 0x9E3779B1ull;
+      }
+  }
+
+  // Multiplies two words into 128 bits and folds the result into 64
+  static __INLINE__ uint64_t multiplyFold(const uint64_t a, const uint64_t b)
+  {
+    const __uint128_t product = (__uint128_t)a * (__uint128_t)b;
+    return (uint64_t)product ^ (uint64_t)(product >> 64);
+  }
+
+  // Final mixing step, so that every input bit affects every output bit
+  static __INLINE__ uint64_t avalanche(uint64_t h)
+  {
+    h ^= h >> 37;
+    h *= 0x165667919E3779F9ull;
+    h ^= h >> 32;
+    return h;
+  }
+
+  // Lane accumulators
+  uint64_t _accumulators[_laneCount];
+
+  // Storage for a partial stripe
+  uint8_t _pending[_stripeSize];
+  size_t  _pendingSize = 0;
+
+  // Counters for scrambling and length mixing
+  size_t   _stripeCount = 0;
+  uint64_t _totalSize   = 0;
+};
+
+} // namespace hashPolicy
+
+} // namespace jaffarPlus
@@ -0,0 +1,45 @@
+#pragma once
+
+// This policy is only available when Jaffar is built against libxxhash
+#ifdef JAFFAR_USE_XXHASH
+
+  #include <xxhash.h>
+  #include <jaffarCommon/hash.hpp>
+  #include "base.hpp"
+
+namespace jaffarPlus
+{
+
+namespace hashPolicy
+{
+
+/**
+ * Hash policy based on the 128-bit variant of XXH3, using its streaming interface
+ */
+class XXH3 final : public hashPolicy::Base
+{
+  public:
+
+  using hashPolicy::Base::Update;
+
+  XXH3() { XXH3_128bits_reset(&_state); }
+  ~XXH3() = default;
+
+  __INLINE__ void Update(const void *data, const size_t size) override { XXH3_128bits_update(&_state, data, size); }
+
+  __INLINE__ jaffarCommon::hash::hash_t Finalize() override
+  {
+    const auto digest = XXH3_128bits_digest(&_state);
+    return jaffarCommon::hash::hash_t{digest.low64, digest.high64};
+  }
+
+  private:
+
+  XXH3_state_t _state;
+};
+
+} // namespace hashPolicy
+
+} // namespace jaffarPlus
+
+#endif // JAFFAR_USE_XXHASH
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <type_traits>
+#include <jaffarCommon/hash.hpp>
+#include "../checkpoint.hpp"
+
+namespace jaffarPlus
+{
+
+namespace hashStore
+{
+
+/**
+ * Produces the key stored for a given hash. If the key type is narrower than the full hash, the hash is truncated
+ * into a fingerprint of that size (taken from its first word). Otherwise, the full hash is used as is.
+ */
+template <class key_t>
+__INLINE__ key_t getFingerprint(const jaffarCommon::hash::hash_t hash)
+{
+  if constexpr (std::is_same_v<key_t, jaffarCommon::hash::hash_t>) return hash;
+  if constexpr (std::is_same_v<key_t, jaffarCommon::hash::hash_t> == false) return (key_t)hash.first;
+}
+
+/**
+ * A hash store represents a hash set, containing hashes of previously found states
+ * It also contains an age, indicating how long ago it was created. The older
+ * hash stores are discarded first.
+ */
+class Base
+{
+  public:
+
+  Base(const size_t id, const size_t age)
+    : _id(id)
+    , _age(age)
+  {}
+
+  virtual ~Base() = default;
+
+  /**
+   * Checks whether the hash is already present in the store and, if not, inserts it. Returns true if it was already present
+   */
+  virtual bool checkAndInsert(const jaffarCommon::hash::hash_t hash) = 0;
+
+  /**
+   * Checks whether the hash is already present in the store (no inserts)
+   */
+  virtual bool contains(const jaffarCommon::hash::hash_t hash) = 0;
+
+  /**
+   * Gets the number of hashes contained in the store
+   */
+  virtual size_t size() const = 0;
+
+  /**
+   * Gets the memory (in bytes) occupied by the store
+   */
+  virtual size_t getSizeBytes() const = 0;
+
+  /**
+   * Gets the number of hashes that could not be inserted (e.g., because the store was full). Their states are taken
+   * as new, and would not be recognized as repeated if found again
+   */
+  virtual size_t getOverflowCount() const = 0;
+
+  /**
+   * Writes the stored hashes into a checkpoint
+   */
+  virtual void saveCheckpoint(checkpoint::Writer &writer) const = 0;
+
+  /**
+   * Reads the stored hashes from a checkpoint, as written by saveCheckpoint on a store of the same type and size
+   */
+  virtual void loadCheckpoint(checkpoint::Reader &reader) = 0;
+
+  __INLINE__ size_t getId() const { return _id; }
+  __INLINE__ size_t getAge() const { return _age; }
+
+  protected:
+
+  // The store id
+  const size_t _id;
+
+  // The store age
+  const size_t _age;
+};
+
+} // namespace hashStore
+
+} // namespace jaffarPlus
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <jaffarCommon/concurrent.hpp>
+#include <jaffarCommon/hash.hpp>
+#include "base.hpp"
+
+namespace jaffarPlus
+{
+
+namespace hashStore
+{
+
+/**
+ * Hash store backed by a general-purpose concurrent hash set. It grows as needed.
+ * The key type determines whether full hashes or truncated fingerprints are stored.
+ */
+template <class key_t>
+class Set final : public hashStore::Base
+{
+  public:
+
+  /**
+   * Estimated memory taken by each entry, used to limit the number of entries a store may hold. It is an upper
+   * estimate, not a measurement, so that the configured store size is not exceeded:
+   *
+   * - The set keeps its keys in flat slots, each along with a one-byte control tag.
+   * - It doubles its slots whenever they are 7/8 full, so right after growing they are only 7/16 full.
+   * - While one of its submaps grows, both its old and new slots are held. The safety margin covers it.
+   *
+   * For 128-bit keys this gives ~43 bytes per entry, above the ~32 bytes measured on average (as the maximum resident
+   * set size after filling a set with a huge number of distinct hashes), which did not account for the growth steps.
+   */
+  static constexpr double slotBytes     = (double)sizeof(key_t) + 1.0;
+  static constexpr double minLoadFactor = 7.0 / 16.0;
+  static constexpr double safetyMargin  = 1.1;
+  static constexpr double bytesPerEntry = safetyMargin * slotBytes / minLoadFactor;
+
+  Set(const size_t id, const size_t age)
+    : hashStore::Base(id, age)
+  {}
+
+  ~Set() = default;
+
+  __INLINE__ bool   checkAndInsert(const jaffarCommon::hash::hash_t hash) override { return _hashSet.insert(getFingerprint<key_t>(hash)).second == false; }
+  __INLINE__ bool   contains(const jaffarCommon::hash::hash_t hash) override { return _hashSet.contains(getFingerprint<key_t>(hash)); }
+  __INLINE__ size_t size() const override { return _hashSet.size(); }
+  __INLINE__ size_t getSizeBytes() const override { return bytesPerEntry * (double)_hashSet.size(); }
+
+  // The set grows as needed, so all hashes are inserted
+  __INLINE__ size_t getOverflowCount() const override { return 0; }
+
+  void saveCheckpoint(checkpoint::Writer &writer) const override
+  {
+    writer.push<size_t>(_hashSet.size());
+    for (const auto &key : _hashSet) writer.push(key);
+  }
+
+  void loadCheckpoint(checkpoint::Reader &reader) override
+  {
+    const auto entryCount = reader.pop<size_t>();
+    const auto keys       = (const key_t *)reader.popPointer(entryCount * sizeof(key_t));
+    _hashSet.reserve(entryCount);
+    for (size_t i = 0; i < entryCount; i++) _hashSet.insert(keys[i]);
+  }
+
+  private:
+
+  // The internal set for the hash store
+  jaffarCommon::concurrent::HashSet_t<key_t> _hashSet;
+};
+
+} // namespace hashStore
+
+} // namespace jaffarPlus
@@ -0,0 +1,271 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+#include <jaffarCommon/hash.hpp>
+#include <jaffarCommon/logger.hpp>
+#include <jaffarCommon/parallel.hpp>
+#include "../hugePages.hpp"
+#include "base.hpp"
+
+namespace jaffarPlus
+{
+
+namespace hashStore
+{
+
+/**
+ * Hash store backed by a preallocated, fixed-capacity, open-addressing (linear probing) table.
+ *
+ * The key type determines whether full hashes or truncated fingerprints are stored:
+ *
+ * - Fingerprints (32 or 64 bits) are stored packed, one per slot, and inserted with a single compare-and-swap.
+ * - Full (128-bit) hashes are inserted lock-free in two phases: a slot is claimed by a compare-and-swap on its
+ *   first 64-bit word, after which the claiming thread publishes the second word.
+ *
+ * A zero word marks an empty (or not yet published) slot, so keys whose words are zero are stored with that word
+ * set to one instead.
+ */
+template <class key_t>
+class Table final : public hashStore::Base
+{
+  public:
+
+  /**
+   * Whether this table stores the full 128-bit hash, rather than a single-word fingerprint
+   */
+  static constexpr bool isFullHash = std::is_same_v<key_t, jaffarCommon::hash::hash_t>;
+
+  /**
+   * A table slot holds a full 128-bit hash, or a single fingerprint
+   */
+  struct fullHashSlot_t
+  {
+    uint64_t hi;
+    uint64_t lo;
+  };
+  typedef std::conditional_t<isFullHash, fullHashSlot_t, key_t> slot_t;
+
+  /**
+   * Maximum fraction of slots to fill. Once reached, the hash database rotates the store at the end of the step, and
+   * until then no more hashes are inserted into it, so that the probe sequences stay short
+   */
+  static constexpr double maxLoadFactor = 0.75;
+
+  /**
+   * Maximum number of slots to probe before giving up. States whose hashes cannot be placed within this distance, or
+   * that arrive once the table is full, are treated as new (never as repeated), so the worst case is re-exploring a
+   * state, never discarding one. Both are counted as overflows
+   */
+  static constexpr size_t maxProbeLength = 4096;
+
+  /**
+   * Maximum number of inserts a thread makes between checks of whether the table is full
+   */
+  static constexpr size_t maxFullCheckInterval = 1024;
+
+  /**
+   * Gets the number of slots that fit in the given memory size
+   */
+  static __INLINE__ size_t getCapacityForSize(const size_t sizeBytes) { return std::max(sizeBytes / sizeof(slot_t), (size_t)1); }
+
+  Table(const size_t id, const size_t age, const size_t capacity, const hugePages::hugePageMode_t hugePageMode)
+    : hashStore::Base(id, age)
+    , _capacity(capacity)
+    , _maxEntries((size_t)std::floor((double)capacity * maxLoadFactor))
+    , _hugePageMode(hugePageMode)
+  {
+    // Allocating zeroed slots. Regular pages are only assigned as they are touched by the inserts, while explicit huge pages are reserved now
+    _slots = (slot_t *)hugePages::reserve(_capacity * sizeof(slot_t), _hugePageMode);
+
+    // Creating one entry counter per thread, to prevent contention on a shared counter
+    const size_t threadCount = jaffarCommon::parallel::getMaxThreadCount();
+    _entryCounters           = std::vector<entryCounter_t>(threadCount);
+
+    // Checking whether the table is full often enough that all threads together overshoot its maximum load by 1/16 at most
+    _fullCheckInterval = std::clamp(_maxEntries / (16 * threadCount), (size_t)1, maxFullCheckInterval);
+  }
+
+  ~Table() { hugePages::release((uint8_t *)_slots, _capacity * sizeof(slot_t), _hugePageMode); }
+
+  __INLINE__ bool checkAndInsert(const jaffarCommon::hash::hash_t hash) override
+  {
+    if (_isFull.load(std::memory_order_relaxed) == false) return probe<true>(hash);
+
+    // Once full, the hash is only looked up. If not present, it is counted as not inserted
+    const bool isPresent = probe<false>(hash);
+    if (isPresent == false) _overflowCount++;
+    return isPresent;
+  }
+  __INLINE__ bool contains(const jaffarCommon::hash::hash_t hash) override { return probe<false>(hash); }
+
+  __INLINE__ size_t size() const override
+  {
+    size_t entries = 0;
+    for (const auto &counter : _entryCounters) entries += counter.value.load(std::memory_order_relaxed);
+    return entries;
+  }
+
+  __INLINE__ size_t getSizeBytes() const override { return _capacity * sizeof(slot_t); }
+
+  /**
+   * The slots are written as they are, so they can be copied back without rehashing
+   */
+  void saveCheckpoint(checkpoint::Writer &writer) const override
+  {
+    writer.push<size_t>(size());
+    writer.push<size_t>(_capacity);
+    writer.push(_slots, _capacity * sizeof(slot_t));
+  }
+
+  void loadCheckpoint(checkpoint::Reader &reader) override
+  {
+    const auto entryCount = reader.pop<size_t>();
+    const auto capacity   = reader.pop<size_t>();
+    if (capacity != _capacity) JAFFAR_THROW_LOGIC("[ERROR] Checkpoint hash table has %lu slots, but the configured tables have %lu\n", capacity, _capacity);
+    reader.pop(_slots, _capacity * sizeof(slot_t));
+
+    // The entry count is kept in the first counter, the others start from zero
+    for (auto &counter : _entryCounters) counter.value.store(0, std::memory_order_relaxed);
+    _entryCounters[0].value.store(entryCount, std::memory_order_relaxed);
+    _isFull = entryCount >= _maxEntries;
+  }
+
+  __INLINE__ size_t getOverflowCount() const override { return _overflowCount.load(); }
+
+  private:
+
+  /**
+   * Counts an inserted hash for the calling thread. Every few inserts, it checks whether all threads together filled the table
+   */
+  __INLINE__ void countInsert()
+  {
+    const size_t threadEntries = _entryCounters[jaffarCommon::parallel::getThreadId()].value.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (threadEntries % _fullCheckInterval == 0 && size() >= _maxEntries) _isFull.store(true, std::memory_order_relaxed);
+  }
+
+  /**
+   * Looks for the hash along its probe sequence. If requested, it is inserted on the first empty slot found.
+   * Returns true if the hash was already present.
+   */
+  template <bool doInsert>
+  __INLINE__ bool probe(const jaffarCommon::hash::hash_t hash)
+  {
+    // Getting the key words to store, making sure none of them is zero
+    uint64_t key[2] = {0, 0};
+    if constexpr (isFullHash == true) memcpy(key, &hash, sizeof(key));
+    if constexpr (isFullHash == false) key[0] = getFingerprint<key_t>(hash);
+    if (key[0] == 0) key[0] = 1;
+    if (key[1] == 0) key[1] = 1;
+
+    // The first word determines the home slot
+    constexpr size_t homeBits = isFullHash ? 64 : sizeof(key_t) * 8;
+    size_t           slotIdx  = (size_t)(((unsigned __int128)key[0] * (unsigned __int128)_capacity) >> homeBits);
+
+    for (size_t i = 0; i < maxProbeLength; i++)
+    {
+      // Single-word fingerprints: claim or compare the slot with a single atomic operation
+      if constexpr (isFullHash == false)
+      {
+        std::atomic_ref<key_t> slot(_slots[slotIdx]);
+        key_t                  value = slot.load(std::memory_order_acquire);
+
+        // If the slot is empty, the fingerprint is not in the table. Try to claim it
+        if (value == 0)
+        {
+          if constexpr (doInsert == false) return false;
+          if (slot.compare_exchange_strong(value, (key_t)key[0], std::memory_order_acq_rel, std::memory_order_acquire))
+          {
+            countInsert();
+            return false;
+          }
+
+          // Otherwise, another thread claimed it first. Its key is now in 'value' and we compare against it below
+        }
+
+        if (value == (key_t)key[0]) return true;
+      }
+
+      // Full hashes: two-phase claim
+      if constexpr (isFullHash == true)
+      {
+        auto                     &slot = _slots[slotIdx];
+        std::atomic_ref<uint64_t> slotHi(slot.hi);
+        uint64_t                  hi = slotHi.load(std::memory_order_acquire);
+
+        // If the slot is empty, the hash is not in the table
+        if (hi == 0)
+        {
+          if constexpr (doInsert == false) return false;
+
+          // Trying to claim the slot. If it succeeds, publish the second word and finish
+          if (slotHi.compare_exchange_strong(hi, key[0], std::memory_order_acq_rel, std::memory_order_acquire))
+          {
+            std::atomic_ref<uint64_t>(slot.lo).store(key[1], std::memory_order_release);
+            countInsert();
+            return false;
+          }
+
+          // Otherwise, another thread claimed it first. Its key is now in 'hi' and we compare against it below
+        }
+
+        // If the first word matches, wait for the second word to be published and compare it
+        if (hi == key[0])
+        {
+          std::atomic_ref<uint64_t> slotLo(slot.lo);
+          uint64_t                  lo = slotLo.load(std::memory_order_acquire);
+          while (lo == 0) lo = slotLo.load(std::memory_order_acquire);
+          if (lo == key[1]) return true;
+        }
+      }
+
+      // Advancing to the next slot
+      slotIdx = slotIdx + 1 == _capacity ? 0 : slotIdx + 1;
+    }
+
+    // Could not find the hash nor an empty slot to place it within the maximum probe length
+    if constexpr (doInsert == true) _overflowCount++;
+    return false;
+  }
+
+  /**
+   * Cache-line padded entry counter, so that each thread counts its inserts without false sharing
+   */
+  struct alignas(64) entryCounter_t
+  {
+    std::atomic<size_t> value = 0;
+  };
+
+  // Number of slots in the table
+  const size_t _capacity;
+
+  // Number of entries at which the table is full
+  const size_t _maxEntries;
+
+  // Number of inserts each thread makes between checks of whether the table is full
+  size_t _fullCheckInterval;
+
+  // Whether the table is full, so no more hashes are inserted
+  std::atomic<bool> _isFull = false;
+
+  // Page backing for the slot storage
+  const hugePages::hugePageMode_t _hugePageMode;
+
+  // Internal slot storage
+  slot_t *_slots;
+
+  // Per-thread inserted entry counters
+  std::vector<entryCounter_t> _entryCounters;
+
+  // Number of hashes not inserted, due to the table being full or to exceeding the maximum probe length
+  std::atomic<size_t> _overflowCount = 0;
+};
+
+} // namespace hashStore
+
+} // namespace jaffarPlus
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <jaffarCommon/json.hpp>
+#include <jaffarCommon/logger.hpp>
+
+// Not all libc headers define the huge page size selectors
+#ifndef MAP_HUGE_SHIFT
+  #define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+  #define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+  #define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+
+namespace jaffarPlus
+{
+
+namespace hugePages
+{
+
+/**
+ * Types of page backing for the large (state and hash) databases
+ */
+enum hugePageMode_t
+{
+  /**
+   * Regular system pages
+   */
+  none,
+
+  /**
+   * Regular system pages, advising the kernel to promote them to transparent huge pages (2M)
+   */
+  transparent,
+
+  /**
+   * Explicit 2M huge pages, taken from the system's huge page pool
+   */
+  explicit2M,
+
+  /**
+   * Explicit 1G huge pages, taken from the system's huge page pool
+   */
+  explicit1G
+};
+
+/**
+ * Parses the huge page mode from the "Use Huge Pages" entry of the given configuration
+ */
+__INLINE__ hugePageMode_t parseMode(const nlohmann::json &config)
+{
+  const auto &modeString = jaffarCommon::json::getString(config, "Use Huge Pages");
+
+  if (modeString == "none") return hugePageMode_t::none;
+  if (modeString == "transparent") return hugePageMode_t::transparent;
+  if (modeString == "explicit2M") return hugePageMode_t::explicit2M;
+  if (modeString == "explicit1G") return hugePageMode_t::explicit1G;
+
+  JAFFAR_THROW_LOGIC("Huge page mode '%s' not recognized", modeString.c_str());
+}
+
+/**
+ * Gets the name of the huge page mode, as used in the configuration
+ */
+__INLINE__ const char *getModeName(const hugePageMode_t mode)
+{
+  if (mode == hugePageMode_t::transparent) return "transparent";
+  if (mode == hugePageMode_t::explicit2M) return "explicit2M";
+  if (mode == hugePageMode_t::explicit1G) return "explicit1G";
+  return "none";
+}
+
+/**
+ * Gets the size of the pages backing memory reserved with the given mode. This is also the stride for first-touching it
+ */
+__INLINE__ size_t getPageSize(const hugePageMode_t mode)
+{
+  if (mode == hugePageMode_t::transparent) return 2ul * 1024ul * 1024ul;
+  if (mode == hugePageMode_t::explicit2M) return 2ul * 1024ul * 1024ul;
+  if (mode == hugePageMode_t::explicit1G) return 1024ul * 1024ul * 1024ul;
+  return sysconf(_SC_PAGESIZE);
+}
+
+/**
+ * Rounds the given size up to a whole number of pages of the given mode
+ */
+__INLINE__ size_t roundToPageSize(const size_t size, const hugePageMode_t mode)
+{
+  const size_t pageSize = getPageSize(mode);
+  return ((size + pageSize - 1) / pageSize) * pageSize;
+}
+
+/**
+ * Tells whether the mode takes pages from the system's explicit huge page pool
+ */
+__INLINE__ bool isExplicit(const hugePageMode_t mode) { return mode == hugePageMode_t::explicit2M || mode == hugePageMode_t::explicit1G; }
+
+/**
+ * Gets the number of explicit huge pages of the mode's size that are free and not yet reserved by any mapping
+ */
+__INLINE__ size_t getAvailablePageCount(const hugePageMode_t mode)
+{
+  const std::string poolPath = std::string("/sys/kernel/mm/hugepages/hugepages-") + (mode == hugePageMode_t::explicit1G ? "1048576kB" : "2048kB");
+
+  const auto readCounter = [&poolPath](const char *counterName)
+  {
+    size_t        value = 0;
+    std::ifstream counterFile(poolPath + "/" + counterName);
+    counterFile >> value;
+    return value;
+  };
+
+  const size_t freePages     = readCounter("free_hugepages");
+  const size_t reservedPages = readCounter("resv_hugepages");
+  return freePages > reservedPages ? freePages - reservedPages : 0;
+}
+
+/**
+ * Reserves page-aligned virtual memory of (at least) the given size, without committing it.
+ *
+ * With regular (or transparent huge) pages, the range is readable and writable right away, and physical pages are only
+ * assigned on first touch. With explicit huge pages, the range is inaccessible until it is committed (see commit), so
+ * that only the parts actually used take pages from the pool.
+ */
+__INLINE__ uint8_t *reserveAddressSpace(const size_t size, const hugePageMode_t mode)
+{
+  const size_t pageSize     = getPageSize(mode);
+  const size_t reservedSize = roundToPageSize(size, mode);
+
+  // Huge pages need the range aligned to the huge page size, so an extra page is reserved to align it
+  const bool   needsAlignment = mode != hugePageMode_t::none;
+  const size_t mappedSize     = needsAlignment ? reservedSize + pageSize : reservedSize;
+  const int    protection     = isExplicit(mode) ? PROT_NONE : PROT_READ | PROT_WRITE;
+
+  void *mapping = mmap(nullptr, mappedSize, protection, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (mapping == MAP_FAILED) JAFFAR_THROW_RUNTIME("Could not reserve %lu bytes of memory with huge page mode '%s'\n", reservedSize, getModeName(mode));
+
+  auto *buffer = (uint8_t *)mapping;
+  if (needsAlignment == true)
+  {
+    // Trimming the unaligned head and the tail of the mapping
+    auto        *alignedBuffer = (uint8_t *)((((uintptr_t)buffer + pageSize - 1) / pageSize) * pageSize);
+    const size_t headSize      = alignedBuffer - buffer;
+    if (headSize > 0) munmap(buffer, headSize);
+    if (pageSize - headSize > 0) munmap(alignedBuffer + reservedSize, pageSize - headSize);
+    buffer = alignedBuffer;
+  }
+
+  // Advising the kernel to back the range with huge pages
+  if (mode == hugePageMode_t::transparent)
+    if (madvise(buffer, reservedSize, MADV_HUGEPAGE) != 0) JAFFAR_THROW_RUNTIME("Transparent huge pages were requested, but the system does not support them\n");
+
+  return buffer;
+}
+
+/**
+ * Commits (at least) the given size of a range obtained with reserveAddressSpace, starting at a page boundary.
+ *
+ * Explicit huge pages are reserved from the pool here, so that running out of them is reported now, instead of as a
+ * SIGBUS when a page is first touched (possibly hours into a run). Other modes need no commit, since their pages are
+ * assigned on first touch.
+ */
+__INLINE__ void commit(uint8_t *const buffer, const size_t size, const hugePageMode_t mode)
+{
+  if (isExplicit(mode) == false) return;
+
+  const size_t pageSize      = getPageSize(mode);
+  const size_t committedSize = roundToPageSize(size, mode);
+  const size_t pageCount     = committedSize / pageSize;
+
+  // Checking the pool first, for a clearer error than the one given by the kernel
+  const size_t availablePageCount = getAvailablePageCount(mode);
+  if (pageCount > availablePageCount)
+    JAFFAR_THROW_RUNTIME("Could not reserve %lu bytes of memory with huge page mode '%s': %lu huge pages are needed, but only %lu are available in the pool (see /proc/sys/vm/nr_hugepages)\n",
+                         committedSize,
+                         getModeName(mode),
+                         pageCount,
+                         availablePageCount);
+
+  // Replacing the inaccessible range with huge pages. Without MAP_NORESERVE, the kernel reserves them all from the pool, or fails
+  const int flags   = MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_HUGETLB | (mode == hugePageMode_t::explicit2M ? MAP_HUGE_2MB : MAP_HUGE_1GB);
+  void     *mapping = mmap(buffer, committedSize, PROT_READ | PROT_WRITE, flags, -1, 0);
+  if (mapping == MAP_FAILED)
+    JAFFAR_THROW_RUNTIME("Could not reserve %lu bytes of memory with huge page mode '%s': %s\n", committedSize, getModeName(mode), strerror(errno));
+}
+
+/**
+ * Reserves and commits zeroed, page-aligned memory of (at least) the given size. Physical pages are only assigned on first touch
+ */
+__INLINE__ uint8_t *reserve(const size_t size, const hugePageMode_t mode)
+{
+  auto *buffer = reserveAddressSpace(size, mode);
+  commit(buffer, size, mode);
+  return buffer;
+}
+
+/**
+ * Releases memory previously obtained with reserve or reserveAddressSpace, with the same size and mode
+ */
+__INLINE__ void release(uint8_t *const buffer, const size_t size, const hugePageMode_t mode) { munmap(buffer, roundToPageSize(size, mode)); }
+
+} // namespace hugePages
+
+} // namespace jaffarPlus
@@ -0,0 +1,263 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <jaffarCommon/logger.hpp>
+#include <jaffarCommon/parallel.hpp>
+#include "checkpoint.hpp"
+#include "inputSet.hpp"
+
+namespace jaffarPlus
+{
+
+/**
+ * Append-only log of the inputs taken by every stored state, shared by all the runners of a search.
+ * Each record holds the input taken at a given step and a link to the record of the step before it, so a state
+ * only needs to carry the identifier of its latest record; its full input history is rebuilt by walking the parent links.
+ * Records are kept in one segment per step and appended to per-thread chunks, so appending requires no locking in the common case.
+ * Records that are no longer reachable from the newest step are removed by collect(), which is called between steps.
+ */
+class InputHistoryLog final
+{
+  public:
+
+  // Identifier of a record within the segment of its step
+  typedef uint32_t recordId_t;
+
+  // Identifier used for the (non-existing) parent of the records of the first step
+  static constexpr recordId_t noRecord = std::numeric_limits<recordId_t>::max();
+
+  InputHistoryLog(const size_t maxSteps)
+    : _segments(maxSteps)
+    , _threadCursors(jaffarCommon::parallel::getMaxThreadCount())
+  {}
+
+  ~InputHistoryLog() = default;
+
+  // Appends a new record for the given step and returns its identifier
+  __INLINE__ recordId_t append(const size_t step, const recordId_t parent, const InputSet::inputIndex_t inputIdx)
+  {
+    // Safety check
+    if (step >= _segments.size()) JAFFAR_THROW_RUNTIME("[ERROR] Trying to store input for step %lu, but the input history log only holds %lu steps\n", step, _segments.size());
+
+    // Getting this thread's cursor
+    auto &cursor = _threadCursors[jaffarCommon::parallel::getThreadId()];
+
+    // If the thread has no room left in its chunk for this step, get a new one
+    if (cursor.step != step || cursor.remaining == 0) reserveChunk(cursor, step);
+
+    // Storing record through the cursor, since other threads may be adding chunks to the segment meanwhile
+    cursor.chunk[_chunkSize - cursor.remaining] = record_t{.parent = parent, .inputIdx = inputIdx};
+    cursor.remaining--;
+
+    return cursor.nextRecordId++;
+  }
+
+  // Gets the parent record of a given record
+  __INLINE__ recordId_t getParent(const size_t step, const recordId_t recordId) const { return getRecord(step, recordId).parent; }
+
+  // Gets the input stored in a given record
+  __INLINE__ InputSet::inputIndex_t getInput(const size_t step, const recordId_t recordId) const { return getRecord(step, recordId).inputIdx; }
+
+  /**
+   * Removes the records that cannot be reached from the records of the newest step, and compacts the segments that contained them.
+   * All records of the newest step are considered reachable, since they belong to the states just stored.
+   * Removing a record can only make records of older steps unreachable, so the collection stops at the first step where nothing was removed.
+   * This must not run concurrently with appends, and it invalidates the record identifiers of any state not stored in the newest step.
+   */
+  void collect()
+  {
+    // Invalidating all the thread cursors, since their chunks are about to be compacted
+    for (auto &cursor : _threadCursors) cursor.step = noStep;
+
+    // Finding the newest step with records
+    size_t newestStep = _segments.size();
+    while (newestStep > 0 && _segments[newestStep - 1].chunks.empty()) newestStep--;
+
+    // Nothing to do if there is no older step to compact
+    if (newestStep <= 1) return;
+
+    for (size_t step = newestStep - 1; step-- > 0;)
+    {
+      auto &segment = _segments[step];
+      auto &child   = _segments[step + 1];
+
+      // Marking the records referenced from the following step
+      std::vector<uint8_t> isReachable(segment.chunks.size() * _chunkSize, 0);
+      for (auto &chunk : child.chunks)
+        for (size_t i = 0; i < _chunkSize; i++)
+          if (chunk[i].inputIdx != emptyInput && chunk[i].parent != noRecord) isReachable[chunk[i].parent] = 1;
+
+      // Building the compacted segment and the translation from old to new identifiers
+      std::vector<recordId_t>                  newRecordIds(isReachable.size(), noRecord);
+      std::vector<std::unique_ptr<record_t[]>> newChunks;
+      size_t                                   newRecordCount     = 0;
+      size_t                                   removedRecordCount = 0;
+      for (size_t recordId = 0; recordId < isReachable.size(); recordId++)
+      {
+        const auto &record = segment.chunks[recordId / _chunkSize][recordId % _chunkSize];
+
+        // Skipping unused slots
+        if (record.inputIdx == emptyInput) continue;
+
+        // Skipping unreachable records
+        if (isReachable[recordId] == 0)
+        {
+          removedRecordCount++;
+          continue;
+        }
+
+        // Moving record into the compacted segment
+        if (newRecordCount % _chunkSize == 0) newChunks.push_back(allocateChunk());
+        newChunks.back()[newRecordCount % _chunkSize] = record;
+        newRecordIds[recordId]                        = newRecordCount++;
+      }
+
+      // Replacing segment storage and updating the following step's parent links
+      _collectedRecords += removedRecordCount;
+      segment.chunks = std::move(newChunks);
+      for (auto &chunk : child.chunks)
+        for (size_t i = 0; i < _chunkSize; i++)
+          if (chunk[i].inputIdx != emptyInput && chunk[i].parent != noRecord) chunk[i].parent = newRecordIds[chunk[i].parent];
+
+      // If no record was removed here, older steps remain fully reachable
+      if (removedRecordCount == 0) break;
+    }
+  }
+
+  // Total memory held by the records, in bytes
+  __INLINE__ size_t getStorageSize() const
+  {
+    size_t chunkCount = 0;
+    for (const auto &segment : _segments) chunkCount += segment.chunks.size();
+    return chunkCount * _chunkSize * sizeof(record_t);
+  }
+
+  // Number of records removed by collection so far
+  __INLINE__ size_t getCollectedRecordCount() const { return _collectedRecords; }
+
+  // Writes all the segments into a checkpoint file. This must not run concurrently with appends
+  void saveCheckpoint(const std::string &filePath) const
+  {
+    checkpoint::Writer writer(filePath);
+
+    writer.push<size_t>(_segments.size());
+    for (const auto &segment : _segments)
+    {
+      writer.push<size_t>(segment.chunks.size());
+      for (const auto &chunk : segment.chunks) writer.push(chunk.get(), _chunkSize * sizeof(record_t));
+    }
+
+    writer.close();
+  }
+
+  // Replaces all the segments with the ones in a checkpoint file
+  void loadCheckpoint(const std::string &filePath)
+  {
+    checkpoint::Reader reader(filePath);
+
+    const auto segmentCount = reader.pop<size_t>();
+    if (segmentCount != _segments.size())
+      JAFFAR_THROW_LOGIC("[ERROR] The checkpoint input history holds %lu steps, but the configured one holds %lu\n", segmentCount, _segments.size());
+
+    // Invalidating all the thread cursors, since their chunks are about to be replaced
+    for (auto &cursor : _threadCursors) cursor.step = noStep;
+
+    for (auto &segment : _segments)
+    {
+      segment.chunks.clear();
+      const auto chunkCount = reader.pop<size_t>();
+      for (size_t i = 0; i < chunkCount; i++)
+      {
+        segment.chunks.push_back(std::make_unique<record_t[]>(_chunkSize));
+        reader.pop(segment.chunks.back().get(), _chunkSize * sizeof(record_t));
+      }
+    }
+  }
+
+  private:
+
+  // A single input history record
+  struct record_t
+  {
+    // Identifier of the record for the previous step
+    recordId_t parent;
+
+    // Input taken at this step
+    InputSet::inputIndex_t inputIdx;
+  };
+
+  // All the records for a given step
+  struct segment_t
+  {
+    // Fixed-size chunks of records
+    std::vector<std::unique_ptr<record_t[]>> chunks;
+
+    // Lock for adding new chunks
+    std::mutex mutex;
+  };
+
+  // Per-thread position of the chunk being filled
+  struct alignas(64) threadCursor_t
+  {
+    size_t     step = noStep;
+    record_t  *chunk;
+    recordId_t nextRecordId;
+    size_t     remaining;
+  };
+
+  // Input index marking a slot that was never used
+  static constexpr InputSet::inputIndex_t emptyInput = std::numeric_limits<InputSet::inputIndex_t>::max();
+
+  // Step value for cursors not yet in use
+  static constexpr size_t noStep = std::numeric_limits<size_t>::max();
+
+  // Number of records per chunk
+  static constexpr size_t _chunkSize = 4096;
+
+  __INLINE__ const record_t &getRecord(const size_t step, const recordId_t recordId) const { return _segments[step].chunks[recordId / _chunkSize][recordId % _chunkSize]; }
+
+  // Allocates a chunk with all its slots marked as unused
+  static __INLINE__ std::unique_ptr<record_t[]> allocateChunk()
+  {
+    auto chunk = std::make_unique<record_t[]>(_chunkSize);
+    for (size_t i = 0; i < _chunkSize; i++) chunk[i] = record_t{.parent = noRecord, .inputIdx = emptyInput};
+    return chunk;
+  }
+
+  // Reserves a new chunk of the given step's segment for a thread
+  __INLINE__ void reserveChunk(threadCursor_t &cursor, const size_t step)
+  {
+    auto &segment = _segments[step];
+
+    // Allocating outside the lock, since this is the expensive part
+    auto chunk = allocateChunk();
+
+    cursor.chunk = chunk.get();
+    segment.mutex.lock();
+    const size_t chunkId = segment.chunks.size();
+    segment.chunks.push_back(std::move(chunk));
+    segment.mutex.unlock();
+
+    // Making sure record identifiers remain representable
+    if ((chunkId + 1) * _chunkSize >= noRecord) JAFFAR_THROW_RUNTIME("[ERROR] Exceeded the maximum number of input history records for step %lu\n", step);
+
+    cursor.step         = step;
+    cursor.nextRecordId = chunkId * _chunkSize;
+    cursor.remaining    = _chunkSize;
+  }
+
+  // Record segments, one per step
+  std::vector<segment_t> _segments;
+
+  // Per-thread append cursors
+  std::vector<threadCursor_t> _threadCursors;
+
+  // Number of records removed by collection so far
+  size_t _collectedRecords = 0;
+};
+
+} // namespace jaffarPlus
@@ -23,22 +23,20 @@ class InputSet final
   __INLINE__ bool evaluate() const
   {
     for (const auto &c : _conditions)
-      if (c->evaluate() == false) return false;
+      if (c.evaluate() == false) return false;
     return true;
   }
 
   void                                    addInput(const inputIndex_t inputIdx) { _inputIndexes.insert(inputIdx); }
-  void                                    addCondition(std::unique_ptr<Condition> condition) { _conditions.insert(std::move(condition)); }
+  void                                    addCondition(const Condition &condition) { _conditions.push_back(condition); }
   const std::unordered_set<inputIndex_t> &getInputIndexes() const { return _inputIndexes; }
   bool                                    getStopInputEvaluationFlag() const { return _stopInputEvaluation; }
   void                                    setStopInputEvaluationFlag(const bool stopInputEvaluation) { _stopInputEvaluation = stopInputEvaluation; }
 
   private:
 
-  // Conditions are evaluated frequently, so this optimized for performance
-  // Operands are pre-parsed as pointers/immediates and the evaluation function
-  // is a template that is created at compilation time.
-  std::unordered_set<std::unique_ptr<Condition>> _conditions;
+  // Conditions are evaluated frequently, so they are stored as flat records
+  std::vector<Condition> _conditions;
 
   // Storage for game-specific actions
   std::unordered_set<inputIndex_t> _inputIndexes;
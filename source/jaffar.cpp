@@ -11,6 +11,8 @@ int main(int argc, char *argv[])
 
   program.add_argument("configFile").help("path to the Jaffar configuration script (.jaffar) file to run.").required();
 
+  program.add_argument("--resume").help("path to a checkpoint directory to resume the search from.").default_value(std::string(""));
+
   // Try to parse arguments
   try
   {
@@ -49,6 +51,10 @@ int main(int argc, char *argv[])
   // Initializing driver
   d->initialize();
 
+  // If requested, resume from a checkpoint
+  const auto resumeCheckpointPath = program.get<std::string>("--resume");
+  if (resumeCheckpointPath.empty() == false) d->setResumeCheckpointPath(resumeCheckpointPath);
+
   // Running driver
   auto exitReason = d->run();
 
@@ -89,9 +89,6 @@ class Playback final
       // Evaluate game rules
       _runner->getGame()->evaluateRules();
 
-      // Determining new game state type
-      _runner->getGame()->updateGameStateType();
-
       // Updating game reward
       _runner->getGame()->updateReward();
 
@@ -131,6 +131,7 @@ class Property
   }
 
   datatype_t                 getDatatype() const { return _datatype; }
+  endianness_t               getEndianness() const { return _endianness; }
   std::string                getName() const { return _name; }
   jaffarCommon::hash::hash_t getNameHash() const { return _nameHash; }
   void                      *getPointer() const { return _pointer; }
@@ -24,7 +24,7 @@ class Rule final
   __INLINE__ bool evaluate() const
   {
     for (const auto &c : _conditions)
-      if (c->evaluate() == false) return false;
+      if (c.evaluate() == false) return false;
     return true;
   }
 
@@ -34,7 +34,7 @@ class Rule final
   void setCheckpointRule(const bool isCheckpointRule) { _isCheckpointRule = isCheckpointRule; }
   void setCheckpointTolerance(const size_t checkPointTolerance) { _checkPointTolerance = checkPointTolerance; }
   void addAction(const std::function<void()> &function) { _actions.push_back(function); }
-  void addCondition(std::unique_ptr<Condition> condition) { _conditions.insert(std::move(condition)); }
+  void addCondition(const Condition &condition) { _conditions.push_back(condition); }
   void addSatisfyRuleLabel(const label_t satisfyRuleLabel) { _satisfyRuleLabels.insert(satisfyRuleLabel); }
 
   label_t                                   getLabel() const { return _label; }
@@ -46,13 +46,13 @@ class Rule final
   std::unordered_set<label_t>               getSatisfyRuleLabels() const { return _satisfyRuleLabels; }
   size_t                                    getIndex() const { return _index; }
   const std::vector<std::function<void()>> &getActions() const { return _actions; }
+  const std::vector<Condition>             &getConditions() const { return _conditions; }
 
   private:
 
-  // Conditions are evaluated frequently, so this optimized for performance
-  // Operands are pre-parsed as pointers/immediates and the evaluation function
-  // is a template that is created at compilation time.
-  std::unordered_set<std::unique_ptr<Condition>> _conditions;
+  // Conditions are stored as flat records, in the order they were declared.
+  // The game compiles them into a single contiguous array for evaluation.
+  std::vector<Condition> _conditions;
 
   // Internal index for sequential access
   const size_t _index;
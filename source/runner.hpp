@@ -1,7 +1,9 @@
 #pragma once
 
 #include <memory>
-#include <set>
+#include <algorithm>
+#include <map>
+#include <unordered_map>
 #include <vector>
 #include <cstdint>
 #include <jaffarCommon/bitwise.hpp>
@@ -14,6 +16,10 @@
 #include <jaffarCommon/serializers/differential.hpp>
 #include <gameList.hpp>
 #include "game.hpp"
+#include "hashPolicy/metroHash128.hpp"
+#include "hashPolicy/wideLane.hpp"
+#include "hashPolicy/xxh3.hpp"
+#include "inputHistoryLog.hpp"
 #include "inputSet.hpp"
 
 namespace jaffarPlus
@@ -23,16 +29,61 @@ class Runner final
 {
   public:
 
+  // Bitmask indicating which input sets have their conditions satisfied
+  typedef uint64_t inputSetMask_t;
+  static constexpr size_t inputSetMaskBits = sizeof(inputSetMask_t) * 8;
+
+  // Cache of input lists, indexed by the input set mask that produces them
+  typedef std::unordered_map<inputSetMask_t, std::vector<InputSet::inputIndex_t>> inputListCache_t;
+
+  // Hash function used to compute state hashes
+  enum hashFunction_t
+  {
+    metroHash128,
+    xxh3,
+    wideLane
+  };
+
   // Base constructor
   Runner(std::unique_ptr<Game> &game, const nlohmann::json &config)
     : _game(std::move(game))
   {
     _hashStepTolerance = jaffarCommon::json::getNumber<uint32_t>(config, "Hash Step Tolerance");
 
+    // Parsing hash function
+    const auto &hashFunctionString     = jaffarCommon::json::getString(config, "Hash Function");
+    bool        hashFunctionRecognized = false;
+
+    if (hashFunctionString == "MetroHash128")
+    {
+      _hashFunction          = hashFunction_t::metroHash128;
+      hashFunctionRecognized = true;
+    }
+
+    if (hashFunctionString == "XXH3-128")
+    {
+#ifndef JAFFAR_USE_XXHASH
+      JAFFAR_THROW_LOGIC("Hash function '%s' requested, but Jaffar was built without libxxhash", hashFunctionString.c_str());
+#endif
+      _hashFunction          = hashFunction_t::xxh3;
+      hashFunctionRecognized = true;
+    }
+
+    if (hashFunctionString == "Wide Lane")
+    {
+      _hashFunction          = hashFunction_t::wideLane;
+      hashFunctionRecognized = true;
+    }
+
+    if (hashFunctionRecognized == false) JAFFAR_THROW_LOGIC("Hash function '%s' not recognized", hashFunctionString.c_str());
+
     const auto &inputHistoryJs = jaffarCommon::json::getObject(config, "Store Input History");
     _inputHistoryEnabled       = jaffarCommon::json::getBoolean(inputHistoryJs, "Enabled");
     _inputHistoryMaxSize       = jaffarCommon::json::getNumber<uint32_t>(inputHistoryJs, "Max Size (Steps)");
 
+    // If storing input history, create its log. It may be replaced later by one shared with other runners
+    if (_inputHistoryEnabled == true) _inputHistoryLog = std::make_shared<InputHistoryLog>(_inputHistoryMaxSize);
+
     // Storing game inputs for delayed parsing
     _allowedInputSetsJs = jaffarCommon::json::getArray<nlohmann::json>(config, "Allowed Input Sets");
 
@@ -46,41 +97,12 @@ class Runner final
     _initialSequenceFilePath = jaffarCommon::json::getString(config, "Initial Sequence File Path");
   }
 
+  /**
+   * Initializes the runner, playing the initial sequence (if provided)
+   */
   void initialize()
   {
-    if (_isInitialized == true) JAFFAR_THROW_LOGIC("This runner instance was already initialized");
-
-    // Initializing game, if not already initialized
-    if (_game->isInitialized() == false) _game->initialize();
-
-    // Parsing possible game inputs
-    for (const auto &inputSetJs : _allowedInputSetsJs) _allowedInputSets.push_back(std::move(parseInputSet(inputSetJs)));
-
-    // If testing candidate inputs, parse them now
-    if (_testCandidateInputs == true)
-      for (const auto &inputSetJs : _candidateInputSetsJs) _candidateInputSets.push_back(std::move(parseInputSet(inputSetJs)));
-
-    // If storing input history, allocate input history storage
-    if (_inputHistoryEnabled == true)
-    {
-      // Calculating bit storage for the possible inputs index
-      _inputIndexSizeBits = jaffarCommon::bitwise::getEncodingBitsForElementCount(_currentInputIndex);
-
-      // Total size in bits for the input history
-      size_t inputHistorySizeBits = _inputHistoryMaxSize * _inputIndexSizeBits;
-
-      // Total size in bytes
-      size_t inputHistorySizeBytes = inputHistorySizeBits / 8;
-
-      // Add one byte if not perfectly divisible by 8
-      if (inputHistorySizeBits % 8 > 0) inputHistorySizeBytes++;
-
-      // Allocating storage now
-      _inputHistory.resize(inputHistorySizeBytes);
-
-      // Clearing storage (set to zero)
-      memset(_inputHistory.data(), 0, _inputHistory.size());
-    }
+    initializeImpl();
 
     // Advancing the state using the initial sequence, if provided
     if (_initialSequenceFilePath != "")
@@ -101,6 +123,36 @@ class Runner final
     }
   }
 
+  /**
+   * Initializes the runner as a copy of an already initialized (prototype) runner, given its full state (see
+   * serializeFullState). This skips playing the initial sequence, which only the prototype needs to do.
+   */
+  void initializeFromPrototype(const std::string &prototypeState)
+  {
+    initializeImpl();
+
+    // Loading the prototype's state, including the state properties disabled for the run
+    auto emulator = _game->getEmulator();
+    emulator->enableStateProperties();
+    jaffarCommon::deserializer::Contiguous d(prototypeState.data(), prototypeState.size());
+    deserializeState(d);
+    emulator->disableStateProperties();
+  }
+
+  /**
+   * Serializes the full state of the runner, including the state properties disabled for the run, to initialize other runners from it
+   */
+  std::string serializeFullState()
+  {
+    auto emulator = _game->getEmulator();
+    emulator->enableStateProperties();
+    std::string                          fullState(getStateSize(), '\0');
+    jaffarCommon::serializer::Contiguous s(fullState.data(), fullState.size());
+    serializeState(s);
+    emulator->disableStateProperties();
+    return fullState;
+  }
+
   std::unique_ptr<InputSet> parseInputSet(const nlohmann::json &inputSetJs)
   {
     // Creating new input set to add
@@ -147,6 +199,9 @@ class Runner final
 
       // Adding new input index->string to the map
       _inputStringMap[inputIdx] = input;
+
+      // Registering the input with the game, so that it gets decoded only once. The handle is stored at the input's index
+      _inputHandles.push_back(_game->registerInput(input));
     }
 
     // If it is, just get it from there
@@ -156,31 +211,44 @@ class Runner final
     return inputIdx;
   }
 
-  std::set<InputSet::inputIndex_t> getInputsFromInputSets(const std::vector<std::unique_ptr<InputSet>> &inputSets) const
+  /**
+   * Gets the inputs allowed by the given input sets for the current state. The input sets whose conditions are satisfied
+   * are encoded as a bitmask, which is used to look up the (sorted, duplicate-free) list of inputs they allow. The list
+   * is only built the first time a given combination is found; afterwards, no allocation is needed.
+   */
+  __INLINE__ const std::vector<InputSet::inputIndex_t> &getInputsFromInputSets(const std::vector<std::unique_ptr<InputSet>> &inputSets, inputListCache_t &cache) const
   {
-    // Storage for the possible input set
-    std::set<InputSet::inputIndex_t> possibleInputs;
-
-    // For all registered input sets, see which ones satisfy their conditions and add them
-    for (const auto &inputSet : inputSets)
-      if (inputSet->evaluate() == true)
+    // Determining which input sets have their conditions satisfied
+    inputSetMask_t inputSetMask = 0;
+    for (size_t i = 0; i < inputSets.size(); i++)
+      if (inputSets[i]->evaluate() == true)
       {
-        possibleInputs.insert(inputSet->getInputIndexes().begin(), inputSet->getInputIndexes().end());
-
-        // Getting stop evaluating flag
-        bool stopEvaluating = inputSet->getStopInputEvaluationFlag();
+        inputSetMask |= (inputSetMask_t)1 << i;
 
-        // If stop evaluation is set, then return now
-        if (stopEvaluating) break;
+        // If stop evaluation is set, then do not consider the rest of the input sets
+        if (inputSets[i]->getStopInputEvaluationFlag() == true) break;
       }
 
-    // Return possible inputs
-    return possibleInputs;
+    // If this combination was found before, return its input list now
+    const auto cacheItr = cache.find(inputSetMask);
+    if (cacheItr != cache.end()) return cacheItr->second;
+
+    // Otherwise, gathering the inputs of all the satisfied input sets
+    std::vector<InputSet::inputIndex_t> possibleInputs;
+    for (size_t i = 0; i < inputSets.size(); i++)
+      if ((inputSetMask & ((inputSetMask_t)1 << i)) != 0) possibleInputs.insert(possibleInputs.end(), inputSets[i]->getInputIndexes().begin(), inputSets[i]->getInputIndexes().end());
+
+    // Sorting and removing duplicates
+    std::sort(possibleInputs.begin(), possibleInputs.end());
+    possibleInputs.erase(std::unique(possibleInputs.begin(), possibleInputs.end()), possibleInputs.end());
+
+    // Storing the new list in the cache and returning it
+    return cache.emplace(inputSetMask, std::move(possibleInputs)).first->second;
   }
 
-  __INLINE__ const auto getAllowedInputs() const { return getInputsFromInputSets(_allowedInputSets); }
+  __INLINE__ const std::vector<InputSet::inputIndex_t> &getAllowedInputs() const { return getInputsFromInputSets(_allowedInputSets, _allowedInputsCache); }
 
-  __INLINE__ const auto getCandidateInputs() const { return getInputsFromInputSets(_candidateInputSets); }
+  __INLINE__ const std::vector<InputSet::inputIndex_t> &getCandidateInputs() const { return getInputsFromInputSets(_candidateInputSets, _candidateInputsCache); }
 
   // Function to advance state.
   __INLINE__ jaffarPlus::InputSet::inputIndex_t getInputIndex(const std::string &input) const
@@ -209,13 +277,10 @@ class Runner final
   void advanceState(const InputSet::inputIndex_t inputIdx)
   {
     // Safety check
-    if (_inputStringMap.contains(inputIdx) == false) JAFFAR_THROW_RUNTIME("Move Index %u not found in runner\n", inputIdx);
-
-    // Getting input string
-    const auto &inputString = _inputStringMap[inputIdx];
+    if (inputIdx >= _inputHandles.size()) JAFFAR_THROW_RUNTIME("Move Index %u not found in runner\n", inputIdx);
 
-    // Performing the requested input
-    _game->advanceState(inputString);
+    // Performing the requested input, through its pre-decoded handle
+    _game->advanceState(_inputHandles[inputIdx]);
 
     // If storing input history, do it now
     if (_inputHistoryEnabled == true)
@@ -224,8 +289,12 @@ class Runner final
       if (_currentStep >= _inputHistoryMaxSize)
         JAFFAR_THROW_RUNTIME("[ERROR] Trying to advance step when storing input history is enabled and the maximum step (%lu) has been reached\n", _inputHistoryMaxSize);
 
-      // Storing the new more in the input history
-      setInput(_currentStep, inputIdx);
+      // Storing the previous input, if it was not yet stored, before replacing it
+      storePendingInput();
+
+      // The new input is only stored in the log if this state gets serialized
+      _inputHistoryPendingInput    = inputIdx;
+      _inputHistoryHasPendingInput = true;
     }
 
     // Advancing step counter
@@ -242,32 +311,32 @@ class Runner final
     _currentStep++;
   }
 
-  __INLINE__ void setInput(const size_t stepId, const InputSet::inputIndex_t inputIdx)
-  {
-    // Using bit-encoded copy to store the new input
-    jaffarCommon::bitwise::bitcopy(_inputHistory.data(), _inputHistory.size(), stepId, &inputIdx, sizeof(InputSet::inputIndex_t), 0, 1, _inputIndexSizeBits);
-  }
-
-  __INLINE__ InputSet::inputIndex_t getInput(const size_t stepId) const
+  // Appends the last input taken to the input history log, if it was not yet stored
+  __INLINE__ void storePendingInput() const
   {
-    // Temporary storage for the new input
-    InputSet::inputIndex_t inputIdx = 0;
+    if (_inputHistoryHasPendingInput == false) return;
 
-    // Using bit-encoded copy to store the new input
-    jaffarCommon::bitwise::bitcopy(&inputIdx, sizeof(InputSet::inputIndex_t), 0, _inputHistory.data(), _inputHistory.size(), stepId, 1, _inputIndexSizeBits);
-
-    // Returning value
-    return inputIdx;
+    // The pending input was taken at the step before the current one
+    _inputHistoryRecord          = _inputHistoryLog->append(_currentStep - 1, _inputHistoryRecord, _inputHistoryPendingInput);
+    _inputHistoryHasPendingInput = false;
   }
 
+  // Sets the input history log to use. Runners whose states are loaded into one another must share the same log
+  __INLINE__ void setInputHistoryLog(const std::shared_ptr<InputHistoryLog> &inputHistoryLog) { _inputHistoryLog = inputHistoryLog; }
+  __INLINE__ const std::shared_ptr<InputHistoryLog> &getInputHistoryLog() const { return _inputHistoryLog; }
+
   // Serialization routine
   __INLINE__ void serializeState(jaffarCommon::serializer::Base &serializer) const
   {
     // Performing differential serialization of the internal game instance
     _game->serializeState(serializer);
 
-    // Serializing input history data
-    if (_inputHistoryEnabled == true) serializer.push(_inputHistory.data(), _inputHistory.size());
+    // Serializing the reference to the latest input history record, storing the last input in the log first
+    if (_inputHistoryEnabled == true)
+    {
+      storePendingInput();
+      serializer.pushContiguous(&_inputHistoryRecord, sizeof(_inputHistoryRecord));
+    }
 
     // Serializing current step
     serializer.pushContiguous(&_currentStep, sizeof(_currentStep));
@@ -279,8 +348,12 @@ class Runner final
     // Performing differential serialization of the internal game instance
     _game->deserializeState(deserializer);
 
-    // Deserializing input history
-    if (_inputHistoryEnabled == true) deserializer.pop(_inputHistory.data(), _inputHistory.size());
+    // Deserializing the reference to the latest input history record
+    if (_inputHistoryEnabled == true)
+    {
+      deserializer.popContiguous(&_inputHistoryRecord, sizeof(_inputHistoryRecord));
+      _inputHistoryHasPendingInput = false;
+    }
 
     // Deserializing current step
     deserializer.popContiguous(&_currentStep, sizeof(_currentStep));
@@ -303,11 +376,22 @@ class Runner final
     return contiguousSize + maxDifferences;
   }
 
-  // This function computes the hash for the current runner state
+  // This function computes the hash for the current runner state, with the configured hash function
+  __INLINE__ jaffarCommon::hash::hash_t computeHash() const
+  {
+    if (_hashFunction == hashFunction_t::wideLane) return computeHash<hashPolicy::WideLane>();
+#ifdef JAFFAR_USE_XXHASH
+    if (_hashFunction == hashFunction_t::xxh3) return computeHash<hashPolicy::XXH3>();
+#endif
+    return computeHash<hashPolicy::MetroHash128>();
+  }
+
+  // This function computes the hash for the current runner state, with the given hash policy
+  template <class hashPolicy_t>
   __INLINE__ jaffarCommon::hash::hash_t computeHash() const
   {
     // Storage for hash calculation
-    MetroHash128 hashEngine;
+    hashPolicy_t hashEngine;
 
     // Calculating hash tolerance stage
     auto hashStepToleranceStage = getHashStepToleranceStage();
@@ -318,9 +402,7 @@ class Runner final
     // Processing hashing from the game proper
     _game->computeHash(hashEngine);
 
-    jaffarCommon::hash::hash_t result;
-    hashEngine.Finalize(reinterpret_cast<uint8_t *>(&result));
-    return result;
+    return hashEngine.Finalize();
   }
 
   // Function to dump current inputs to a file
@@ -329,15 +411,24 @@ class Runner final
     // Fail if input history is not enabled
     if (_inputHistoryEnabled == false) return "";
 
+    // Storing the last input, if still pending
+    storePendingInput();
+
+    // Walking the parent links back from the latest record to get the inputs in reverse order
+    std::vector<InputSet::inputIndex_t> inputHistory(_currentStep);
+    auto                                recordId = _inputHistoryRecord;
+    for (size_t i = _currentStep; i-- > 0;)
+    {
+      inputHistory[i] = _inputHistoryLog->getInput(i, recordId);
+      recordId        = _inputHistoryLog->getParent(i, recordId);
+    }
+
     // Getting the history into a string
     std::string inputHistoryString;
 
     // For each entry, add the input string
-    for (size_t i = 0; i < _currentStep; i++)
+    for (const auto inputIdx : inputHistory)
     {
-      // Getting input index
-      const auto inputIdx = getInput(i);
-
       // Safety check
       if (_inputStringMap.contains(inputIdx) == false) JAFFAR_THROW_RUNTIME("Move Index %u not found in runner\n", inputIdx);
 
@@ -367,14 +458,17 @@ class Runner final
     jaffarCommon::logger::log("[J+]  + Input History Enabled: %s\n", _inputHistoryEnabled ? "true" : "false");
     if (_inputHistoryEnabled == true)
     {
-      jaffarCommon::logger::log("[J+]    + Possible Input Count: %u (Encoded in %lu bits)\n", _currentInputIndex, _inputIndexSizeBits);
-      jaffarCommon::logger::log(
-        "[J+]    + Input History Size: %u steps (%lu Bytes, %lu Bits)\n", _inputHistoryMaxSize, _inputHistory.size(), _inputIndexSizeBits * _inputHistoryMaxSize);
+      jaffarCommon::logger::log("[J+]    + Possible Input Count: %u\n", _currentInputIndex);
+      jaffarCommon::logger::log("[J+]    + Input History Log Size: %u steps (%.3f Mb)\n", _inputHistoryMaxSize, (double)_inputHistoryLog->getStorageSize() / (1024.0 * 1024.0));
+      jaffarCommon::logger::log("[J+]    + Input History Records Collected: %lu\n", _inputHistoryLog->getCollectedRecordCount());
     }
 
     // Printing runner state
     jaffarCommon::logger::log("[J+]  + Current Step: %u\n", _currentStep);
     jaffarCommon::logger::log("[J+]  + Hash: %s\n", hash.c_str());
+    if (_hashFunction == hashFunction_t::metroHash128) jaffarCommon::logger::log("[J+]  + Hash Function: MetroHash128\n");
+    if (_hashFunction == hashFunction_t::xxh3) jaffarCommon::logger::log("[J+]  + Hash Function: XXH3-128\n");
+    if (_hashFunction == hashFunction_t::wideLane) jaffarCommon::logger::log("[J+]  + Hash Function: Wide Lane\n");
     jaffarCommon::logger::log("[J+]  + Hash Step Tolerance Stage: %u / %u\n", hashStepToleranceStage, _hashStepTolerance);
 
     // Getting allowed inputs
@@ -415,6 +509,27 @@ class Runner final
 
   private:
 
+  // Performs the initialization common to all runners: initializing the game and parsing its input sets
+  void initializeImpl()
+  {
+    if (_isInitialized == true) JAFFAR_THROW_LOGIC("This runner instance was already initialized");
+
+    // Initializing game, if not already initialized
+    if (_game->isInitialized() == false) _game->initialize();
+
+    // Parsing possible game inputs
+    for (const auto &inputSetJs : _allowedInputSetsJs) _allowedInputSets.push_back(std::move(parseInputSet(inputSetJs)));
+
+    // If testing candidate inputs, parse them now
+    if (_testCandidateInputs == true)
+      for (const auto &inputSetJs : _candidateInputSetsJs) _candidateInputSets.push_back(std::move(parseInputSet(inputSetJs)));
+
+    // The satisfied input sets are encoded in a bitmask, so their number is limited by its width
+    if (_allowedInputSets.size() > inputSetMaskBits) JAFFAR_THROW_LOGIC("[ERROR] A maximum of %lu allowed input sets is supported. Provided: %lu\n", inputSetMaskBits, _allowedInputSets.size());
+    if (_candidateInputSets.size() > inputSetMaskBits)
+      JAFFAR_THROW_LOGIC("[ERROR] A maximum of %lu candidate input sets is supported. Provided: %lu\n", inputSetMaskBits, _candidateInputSets.size());
+  }
+
   // Stores whether the game has been initialized
   bool _isInitialized = false;
 
@@ -433,14 +548,21 @@ class Runner final
   // Storage for the calculated hash step tolerance stage
   uint32_t _hashStepToleranceStage;
 
+  // Hash function used to compute state hashes
+  hashFunction_t _hashFunction;
+
   // Specifies whether to store the input history
   bool _inputHistoryEnabled;
 
-  // Maximum size of input index in bits
-  size_t _inputIndexSizeBits;
+  // Input history log, shared among all runners of the same search
+  std::shared_ptr<InputHistoryLog> _inputHistoryLog;
+
+  // Identifier of the latest input history record stored for this state
+  mutable InputHistoryLog::recordId_t _inputHistoryRecord = InputHistoryLog::noRecord;
 
-  // Storage for the input history
-  std::vector<uint8_t> _inputHistory;
+  // Last input taken, not yet stored in the input history log
+  mutable InputSet::inputIndex_t _inputHistoryPendingInput;
+  mutable bool                   _inputHistoryHasPendingInput = false;
 
   // File containing an initial sequence to run before starting
   std::string _initialSequenceFilePath;
@@ -458,6 +580,9 @@ class Runner final
   // Map for getting the allowed input from index
   std::map<InputSet::inputIndex_t, std::string> _inputStringMap;
 
+  // Emulator handles of the registered inputs, indexed by input index
+  std::vector<Emulator::inputHandle_t> _inputHandles;
+
   ///////////////////////////////////////////
   // Allowed and candidate input sets
   //////////////////////////////////////////
@@ -474,6 +599,12 @@ class Runner final
   // Vector of allowed input sets
   std::vector<std::unique_ptr<InputSet>> _allowedInputSets;
 
+  // Cached allowed input lists, by satisfied input set mask
+  mutable inputListCache_t _allowedInputsCache;
+
+  // Cached candidate input lists, by satisfied input set mask
+  mutable inputListCache_t _candidateInputsCache;
+
   // Largest input set sizedetected
   size_t _largestInputSetSize = 0;
 
@@ -1,13 +1,21 @@
 #pragma once
 
+#include <algorithm>
+#include <memory>
+#include <numeric>
 #include <jaffarCommon/concurrent.hpp>
 #include <jaffarCommon/deserializers/contiguous.hpp>
 #include <jaffarCommon/deserializers/differential.hpp>
 #include <jaffarCommon/json.hpp>
 #include <jaffarCommon/logger.hpp>
+#include <jaffarCommon/parallel.hpp>
 #include <jaffarCommon/serializers/contiguous.hpp>
 #include <jaffarCommon/serializers/differential.hpp>
+#include <jaffarCommon/timing.hpp>
+#include "../checkpoint.hpp"
 #include "../runner.hpp"
+#include "codec.hpp"
+#include "xorDelta.hpp"
 
 #define _JAFFAR_STATE_PADDING_BYTES 64
 
@@ -30,7 +38,40 @@ class Base
     const auto &stateCompressionJs  = jaffarCommon::json::getObject(config, "Compression");
     _useDifferentialCompression     = jaffarCommon::json::getBoolean(stateCompressionJs, "Use Differential Compression");
     _maximumDifferentialSizeAllowed = jaffarCommon::json::getNumber<size_t>(stateCompressionJs, "Max Difference (bytes)");
-    _useZlibCompression             = jaffarCommon::json::getBoolean(stateCompressionJs, "Use Zlib Compression");
+    _useSizeClasses                 = jaffarCommon::json::getBoolean(stateCompressionJs, "Use Size Classes");
+    _codec                          = std::make_unique<Codec>(stateCompressionJs);
+    _useCodec                       = _codec->getType() != Codec::codecType_t::none;
+    _codecHeaderSize                = _useCodec ? Codec::headerSize : 0;
+
+    // Parsing how differences against the reference data are encoded
+    const auto &differentialEncoding           = jaffarCommon::json::getString(stateCompressionJs, "Differential Encoding");
+    bool        recognizedDifferentialEncoding = false;
+    if (differentialEncoding == "Serializer")
+    {
+      _useXorDelta                   = false;
+      recognizedDifferentialEncoding = true;
+    }
+    if (differentialEncoding == "XOR Delta")
+    {
+      _useXorDelta                   = true;
+      recognizedDifferentialEncoding = true;
+    }
+    if (recognizedDifferentialEncoding == false) JAFFAR_THROW_LOGIC("Differential encoding '%s' not recognized", differentialEncoding.c_str());
+
+    // Parsing how many reference states to keep, and the property whose value decides which one each state is encoded against
+    _referenceCount    = jaffarCommon::json::getNumber<size_t>(stateCompressionJs, "Reference Count");
+    _referenceProperty = jaffarCommon::json::getString(stateCompressionJs, "Reference Property");
+    _referenceIdSize   = _referenceCount > 1 ? sizeof(uint8_t) : 0;
+    if (_referenceCount == 0 || _referenceCount > maxReferenceCount) JAFFAR_THROW_LOGIC("The reference count (%lu) must be between 1 and %lu", _referenceCount, maxReferenceCount);
+    if (_referenceCount > 1 && _referenceProperty.empty()) JAFFAR_THROW_LOGIC("Using %lu reference states requires a reference property to cluster states by", _referenceCount);
+
+    // Size classes are only useful when state sizes vary, that is, with differential compression
+    if (_useSizeClasses == true && _useDifferentialCompression == false) JAFFAR_THROW_LOGIC("State size classes require differential compression to be enabled");
+
+    // The codec post-compresses the differences, so it needs differential compression as well
+    if (_useCodec == true && _useDifferentialCompression == false) JAFFAR_THROW_LOGIC("State codec '%s' requires differential compression to be enabled", Codec::getTypeName(_codec->getType()));
+    if (_useXorDelta == true && _useDifferentialCompression == false) JAFFAR_THROW_LOGIC("XOR delta encoding requires differential compression to be enabled");
+    if (_referenceCount > 1 && _useDifferentialCompression == false) JAFFAR_THROW_LOGIC("Multiple reference states require differential compression to be enabled");
   }
 
   void initialize()
@@ -43,22 +84,52 @@ class Base
     // Getting game state size
     _stateSizeRaw = _runner->getStateSize();
 
-    // Creating storage for current reference data
-    _currentReferenceData = malloc(_stateSizeRaw);
+    // Creating storage for the current and previous reference data, for each of the reference states
+    _currentReferenceData.resize(_referenceCount);
+    _previousReferenceData.resize(_referenceCount);
+    for (auto &referenceData : _currentReferenceData) referenceData = malloc(_stateSizeRaw);
+    for (auto &referenceData : _previousReferenceData) referenceData = malloc(_stateSizeRaw);
+
+    // Initially, only the first reference state is in use
+    _currentReferenceKeys = {0};
 
-    // Creating storage for  previous reference data
-    _previousReferenceData = malloc(_stateSizeRaw);
+    // Getting the size of a differentially compressed state without differences
+    size_t contiguousStateSize = 0;
+    if (_useDifferentialCompression)
+      contiguousStateSize = (_useXorDelta ? XorDelta::getMaxEncodedSize(_stateSizeRaw, 0) : _runner->getDifferentialStateSize(0)) + _codecHeaderSize + _referenceIdSize;
 
-    // Getting differential state size
-    if (_useDifferentialCompression) _differentialStateSize = _runner->getDifferentialStateSize(_maximumDifferentialSizeAllowed);
+    // If using size classes, states only take the space they need, so they can be allowed to differ as much as a raw state
+    // would take, instead of being dropped. This does not make them larger than a raw state, unless so configured
+    if (_useSizeClasses == true && _stateSizeRaw > contiguousStateSize && _maximumDifferentialSizeAllowed < _stateSizeRaw - contiguousStateSize)
+    {
+      jaffarCommon::logger::log("[J+] Raising the maximum differences allowed from %lu to %lu bytes, since size classes store states in the space they need\n",
+                                _maximumDifferentialSizeAllowed,
+                                _stateSizeRaw - contiguousStateSize);
+      _maximumDifferentialSizeAllowed = _stateSizeRaw - contiguousStateSize;
+    }
+
+    // Getting differential state size. If using a codec, states are preceded by its header. If using multiple reference
+    // states, they are preceded by the identifier of the one they were encoded against
+    if (_useDifferentialCompression)
+      _differentialStateSize = (_useXorDelta ? XorDelta::getMaxEncodedSize(_stateSizeRaw, _maximumDifferentialSizeAllowed)
+                                             : _runner->getDifferentialStateSize(_maximumDifferentialSizeAllowed)) +
+                               _codecHeaderSize + _referenceIdSize;
+
+    // Creating the per-thread buffers where states are stored in their intermediate forms: serialized before encoding them
+    // with the codec and decoded before deserializing them, and raw before and after XOR delta encoding
+    _serializationBuffers = std::vector<serializationBuffer_t>(jaffarCommon::parallel::getMaxThreadCount());
+    for (auto &buffer : _serializationBuffers)
+    {
+      if (_useCodec == true) buffer.encoded.resize(_differentialStateSize - _referenceIdSize);
+      if (_useXorDelta == true) buffer.raw.resize(_stateSizeRaw);
+    }
 
     // The effective state size is how many bytes does the runner really need to store a state
     _stateSizeEffective = _useDifferentialCompression ? _differentialStateSize : _stateSizeRaw;
 
     // We want to align each state to 512 bits (64 bytes) to favor vectorized access
     // Now calculating the necessary padding to reach the next multiple of 64 bytes
-    _stateSize = _stateSizeEffective;
-    if (_stateSize % _JAFFAR_STATE_PADDING_BYTES != 0) _stateSize = ((_stateSizeEffective / _JAFFAR_STATE_PADDING_BYTES) + 1) * _JAFFAR_STATE_PADDING_BYTES;
+    _stateSize = getPaddedSize(_stateSizeEffective);
 
     // Padding is the difference between the aligned state size and the raw one
     _stateSizePadding = _stateSize - _stateSizeEffective;
@@ -66,22 +137,59 @@ class Base
     // Setting initial value for the maximum differences found so far
     _maximumStateSizeFound = 0;
 
-    // Calling specific initialization routine for the state db type
+    // Getting the size classes, growing by a factor of 1.25 from the size of a state without differences (or the
+    // smallest padded size, if a codec may shrink it further) up to the full state size. Without size classes, all
+    // states are of the full size
+    _sizeClassSizes.clear();
+    if (_useSizeClasses == true)
+    {
+      size_t sizeClassSize = _useCodec ? _JAFFAR_STATE_PADDING_BYTES : getPaddedSize(contiguousStateSize);
+      while (sizeClassSize < _stateSize)
+      {
+        _sizeClassSizes.push_back(sizeClassSize);
+        sizeClassSize = std::max(getPaddedSize(sizeClassSize * 5 / 4), sizeClassSize + _JAFFAR_STATE_PADDING_BYTES);
+      }
+    }
+    _sizeClassSizes.push_back(_stateSize);
+    _sizeClassHistogram = std::vector<size_t>(_sizeClassSizes.size(), 0);
+
+    // Creating the next state buffers, one per thread
+    _nextStateBuffers = std::vector<nextStateBuffer_t>(jaffarCommon::parallel::getMaxThreadCount());
+    for (auto &buffer : _nextStateBuffers) buffer.sizeClassCounts = std::vector<size_t>(_sizeClassSizes.size(), 0);
+
+    // Calling specific initialization routine for the state db type, timing it since it reserves and touches all the state storage
+    const auto t0 = jaffarCommon::timing::now();
     initializeImpl();
+    _initializationTime = jaffarCommon::timing::timeDeltaNanoseconds(jaffarCommon::timing::now(), t0);
+    jaffarCommon::logger::log("[J+] State Database initialized in %.3fs\n", 1.0e-9 * (double)_initializationTime);
   }
 
   // Function to print relevant information
   void printInfo() const
   {
     const size_t currentStateCount = getStateCount();
-    const size_t currentStateBytes = currentStateCount * _stateSize;
+    size_t       currentStateBytes = currentStateCount * _stateSize;
+    size_t       maxStates         = _maxStates;
+    double       fullRatio         = (double)currentStateCount / (double)_maxStates;
 
-    jaffarCommon::logger::log("[J+]  + Current State Count:           %lu (%f Mstates) /  %lu (%f Mstates) Max / %5.2f%% Full\n",
+    // With size classes, the size of the states depends on their class, so the database is as full as its storage is,
+    // and the maximum number of states is estimated for states of their current average size
+    if (_useSizeClasses == true)
+    {
+      currentStateBytes = 0;
+      for (size_t i = 0; i < _sizeClassSizes.size(); i++) currentStateBytes += _sizeClassHistogram[i] * _sizeClassSizes[i];
+      const size_t histogramStateCount = std::accumulate(_sizeClassHistogram.begin(), _sizeClassHistogram.end(), (size_t)0);
+      if (histogramStateCount > 0) maxStates = (size_t)((double)_maxSize * (double)histogramStateCount / (double)currentStateBytes);
+      fullRatio = (double)currentStateBytes / (double)_maxSize;
+    }
+
+    jaffarCommon::logger::log("[J+]  + Current State Count:           %lu (%f Mstates) /  %lu (%f Mstates) Max%s / %5.2f%% Full\n",
                               currentStateCount,
                               (double)currentStateCount * 1.0e-6,
-                              _maxStates,
-                              (double)_maxStates * 1.0e-6,
-                              100.0 * (double)currentStateCount / (double)_maxStates);
+                              maxStates,
+                              (double)maxStates * 1.0e-6,
+                              _useSizeClasses ? " (at the current size class mix)" : "",
+                              100.0 * fullRatio);
     jaffarCommon::logger::log("[J+]  + Current State Size:            %.3f Mb (%.6f Gb) / %.3f Mb (%.6f Gb) Max\n",
                               (double)currentStateBytes / (1024.0 * 1024.0),
                               (double)currentStateBytes / (1024.0 * 1024.0 * 1024.0),
@@ -100,45 +208,172 @@ class Base
     }
 
     jaffarCommon::logger::log("[J+]  + State Size in DB:              %lu bytes (%lu padding bytes to %u)\n", _stateSize, _stateSizePadding, _JAFFAR_STATE_PADDING_BYTES);
+    jaffarCommon::logger::log("[J+]  + Initialization Time:           %.3fs\n", 1.0e-9 * (double)_initializationTime);
+    jaffarCommon::logger::log("[J+]  + Advance Step Sort (Step/Total):       %9.3fs / %9.3fs\n", 1.0e-9 * (double)_advanceStepSortTime, 1.0e-9 * (double)_advanceStepSortCumulativeTime);
+    jaffarCommon::logger::log("[J+]  + Advance Step Merge (Step/Total):      %9.3fs / %9.3fs\n", 1.0e-9 * (double)_advanceStepMergeTime, 1.0e-9 * (double)_advanceStepMergeCumulativeTime);
+    jaffarCommon::logger::log("[J+]  + Advance Step Fill (Step/Total):       %9.3fs / %9.3fs\n", 1.0e-9 * (double)_advanceStepFillTime, 1.0e-9 * (double)_advanceStepFillCumulativeTime);
+    jaffarCommon::logger::log(
+      "[J+]  + Advance Step Reference (Step/Total):  %9.3fs / %9.3fs\n", 1.0e-9 * (double)_advanceStepReferenceTime, 1.0e-9 * (double)_advanceStepReferenceCumulativeTime);
     jaffarCommon::logger::log("[J+]  + Use Differential Compression:  %s\n", _useDifferentialCompression ? "true" : "false");
     if (_useDifferentialCompression)
     {
-      jaffarCommon::logger::log("[J+]  + Use Zlib Compression:          %s\n", _useZlibCompression ? "true" : "false");
+      if (_useXorDelta == false) jaffarCommon::logger::log("[J+]  + Differential Encoding:         Serializer\n");
+      if (_useXorDelta == true) jaffarCommon::logger::log("[J+]  + Differential Encoding:         XOR Delta (%s)\n", XorDelta::getInstructionSetName());
+      jaffarCommon::logger::log("[J+]  + Reference States:              %lu in use / %lu max\n", _currentReferenceKeys.size(), _referenceCount);
+      if (_referenceCount > 1)
+        for (size_t i = 0; i < _currentReferenceKeys.size(); i++)
+          jaffarCommon::logger::log("[J+]    + Reference %3lu:                 '%s' = 0x%X\n", i, _referenceProperty.c_str(), _currentReferenceKeys[i]);
       jaffarCommon::logger::log("[J+]  + Maximum State Size Found       %lu bytes / Max Allowed: %lu bytes\n", _maximumStateSizeFound, _differentialStateSize);
+      jaffarCommon::logger::log("[J+]  + Use Size Classes:              %s\n", _useSizeClasses ? "true" : "false");
+      _codec->printInfo();
+    }
+    if (_useSizeClasses == true)
+    {
+      const size_t stateCount = std::max(std::accumulate(_sizeClassHistogram.begin(), _sizeClassHistogram.end(), (size_t)0), (size_t)1);
+      for (size_t i = 0; i < _sizeClassSizes.size(); i++)
+        jaffarCommon::logger::log("[J+]    + Size Class %6lu bytes:      %lu states (%5.2f%%)\n", _sizeClassSizes[i], _sizeClassHistogram[i], 100.0 * (double)_sizeClassHistogram[i] / (double)stateCount);
     }
     printInfoImpl();
   }
 
-  virtual void   initializeImpl()                      = 0;
-  virtual void  *getFreeState()                        = 0;
-  virtual void   returnFreeState(void *const statePtr) = 0;
-  virtual void  *popState()                            = 0;
-  virtual size_t getStateCount() const                 = 0;
+  virtual void   initializeImpl()                                    = 0;
+  virtual void   advanceStepImpl()                                   = 0;
+  virtual void  *getFreeState()                                      = 0;
+  virtual void  *getFreeSizeClassState(const size_t sizeClass)       = 0;
+  virtual size_t getStateSizeClass(const void *const statePtr) const = 0;
+  virtual void   returnFreeState(void *const statePtr)               = 0;
+  virtual void  *popState()                                          = 0;
+  virtual size_t getStateCount() const                               = 0;
 
   /**
-   * This function sets the initial reference data required for differential compression
+   * This function sets the initial reference data required for differential compression, as the first reference state
    *
    * It must be of the same size as _stateSizeRaw
    */
   __INLINE__ void setReferenceData(const void *referenceData)
   {
-    memcpy(_currentReferenceData, referenceData, _stateSizeRaw);
-    memcpy(_previousReferenceData, referenceData, _stateSizeRaw);
+    memcpy(_currentReferenceData[0], referenceData, _stateSizeRaw);
+    memcpy(_previousReferenceData[0], referenceData, _stateSizeRaw);
   }
 
   /**
-   * Copies the pointers from the next state database into the current one, starting with the largest rewards, and clears it.
+   * Copies the pointers from the next state buffers into the current state database, starting with the largest rewards, and clears them.
+   *
+   * Each thread's buffer is sorted in parallel, and the sorted runs are then combined by a merge tree in which every
+   * pairwise merge is itself split among threads (merge path). Finally, the current state database is filled while
+   * the new reference data is decoded concurrently.
    */
   __INLINE__ void advanceStep()
   {
-    // Copying state pointers
-    while (_nextStateDb.begin() != _nextStateDb.end()) _currentStateDb.push_back_no_lock(_nextStateDb.unsafe_extract(_nextStateDb.begin()).mapped());
+    // Calculating the starting position of each thread's run within the merged sequence
+    const size_t        runCount = _nextStateBuffers.size();
+    std::vector<size_t> runOffsets(runCount + 1, 0);
+    for (size_t i = 0; i < runCount; i++) runOffsets[i + 1] = runOffsets[i] + _nextStateBuffers[i].states.size();
+    const size_t nextStateCount = runOffsets[runCount];
+
+    // Making sure the merge buffers can hold all the new states
+    auto *source      = &_nextStateMergeBuffers[0];
+    auto *destination = &_nextStateMergeBuffers[1];
+    source->resize(nextStateCount);
+    destination->resize(nextStateCount);
+
+    // Sorting each run by descending reward and placing it at its position
+    const auto t0 = jaffarCommon::timing::now();
+    JAFFAR_PARALLEL_FOR
+    for (size_t i = 0; i < runCount; i++)
+    {
+      auto &states = _nextStateBuffers[i].states;
+      std::sort(states.begin(), states.end(), nextStateComparator);
+      std::copy(states.begin(), states.end(), source->begin() + runOffsets[i]);
+      states.clear();
+    }
+    _advanceStepSortTime = jaffarCommon::timing::timeDeltaNanoseconds(jaffarCommon::timing::now(), t0);
+
+    // Gathering the size classes of the new states
+    std::fill(_sizeClassHistogram.begin(), _sizeClassHistogram.end(), 0);
+    for (auto &buffer : _nextStateBuffers)
+      for (size_t i = 0; i < _sizeClassSizes.size(); i++)
+      {
+        _sizeClassHistogram[i] += buffer.sizeClassCounts[i];
+        buffer.sizeClassCounts[i] = 0;
+      }
+
+    // Merging pairs of adjacent runs, doubling their width on every pass, until a single sorted sequence remains
+    const auto t1 = jaffarCommon::timing::now();
+    for (size_t width = 1; width < runCount; width *= 2)
+    {
+      // As the number of pairs to merge decreases, each merge is split in more chunks, to keep all threads busy
+      const size_t pairCount     = (runCount + 2 * width - 1) / (2 * width);
+      const size_t chunksPerPair = (runCount + pairCount - 1) / pairCount;
+
+      JAFFAR_PARALLEL_FOR
+      for (size_t taskIdx = 0; taskIdx < pairCount * chunksPerPair; taskIdx++)
+      {
+        // Getting the pair to merge
+        const size_t runIdx     = (taskIdx / chunksPerPair) * 2 * width;
+        const size_t start      = runOffsets[runIdx];
+        const size_t middle     = runOffsets[std::min(runIdx + width, runCount)];
+        const size_t end        = runOffsets[std::min(runIdx + 2 * width, runCount)];
+        const auto  *first      = &source->data()[start];
+        const auto  *second     = &source->data()[middle];
+        const size_t firstSize  = middle - start;
+        const size_t secondSize = end - middle;
+
+        // Getting the output range that corresponds to this chunk, and the input positions that produce it
+        const size_t chunkIdx    = taskIdx % chunksPerPair;
+        const size_t outputStart = ((firstSize + secondSize) * chunkIdx) / chunksPerPair;
+        const size_t outputEnd   = ((firstSize + secondSize) * (chunkIdx + 1)) / chunksPerPair;
+        const size_t firstStart  = getMergePathSplit(first, firstSize, second, secondSize, outputStart);
+        const size_t firstEnd    = getMergePathSplit(first, firstSize, second, secondSize, outputEnd);
+
+        std::merge(&first[firstStart],
+                   &first[firstEnd],
+                   &second[outputStart - firstStart],
+                   &second[outputEnd - firstEnd],
+                   &destination->data()[start + outputStart],
+                   nextStateComparator);
+      }
+
+      std::swap(source, destination);
+    }
+    _advanceStepMergeTime = jaffarCommon::timing::timeDeltaNanoseconds(jaffarCommon::timing::now(), t1);
 
     // Swapping the reference data pointers
     std::swap(_currentReferenceData, _previousReferenceData);
 
-    // The new refernce data will be the best current state
-    if (_currentStateDb.wasSize() > 0) memcpy(_currentReferenceData, _currentStateDb.front(), _stateSizeRaw);
+    // Filling the current state database (starting with the largest rewards) on the first thread, while the last thread
+    // sets the new reference data as the best new states, in their raw (uncompressed) form
+    const auto t2                = jaffarCommon::timing::now();
+    const int  referenceThreadId = (int)runCount - 1;
+    _advanceStepReferenceTime    = 0;
+    JAFFAR_PARALLEL
+    {
+      const int threadId = jaffarCommon::parallel::getThreadId();
+
+      if (threadId == 0)
+        for (const auto &nextState : *source) _currentStateDb.push_back_no_lock(nextState.statePtr);
+
+      if (threadId == referenceThreadId && nextStateCount > 0)
+      {
+        const auto t3 = jaffarCommon::timing::now();
+        if (_useDifferentialCompression == false) memcpy(_currentReferenceData[0], source->front().statePtr, _stateSizeRaw);
+        if (_useDifferentialCompression == true) updateReferenceData(*source);
+        _advanceStepReferenceTime = jaffarCommon::timing::timeDeltaNanoseconds(jaffarCommon::timing::now(), t3);
+      }
+    }
+    _advanceStepFillTime = jaffarCommon::timing::timeDeltaNanoseconds(jaffarCommon::timing::now(), t2);
+
+    // Calling specific advance step routine for the state db type
+    advanceStepImpl();
+
+    // Once enough states were sampled, letting the codec benchmark itself and train its dictionary on them
+    if (_useCodec == true) _codec->processSamples();
+
+    // Accumulating timing
+    _advanceStepSortCumulativeTime += _advanceStepSortTime;
+    _advanceStepMergeCumulativeTime += _advanceStepMergeTime;
+    _advanceStepFillCumulativeTime += _advanceStepFillTime;
+    _advanceStepReferenceCumulativeTime += _advanceStepReferenceTime;
   }
 
   __INLINE__ bool pushState(const float reward, Runner &r, void *statePtr)
@@ -146,11 +381,21 @@ class Base
     // Check that we got a free state (we did not overflow state memory)
     if (statePtr == nullptr) JAFFAR_THROW_RUNTIME("Ran out of free states\n");
 
+    // If using size classes, the state pointer (e.g., if taken from the current state database) may be of any class, so
+    // the state must fit within its size
+    size_t sizeClass = _sizeClassSizes.size() - 1;
+    size_t maxSize   = _differentialStateSize;
+    if (_useSizeClasses == true)
+    {
+      sizeClass = getStateSizeClass(statePtr);
+      maxSize   = std::min(_sizeClassSizes[sizeClass], _differentialStateSize);
+    }
+
     // Encoding internal runner state into the state pointer
     size_t stateSize = 0;
     try
     {
-      stateSize = saveStateFromRunner(r, statePtr);
+      stateSize = saveStateFromRunner(r, statePtr, maxSize);
     }
     catch (const std::runtime_error &x)
     {
@@ -161,38 +406,94 @@ class Base
     // If using differential compression, it is important to keep track of the current compression size
     _maximumStateSizeFound = std::max(_maximumStateSizeFound, stateSize);
 
-    // Inserting new state into the next state database
-    _nextStateDb.insert({reward, statePtr});
+    // If using size classes, moving the state into the smallest class that fits it
+    if (_useSizeClasses == true) sizeClass = moveToSizeClass(statePtr, stateSize, sizeClass);
+
+    // Inserting new state into this thread's next state buffer
+    auto &buffer = _nextStateBuffers[jaffarCommon::parallel::getThreadId()];
+    buffer.states.push_back({.reward = reward, .referenceKey = getReferenceKey(r), .statePtr = statePtr});
+    buffer.sizeClassCounts[sizeClass]++;
 
     // If succeeded, return true
     return true;
   }
 
   /**
-   * Saves the runner state into the provided state data pointer
+   * Moves a state into the smallest size class that fits it and has free states left, if smaller than its current one.
+   * Returns the size class the state ends up in
    */
-  __INLINE__ size_t saveStateFromRunner(Runner &r, void *statePtr) const
+  __INLINE__ size_t moveToSizeClass(void *&statePtr, const size_t stateSize, const size_t currentSizeClass)
   {
-    // Storage for the state size after deserialization
-    size_t serializedSize = 0;
+    const size_t smallestSizeClass = std::lower_bound(_sizeClassSizes.begin(), _sizeClassSizes.end(), stateSize) - _sizeClassSizes.begin();
 
-    // Serializing the runner state into the memory received (if using differential compression)
-    if (_useDifferentialCompression == true)
+    for (size_t sizeClass = smallestSizeClass; sizeClass < currentSizeClass; sizeClass++)
     {
-      jaffarCommon::serializer::Differential s(statePtr, _differentialStateSize, _currentReferenceData, _stateSizeRaw, _useZlibCompression);
-      r.serializeState(s);
-      serializedSize = s.getOutputSize();
+      void *sizeClassStatePtr = getFreeSizeClassState(sizeClass);
+      if (sizeClassStatePtr == nullptr) continue;
+
+      memcpy(sizeClassStatePtr, statePtr, stateSize);
+      returnFreeState(statePtr);
+      statePtr = sizeClassStatePtr;
+      return sizeClass;
     }
 
+    return currentSizeClass;
+  }
+
+  /**
+   * Saves the runner state into the provided state data pointer
+   */
+  __INLINE__ size_t saveStateFromRunner(Runner &r, void *statePtr) { return saveStateFromRunner(r, statePtr, _differentialStateSize); }
+
+  /**
+   * Saves the runner state into the provided state data pointer, with the given maximum size if using differential compression
+   */
+  __INLINE__ size_t saveStateFromRunner(Runner &r, void *statePtr, const size_t differentialStateSize)
+  {
     // Serializing the runner state into the memory received (if no compression is used)
     if (_useDifferentialCompression == false)
     {
       jaffarCommon::serializer::Contiguous s(statePtr, _stateSizeRaw);
       r.serializeState(s);
-      serializedSize = s.getOutputSize();
+      return s.getOutputSize();
+    }
+
+    // Getting the reference state to encode against and, if using several, storing its identifier first
+    const size_t referenceId   = getReferenceId(getReferenceKey(r));
+    const void  *referenceData = _currentReferenceData[referenceId];
+    auto        *outputPtr     = (uint8_t *)statePtr + _referenceIdSize;
+    const size_t outputLimit   = differentialStateSize - _referenceIdSize;
+    if (_referenceIdSize > 0) *(uint8_t *)statePtr = referenceId;
+
+    // If using a codec, the differences are stored into this thread's buffer first, and then encoded into the memory received
+    auto        &buffer           = _serializationBuffers[jaffarCommon::parallel::getThreadId()];
+    uint8_t     *differencesPtr   = _useCodec ? buffer.encoded.data() : outputPtr;
+    const size_t differencesLimit = _useCodec ? _differentialStateSize - _referenceIdSize - _codecHeaderSize : outputLimit;
+    size_t       differencesSize  = 0;
+
+    // Serializing the differences against the reference data with the runner's serializer
+    if (_useXorDelta == false)
+    {
+      jaffarCommon::serializer::Differential s(differencesPtr, differencesLimit, referenceData, _stateSizeRaw, false);
+      r.serializeState(s);
+      differencesSize = s.getOutputSize();
+    }
+
+    // Otherwise, serializing the raw state into this thread's buffer, and XOR delta encoding it against the reference data
+    if (_useXorDelta == true)
+    {
+      jaffarCommon::serializer::Contiguous s(buffer.raw.data(), _stateSizeRaw);
+      r.serializeState(s);
+      differencesSize = XorDelta::encode(buffer.raw.data(), (const uint8_t *)referenceData, _stateSizeRaw, differencesPtr, differencesLimit);
+      if (differencesSize == 0) JAFFAR_THROW_RUNTIME("[ERROR] XOR delta does not fit in %lu bytes\n", differencesLimit);
     }
 
-    return serializedSize;
+    if (_useCodec == false) return _referenceIdSize + differencesSize;
+
+    // Encoding the differences with the codec
+    const size_t encodedSize = _codec->encode(differencesPtr, differencesSize, outputPtr, outputLimit);
+    if (encodedSize == 0) JAFFAR_THROW_RUNTIME("[ERROR] Encoded state does not fit in %lu bytes\n", outputLimit);
+    return _referenceIdSize + encodedSize;
   }
 
   /**
@@ -200,19 +501,70 @@ class Base
    */
   __INLINE__ void loadStateIntoRunner(Runner &r, const void *statePtr)
   {
-    // Deserializing the runner state from the memory received (if using differential compression)
-    if (_useDifferentialCompression == true)
-    {
-      jaffarCommon::deserializer::Differential d(statePtr, _differentialStateSize, _previousReferenceData, _stateSizeRaw, _useZlibCompression);
-      r.deserializeState(d);
-    }
-
     // Deserializing the runner state from the memory received (if no compression is used)
     if (_useDifferentialCompression == false)
     {
       jaffarCommon::deserializer::Contiguous d(statePtr, _stateSizeRaw);
       r.deserializeState(d);
+      return;
     }
+
+    // If using XOR delta encoding, decoding the raw state into this thread's buffer, and loading it
+    auto &buffer = _serializationBuffers[jaffarCommon::parallel::getThreadId()];
+    if (_useXorDelta == true)
+    {
+      decodeXorDelta(statePtr, buffer.raw.data());
+      loadRawStateIntoRunner(r, buffer.raw.data());
+      return;
+    }
+
+    // If using a codec, decoding the differences into this thread's buffer first (unless stored as is)
+    const size_t differencesLimit = _differentialStateSize - _referenceIdSize - _codecHeaderSize;
+    const auto  *inputPtr         = (const uint8_t *)statePtr + _referenceIdSize;
+    const auto  *differencesPtr   = _useCodec ? _codec->decode(inputPtr, buffer.encoded.data(), differencesLimit) : inputPtr;
+
+    // Deserializing the runner state from the differences against the reference data it was encoded with
+    jaffarCommon::deserializer::Differential d(differencesPtr, differencesLimit, getEncodingReferenceData(statePtr), _stateSizeRaw, false);
+    r.deserializeState(d);
+  }
+
+  /**
+   * Loads the state into the runner and stores its raw (uncompressed) form into the provided buffer
+   *
+   * Returns a pointer to the raw state, which can then be re-loaded any number of times with loadRawStateIntoRunner,
+   * without incurring in the decompression cost again. If no compression is used, the stored state is already raw
+   * and its own pointer is returned instead.
+   */
+  __INLINE__ const void *decodeState(Runner &r, const void *statePtr, void *rawStatePtr)
+  {
+    // If using XOR delta encoding, the raw state is decoded directly, without serializing it back from the runner
+    if (_useXorDelta == true)
+    {
+      decodeXorDelta(statePtr, rawStatePtr);
+      loadRawStateIntoRunner(r, rawStatePtr);
+      return rawStatePtr;
+    }
+
+    // Loading the state into the runner, performing decompression (if needed)
+    loadStateIntoRunner(r, statePtr);
+
+    // If no compression is used, the stored state is already in its raw form
+    if (_useDifferentialCompression == false) return statePtr;
+
+    // Otherwise, serializing the now decompressed runner state into the raw buffer
+    jaffarCommon::serializer::Contiguous s(rawStatePtr, _stateSizeRaw);
+    r.serializeState(s);
+
+    return rawStatePtr;
+  }
+
+  /**
+   * Loads a raw (uncompressed) state, as produced by decodeState, into the runner
+   */
+  __INLINE__ void loadRawStateIntoRunner(Runner &r, const void *rawStatePtr)
+  {
+    jaffarCommon::deserializer::Contiguous d(rawStatePtr, _stateSizeRaw);
+    r.deserializeState(d);
   }
 
   /**
@@ -225,16 +577,265 @@ class Base
    */
   __INLINE__ void *getWorstState() const { return _currentStateDb.back(); }
 
+  /**
+   * Writes the current state database (in order) and the reference data needed to decode it into a checkpoint file.
+   * This must run between steps.
+   */
+  void saveCheckpoint(const std::string &filePath)
+  {
+    checkpoint::Writer writer(filePath);
+
+    // Writing the state sizes, to check them on resume
+    writer.push<size_t>(_stateSize);
+    writer.push<size_t>(_stateSizeRaw);
+    writer.push<size_t>(_sizeClassSizes.size());
+    writer.push<size_t>(_maximumStateSizeFound);
+
+    // Writing the codec dictionary (if any), since stored states may have been encoded with it
+    const auto &dictionary = _codec->getDictionary();
+    writer.push<size_t>(dictionary.size());
+    writer.push(dictionary.data(), dictionary.size());
+
+    // Writing the reference data. States were encoded against the current ones, which are the previous ones from now on
+    writer.push<size_t>(_referenceCount);
+    writer.push<size_t>(_currentReferenceKeys.size());
+    writer.push(_currentReferenceKeys.data(), _currentReferenceKeys.size() * sizeof(uint32_t));
+    for (const auto referenceData : _currentReferenceData) writer.push(referenceData, _stateSizeRaw);
+    for (const auto referenceData : _previousReferenceData) writer.push(referenceData, _stateSizeRaw);
+
+    // Taking the states out of the database to stream them in order, and putting them back afterwards
+    std::vector<void *> states;
+    states.reserve(getStateCount());
+    void *statePtr;
+    while (_currentStateDb.pop_front_get(statePtr) == true) states.push_back(statePtr);
+
+    // Writing the size class of every state first, so that the states can be located without scanning them on resume
+    writer.push<size_t>(states.size());
+    for (const auto state : states) writer.push<size_t>(getStateSizeClass(state));
+    for (const auto state : states) writer.push(state, _sizeClassSizes[getStateSizeClass(state)]);
+    for (const auto state : states) _currentStateDb.push_back_no_lock(state);
+
+    writer.close();
+  }
+
+  /**
+   * Replaces the current state database and reference data with the ones in a checkpoint file. This must run between steps.
+   */
+  void loadCheckpoint(const std::string &filePath)
+  {
+    checkpoint::Reader reader(filePath);
+
+    // Checking the states were stored with the same configuration
+    const auto stateSize      = reader.pop<size_t>();
+    const auto stateSizeRaw   = reader.pop<size_t>();
+    const auto sizeClassCount = reader.pop<size_t>();
+    if (stateSize != _stateSize || stateSizeRaw != _stateSizeRaw)
+      JAFFAR_THROW_LOGIC("[ERROR] The checkpoint state size (%lu bytes, %lu raw) differs from the configured one (%lu bytes, %lu raw)\n", stateSize, stateSizeRaw, _stateSize, _stateSizeRaw);
+    if (sizeClassCount != _sizeClassSizes.size())
+      JAFFAR_THROW_LOGIC("[ERROR] The checkpoint uses %lu state size classes, but the configuration uses %lu\n", sizeClassCount, _sizeClassSizes.size());
+    _maximumStateSizeFound = reader.pop<size_t>();
+
+    // Reading the codec dictionary
+    const auto           dictionarySize = reader.pop<size_t>();
+    std::vector<uint8_t> dictionary(dictionarySize);
+    reader.pop(dictionary.data(), dictionarySize);
+    if (dictionarySize > 0 && _useCodec == false) JAFFAR_THROW_LOGIC("[ERROR] The checkpoint states were encoded with a dictionary, but no codec is configured\n");
+    if (dictionarySize > 0) _codec->setDictionary(dictionary);
+
+    // Reading reference data
+    const auto referenceCount = reader.pop<size_t>();
+    if (referenceCount != _referenceCount) JAFFAR_THROW_LOGIC("[ERROR] The checkpoint uses %lu reference states, but the configuration uses %lu\n", referenceCount, _referenceCount);
+    _currentReferenceKeys.resize(reader.pop<size_t>());
+    reader.pop(_currentReferenceKeys.data(), _currentReferenceKeys.size() * sizeof(uint32_t));
+    for (const auto referenceData : _currentReferenceData) reader.pop(referenceData, _stateSizeRaw);
+    for (const auto referenceData : _previousReferenceData) reader.pop(referenceData, _stateSizeRaw);
+
+    // Returning the states currently in the database
+    void *statePtr;
+    while (_currentStateDb.pop_front_get(statePtr) == true) returnFreeState(statePtr);
+
+    // Reading the size class of every state, and locating their data
+    const auto          stateCount  = reader.pop<size_t>();
+    const auto         *sizeClasses = (const size_t *)reader.popPointer(stateCount * sizeof(size_t));
+    std::vector<size_t> stateOffsets(stateCount + 1, 0);
+    for (size_t i = 0; i < stateCount; i++) stateOffsets[i + 1] = stateOffsets[i] + _sizeClassSizes[sizeClasses[i]];
+    const auto *stateData = reader.popPointer(stateOffsets[stateCount]);
+
+    // Copying the states from the mapped file in parallel, so that pages are read and stored by all threads
+    std::vector<void *> states(stateCount);
+    JAFFAR_PARALLEL_FOR
+    for (size_t i = 0; i < stateCount; i++)
+    {
+      // Placing each state in its size class, or the largest one if there are none left
+      const size_t sizeClass = sizeClasses[i];
+      states[i]              = sizeClass < _sizeClassSizes.size() - 1 ? getFreeSizeClassState(sizeClass) : nullptr;
+      if (states[i] == nullptr) states[i] = getFreeState();
+      if (states[i] != nullptr) memcpy(states[i], &stateData[stateOffsets[i]], _sizeClassSizes[sizeClass]);
+    }
+
+    // Storing them in their original order
+    std::fill(_sizeClassHistogram.begin(), _sizeClassHistogram.end(), 0);
+    for (const auto state : states)
+    {
+      if (state == nullptr) JAFFAR_THROW_RUNTIME("[ERROR] The state database is too small to hold the %lu checkpoint states\n", stateCount);
+      _currentStateDb.push_back_no_lock(state);
+      _sizeClassHistogram[getStateSizeClass(state)]++;
+    }
+
+    // The loaded states replace the current ones, as if a step had advanced
+    advanceStepImpl();
+  }
+
   protected:
 
   virtual void printInfoImpl() const = 0;
 
+  /**
+   * Decodes an XOR delta encoded state (first with the codec, if used) into its raw form
+   */
+  __INLINE__ void decodeXorDelta(const void *statePtr, void *rawStatePtr)
+  {
+    auto       &buffer         = _serializationBuffers[jaffarCommon::parallel::getThreadId()];
+    const auto *inputPtr       = (const uint8_t *)statePtr + _referenceIdSize;
+    const auto *differencesPtr = _useCodec ? _codec->decode(inputPtr, buffer.encoded.data(), _differentialStateSize - _referenceIdSize - _codecHeaderSize) : inputPtr;
+    XorDelta::decode(differencesPtr, (const uint8_t *)getEncodingReferenceData(statePtr), _stateSizeRaw, (uint8_t *)rawStatePtr);
+  }
+
+  /**
+   * Rounds the given size up to the state padding
+   */
+  static __INLINE__ size_t getPaddedSize(const size_t size) { return ((size + _JAFFAR_STATE_PADDING_BYTES - 1) / _JAFFAR_STATE_PADDING_BYTES) * _JAFFAR_STATE_PADDING_BYTES; }
+
   Runner *const _runner;
 
   /**
-   * The next state database, where new states are stored as they are created
+   * A state produced during the current step, to be considered as base state in the next one
    */
-  jaffarCommon::concurrent::concurrentMultimap_t<float, void *> _nextStateDb;
+  struct nextState_t
+  {
+    float reward;
+
+    // Key of the reference state this state belongs to (fits in the padding before the pointer)
+    uint32_t referenceKey;
+
+    void *statePtr;
+  };
+
+  /**
+   * Orders next states by descending reward
+   */
+  static __INLINE__ bool nextStateComparator(const nextState_t &a, const nextState_t &b) { return a.reward > b.reward; }
+
+  /**
+   * Gets the key of the reference state the runner state belongs to, from the value of the reference property
+   */
+  __INLINE__ uint32_t getReferenceKey(Runner &r)
+  {
+    if (_referenceCount == 1) return 0;
+
+    // Looking the property up only when the thread uses a different runner than before
+    auto &buffer = _serializationBuffers[jaffarCommon::parallel::getThreadId()];
+    if (buffer.runner != &r)
+    {
+      buffer.runner            = &r;
+      buffer.referenceProperty = r.getGame()->getProperty(_referenceProperty);
+    }
+
+    // Folding the property value into 32 bits. A collision only makes two clusters share a reference state
+    uint64_t value = 0;
+    memcpy(&value, buffer.referenceProperty->getPointer(), buffer.referenceProperty->getSize());
+    return (uint32_t)(value ^ (value >> 32));
+  }
+
+  /**
+   * Gets the identifier of the current reference state with the given key, or the first one (the best state) if none has it
+   */
+  __INLINE__ size_t getReferenceId(const uint32_t referenceKey) const
+  {
+    for (size_t i = 1; i < _currentReferenceKeys.size(); i++)
+      if (_currentReferenceKeys[i] == referenceKey) return i;
+    return 0;
+  }
+
+  /**
+   * Gets the reference data a stored state was encoded against
+   */
+  __INLINE__ const void *getEncodingReferenceData(const void *statePtr) const
+  {
+    const size_t referenceId = _referenceIdSize > 0 ? *(const uint8_t *)statePtr : 0;
+    return _previousReferenceData[referenceId];
+  }
+
+  /**
+   * Sets the new reference states from the new states, sorted by descending reward: the best state first, followed by
+   * the best state with each other reference key, in order, until all reference states are in use
+   */
+  __INLINE__ void updateReferenceData(const std::vector<nextState_t> &nextStates)
+  {
+    std::vector<const nextState_t *> referenceStates = {&nextStates.front()};
+    std::vector<uint32_t>            referenceKeys   = {nextStates.front().referenceKey};
+    for (size_t i = 1; i < nextStates.size() && referenceStates.size() < _referenceCount; i++)
+      if (std::find(referenceKeys.begin(), referenceKeys.end(), nextStates[i].referenceKey) == referenceKeys.end())
+      {
+        referenceStates.push_back(&nextStates[i]);
+        referenceKeys.push_back(nextStates[i].referenceKey);
+      }
+
+    for (size_t i = 0; i < referenceStates.size(); i++) decodeState(*_runner, referenceStates[i]->statePtr, _currentReferenceData[i]);
+    _currentReferenceKeys = referenceKeys;
+  }
+
+  /**
+   * Finds how many elements of the first sorted sequence are among the first 'outputCount' elements of its (stable) merge with the second
+   */
+  static __INLINE__ size_t getMergePathSplit(const nextState_t *first, const size_t firstSize, const nextState_t *second, const size_t secondSize, const size_t outputCount)
+  {
+    size_t low  = outputCount > secondSize ? outputCount - secondSize : 0;
+    size_t high = std::min(outputCount, firstSize);
+    while (low < high)
+    {
+      const size_t mid = low + (high - low) / 2;
+      if (nextStateComparator(second[outputCount - mid - 1], first[mid]) == false) low = mid + 1;
+      else
+        high = mid;
+    }
+    return low;
+  }
+
+  /**
+   * Cache-line padded buffer, so that each thread can store its new states without contention nor false sharing
+   */
+  struct alignas(64) nextStateBuffer_t
+  {
+    std::vector<nextState_t> states;
+
+    // Number of new states stored in each size class
+    std::vector<size_t> sizeClassCounts;
+  };
+
+  /**
+   * The next state buffers (one per thread), where new states are stored unsorted as they are created
+   */
+  std::vector<nextStateBuffer_t> _nextStateBuffers;
+
+  /**
+   * Scratch space for sorting the next states. Kept between steps to avoid reallocations
+   */
+  std::vector<nextState_t> _nextStateMergeBuffers[2];
+
+  // Time spent reserving and touching the state storage at initialization
+  size_t _initializationTime = 0;
+
+  // Time spent (last step and cumulative) in each of the advance step phases: sorting, merging, filling the
+  // current state database and (concurrently with the latter) updating the reference data
+  size_t _advanceStepSortTime                = 0;
+  size_t _advanceStepSortCumulativeTime      = 0;
+  size_t _advanceStepMergeTime               = 0;
+  size_t _advanceStepMergeCumulativeTime     = 0;
+  size_t _advanceStepFillTime                = 0;
+  size_t _advanceStepFillCumulativeTime      = 0;
+  size_t _advanceStepReferenceTime           = 0;
+  size_t _advanceStepReferenceCumulativeTime = 0;
 
   /**
    * The current state database used as read-only source of base states
@@ -279,20 +880,68 @@ class Base
   // If using differential compression, the maximum number of differences allowed
   size_t _maximumDifferentialSizeAllowed;
 
-  // if using differential compression, whether to use Zlib post-compression
-  bool _useZlibCompression;
+  // If using differential compression, the codec that post-compresses the differences
+  std::unique_ptr<Codec> _codec;
+
+  // Whether a codec other than 'none' is used, and the size of the header it prepends to the states
+  bool   _useCodec;
+  size_t _codecHeaderSize;
+
+  // Whether to encode differences as XOR deltas, instead of with the runner's differential serializer
+  bool _useXorDelta;
+
+  /**
+   * Cache-line padded buffers, so that each thread can store states in their intermediate forms without contention
+   */
+  struct alignas(64) serializationBuffer_t
+  {
+    // Differences before encoding them with the codec, or after decoding them
+    std::vector<uint8_t> encoded;
+
+    // Raw state before XOR delta encoding it, or after decoding it
+    std::vector<uint8_t> raw;
+
+    // Runner last used by this thread, and its reference property
+    Runner         *runner            = nullptr;
+    const Property *referenceProperty = nullptr;
+  };
+
+  // The serialization buffers, one per thread
+  std::vector<serializationBuffer_t> _serializationBuffers;
 
   // If using differential compression, store differential state size
   size_t _differentialStateSize = 0;
 
+  // Stores whether to store states in size classes, according to their (differentially compressed) size
+  bool _useSizeClasses;
+
+  // Size of the states of each size class, in increasing order. The largest one is the full state size
+  std::vector<size_t> _sizeClassSizes;
+
+  // Number of states of the current state database in each size class
+  std::vector<size_t> _sizeClassHistogram;
+
   // If using differential compression, the maximum differences found
   size_t _maximumStateSizeFound;
 
-  // Storage for the current reference data required for differential compression serialization
-  void *_currentReferenceData;
+  // Maximum number of reference states, so that their identifier fits in a byte
+  static constexpr size_t maxReferenceCount = 256;
+
+  // Maximum number of reference states to encode states against, and the property that decides which one each state uses
+  size_t      _referenceCount;
+  std::string _referenceProperty;
+
+  // Size of the reference state identifier preceding each state (none if there is a single reference state)
+  size_t _referenceIdSize;
+
+  // Keys of the current reference states in use
+  std::vector<uint32_t> _currentReferenceKeys;
+
+  // Storage for the current reference data required for differential compression serialization, per reference state
+  std::vector<void *> _currentReferenceData;
 
-  // Storage for the previously used reference data required for differential compression deserialization
-  void *_previousReferenceData;
+  // Storage for the previously used reference data required for differential compression deserialization, per reference state
+  std::vector<void *> _previousReferenceData;
 };
 
 } // namespace stateDb
@@ -0,0 +1,494 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <zlib.h>
+#include <jaffarCommon/json.hpp>
+#include <jaffarCommon/logger.hpp>
+#include <jaffarCommon/parallel.hpp>
+#include <jaffarCommon/timing.hpp>
+
+// The LZ4 and Zstd codecs are only available when Jaffar is built against their libraries
+#ifdef JAFFAR_USE_LZ4
+  #include <lz4.h>
+#endif
+#ifdef JAFFAR_USE_ZSTD
+  #include <zdict.h>
+  #include <zstd.h>
+#endif
+
+namespace jaffarPlus
+{
+
+namespace stateDb
+{
+
+/**
+ * Post-compression codec for differentially compressed states.
+ *
+ * Encoded states start with a 32-bit header holding the size of the payload, plus flags telling whether the payload is
+ * stored as is (when the codec would not make it smaller) or was compressed with the trained dictionary. This way,
+ * states encoded before the dictionary was trained remain decodable.
+ *
+ * The first sampled states of the run are kept to benchmark all the available codecs on them and, if requested, to
+ * train the Zstd dictionary.
+ */
+class Codec final
+{
+  public:
+
+  enum codecType_t
+  {
+    none,
+    zlib,
+    lz4,
+    zstd
+  };
+
+  // Size of the header preceding every encoded state
+  static constexpr size_t headerSize = sizeof(uint32_t);
+
+  // Compression levels, favoring speed
+  static constexpr int zlibLevel = Z_BEST_SPEED;
+  static constexpr int zstdLevel = 1;
+
+  // Maximum size of the trained Zstd dictionary
+  static constexpr size_t maxDictionarySize = 16 * 1024;
+
+  // One in this many encodes and decodes is timed
+  static constexpr size_t timingSamplingPeriod = 16;
+
+  Codec(const nlohmann::json &config)
+  {
+    const auto &codecString = jaffarCommon::json::getString(config, "Codec");
+    bool        recognized  = false;
+
+    if (codecString == "none")
+    {
+      _type      = codecType_t::none;
+      recognized = true;
+    }
+
+    if (codecString == "zlib")
+    {
+      _type      = codecType_t::zlib;
+      recognized = true;
+    }
+
+    if (codecString == "lz4")
+    {
+#ifndef JAFFAR_USE_LZ4
+      JAFFAR_THROW_LOGIC("Codec '%s' requested, but Jaffar was built without liblz4", codecString.c_str());
+#endif
+      _type      = codecType_t::lz4;
+      recognized = true;
+    }
+
+    if (codecString == "zstd")
+    {
+#ifndef JAFFAR_USE_ZSTD
+      JAFFAR_THROW_LOGIC("Codec '%s' requested, but Jaffar was built without libzstd", codecString.c_str());
+#endif
+      _type      = codecType_t::zstd;
+      recognized = true;
+    }
+
+    if (recognized == false) JAFFAR_THROW_LOGIC("Codec '%s' not recognized", codecString.c_str());
+
+    _sampleTarget      = jaffarCommon::json::getNumber<size_t>(config, "Codec Sample States");
+    _useZstdDictionary = jaffarCommon::json::getBoolean(config, "Use Zstd Dictionary");
+    _threadStatistics  = std::vector<threadStatistics_t>(jaffarCommon::parallel::getMaxThreadCount());
+    _samplesProcessed  = _sampleTarget == 0;
+
+    if (_useZstdDictionary == true && _type != codecType_t::zstd) JAFFAR_THROW_LOGIC("A Zstd dictionary was requested, but the codec is '%s'", codecString.c_str());
+    if (_useZstdDictionary == true && _sampleTarget == 0) JAFFAR_THROW_LOGIC("A Zstd dictionary was requested, but no states are sampled to train it");
+  }
+
+  ~Codec()
+  {
+#ifdef JAFFAR_USE_ZSTD
+    ZSTD_freeCDict(_zstdCompressionDictionary);
+    ZSTD_freeDDict(_zstdDecompressionDictionary);
+#endif
+  }
+
+  __INLINE__ codecType_t getType() const { return _type; }
+
+  static __INLINE__ const char *getTypeName(const codecType_t type)
+  {
+    if (type == codecType_t::zlib) return "zlib";
+    if (type == codecType_t::lz4) return "lz4";
+    if (type == codecType_t::zstd) return "zstd";
+    return "none";
+  }
+
+  /**
+   * Encodes the input into the output (header included), storing it as is if the codec does not make it smaller.
+   * Returns the encoded size, or zero if it does not fit in the output capacity
+   */
+  __INLINE__ size_t encode(const uint8_t *input, const size_t inputSize, uint8_t *output, const size_t outputCapacity)
+  {
+    auto        &statistics = _threadStatistics[jaffarCommon::parallel::getThreadId()];
+    const bool   isTimed    = (statistics.encodeCount.load(std::memory_order_relaxed) % timingSamplingPeriod) == 0;
+    decltype(jaffarCommon::timing::now()) t0;
+    if (isTimed == true) t0 = jaffarCommon::timing::now();
+    const bool   useDict    = hasDictionary();
+    const size_t packedSize = compress(_type, useDict, input, inputSize, &output[headerSize], outputCapacity - headerSize);
+
+    // Storing the input as is if it could not be compressed into less space. Failing if it does not fit either
+    uint32_t header = packedSize;
+    if (packedSize == 0 || packedSize >= inputSize)
+    {
+      if (headerSize + inputSize > outputCapacity) return 0;
+      memcpy(&output[headerSize], input, inputSize);
+      header = inputSize | storedFlag;
+    }
+    else if (useDict == true) header |= dictionaryFlag;
+    memcpy(output, &header, headerSize);
+
+    const size_t encodedSize = headerSize + (header & sizeMask);
+    if (isTimed == true) addRelaxed(statistics.encodeTime, jaffarCommon::timing::timeDeltaNanoseconds(jaffarCommon::timing::now(), t0));
+    addRelaxed(statistics.encodeCount, 1);
+    addRelaxed(statistics.inputBytes, inputSize);
+    addRelaxed(statistics.encodedBytes, encodedSize);
+
+    // Keeping the first states as samples
+    if (_samplesCollected.load(std::memory_order_relaxed) < _sampleTarget) addSample(input, inputSize);
+
+    return encodedSize;
+  }
+
+  /**
+   * Decodes the encoded state into the scratch buffer, unless it was stored as is. Returns a pointer to the decoded data
+   */
+  __INLINE__ const uint8_t *decode(const uint8_t *input, uint8_t *scratch, const size_t scratchCapacity)
+  {
+    uint32_t header;
+    memcpy(&header, input, headerSize);
+    if ((header & storedFlag) != 0) return &input[headerSize];
+
+    auto      &statistics = _threadStatistics[jaffarCommon::parallel::getThreadId()];
+    const bool isTimed    = (statistics.decodeCount.load(std::memory_order_relaxed) % timingSamplingPeriod) == 0;
+    decltype(jaffarCommon::timing::now()) t0;
+    if (isTimed == true) t0 = jaffarCommon::timing::now();
+
+    if (decompress(_type, (header & dictionaryFlag) != 0, &input[headerSize], header & sizeMask, scratch, scratchCapacity) == 0)
+      JAFFAR_THROW_RUNTIME("[ERROR] Could not decode a state with codec '%s'. This must be a bug in Jaffar\n", getTypeName(_type));
+
+    if (isTimed == true) addRelaxed(statistics.decodeTime, jaffarCommon::timing::timeDeltaNanoseconds(jaffarCommon::timing::now(), t0));
+    addRelaxed(statistics.decodeCount, 1);
+
+    return scratch;
+  }
+
+  /**
+   * Once enough states were sampled, benchmarks all the available codecs on them and trains the Zstd dictionary, if
+   * requested. This must run while no states are being encoded, e.g., between steps
+   */
+  void processSamples()
+  {
+    if (_samplesProcessed == true || _samplesCollected.load() < _sampleTarget) return;
+    _samplesProcessed = true;
+
+    // Benchmarking all available codecs, without dictionary
+    for (const auto type : {codecType_t::none, codecType_t::zlib, codecType_t::lz4, codecType_t::zstd})
+      if (isAvailable(type) == true) _benchmarkResults.push_back(benchmark(type, false));
+
+#ifdef JAFFAR_USE_ZSTD
+    if (_useZstdDictionary == true)
+    {
+      // Training the dictionary on the samples. It should be much smaller than the samples for training to work well
+      std::vector<uint8_t> dictionary(std::min(maxDictionarySize, std::max(_samples.size() / 16, (size_t)256)));
+      const size_t         dictionarySize = ZDICT_trainFromBuffer(dictionary.data(), dictionary.size(), _samples.data(), _sampleSizes.data(), _sampleSizes.size());
+
+      if (ZDICT_isError(dictionarySize))
+        jaffarCommon::logger::log("[J+] Could not train a Zstd dictionary on %lu states: %s. Continuing without it\n", _sampleSizes.size(), ZDICT_getErrorName(dictionarySize));
+      else
+      {
+        dictionary.resize(dictionarySize);
+        setDictionary(dictionary);
+        _benchmarkResults.push_back(benchmark(codecType_t::zstd, true));
+      }
+    }
+#endif
+
+    // The samples are no longer needed
+    _samples     = std::vector<uint8_t>();
+    _sampleSizes = std::vector<size_t>();
+  }
+
+  /**
+   * Gets the trained dictionary (empty if there is none), to store it in checkpoints
+   */
+  __INLINE__ const std::vector<uint8_t> &getDictionary() const { return _dictionary; }
+
+  /**
+   * Sets the dictionary (e.g., from a checkpoint). States encoded from now on use it
+   */
+  void setDictionary(const std::vector<uint8_t> &dictionary)
+  {
+    _dictionary = dictionary;
+    if (_dictionary.empty() == true) return;
+
+#ifdef JAFFAR_USE_ZSTD
+    ZSTD_freeCDict(_zstdCompressionDictionary);
+    ZSTD_freeDDict(_zstdDecompressionDictionary);
+    _zstdCompressionDictionary   = ZSTD_createCDict(_dictionary.data(), _dictionary.size(), zstdLevel);
+    _zstdDecompressionDictionary = ZSTD_createDDict(_dictionary.data(), _dictionary.size());
+#endif
+
+    // A dictionary set from a checkpoint replaces the one the samples would have trained
+    _samplesProcessed = true;
+  }
+
+  // Function to print relevant information
+  void printInfo() const
+  {
+    size_t encodeCount = 0, inputBytes = 0, encodedBytes = 0, encodeTime = 0, decodeCount = 0, decodeTime = 0;
+    for (const auto &statistics : _threadStatistics)
+    {
+      encodeCount += statistics.encodeCount.load();
+      inputBytes += statistics.inputBytes.load();
+      encodedBytes += statistics.encodedBytes.load();
+      encodeTime += statistics.encodeTime.load();
+      decodeCount += statistics.decodeCount.load();
+      decodeTime += statistics.decodeTime.load();
+    }
+
+    // Only one in every sampling period was timed
+    const size_t timedEncodes = (encodeCount + timingSamplingPeriod - 1) / timingSamplingPeriod;
+    const size_t timedDecodes = (decodeCount + timingSamplingPeriod - 1) / timingSamplingPeriod;
+
+    jaffarCommon::logger::log("[J+]  + Codec:                         %s%s\n", getTypeName(_type), _dictionary.empty() ? "" : " (with dictionary)");
+    jaffarCommon::logger::log("[J+]    + Bytes/State:                 %.1f (from %.1f)\n",
+                              encodeCount > 0 ? (double)encodedBytes / (double)encodeCount : 0.0,
+                              encodeCount > 0 ? (double)inputBytes / (double)encodeCount : 0.0);
+    jaffarCommon::logger::log("[J+]    + Encode / Decode Time:        %.1f ns / %.1f ns\n",
+                              timedEncodes > 0 ? (double)encodeTime / (double)timedEncodes : 0.0,
+                              timedDecodes > 0 ? (double)decodeTime / (double)timedDecodes : 0.0);
+
+    if (_benchmarkResults.empty() == false)
+    {
+      jaffarCommon::logger::log("[J+]  + Codec Benchmark (%lu sampled states):\n", _sampleTarget);
+      for (const auto &result : _benchmarkResults)
+        jaffarCommon::logger::log("[J+]    + %-18s          %8.1f bytes/state, %8.1f ns/encode, %8.1f ns/decode\n",
+                                  result.name.c_str(),
+                                  result.bytesPerState,
+                                  result.encodeTimePerState,
+                                  result.decodeTimePerState);
+    }
+  }
+
+  private:
+
+  // Header layout: the payload size, and whether it is stored as is or was compressed with the dictionary
+  static constexpr uint32_t storedFlag     = 1u << 31;
+  static constexpr uint32_t dictionaryFlag = 1u << 30;
+  static constexpr uint32_t sizeMask       = dictionaryFlag - 1;
+
+  /**
+   * Per-thread statistics, padded to prevent false sharing. These are atomic only because states may also be decoded
+   * outside the worker threads
+   */
+  struct alignas(64) threadStatistics_t
+  {
+    std::atomic<size_t> encodeCount  = 0;
+    std::atomic<size_t> inputBytes   = 0;
+    std::atomic<size_t> encodedBytes = 0;
+    std::atomic<size_t> encodeTime   = 0;
+    std::atomic<size_t> decodeCount  = 0;
+    std::atomic<size_t> decodeTime   = 0;
+  };
+
+  struct benchmarkResult_t
+  {
+    std::string name;
+    double      bytesPerState;
+    double      encodeTimePerState;
+    double      decodeTimePerState;
+  };
+
+  static __INLINE__ void addRelaxed(std::atomic<size_t> &counter, const size_t value) { counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed); }
+
+  static __INLINE__ bool isAvailable(const codecType_t type)
+  {
+#ifndef JAFFAR_USE_LZ4
+    if (type == codecType_t::lz4) return false;
+#endif
+#ifndef JAFFAR_USE_ZSTD
+    if (type == codecType_t::zstd) return false;
+#endif
+    return true;
+  }
+
+  __INLINE__ bool hasDictionary() const { return _dictionary.empty() == false; }
+
+  /**
+   * Compresses the input with the given codec. Returns the compressed size, or zero if it did not fit in the output
+   */
+  __INLINE__ size_t compress(const codecType_t type, const bool useDictionary, const uint8_t *input, const size_t inputSize, uint8_t *output, const size_t outputCapacity) const
+  {
+    if (type == codecType_t::zlib)
+    {
+      uLongf outputSize = outputCapacity;
+      return compress2(output, &outputSize, input, inputSize, zlibLevel) == Z_OK ? outputSize : 0;
+    }
+
+#ifdef JAFFAR_USE_LZ4
+    if (type == codecType_t::lz4) return std::max(LZ4_compress_default((const char *)input, (char *)output, inputSize, outputCapacity), 0);
+#endif
+
+#ifdef JAFFAR_USE_ZSTD
+    if (type == codecType_t::zstd)
+    {
+      auto        *context    = getZstdContexts().compression;
+      const size_t outputSize = useDictionary ? ZSTD_compress_usingCDict(context, output, outputCapacity, input, inputSize, _zstdCompressionDictionary)
+                                              : ZSTD_compressCCtx(context, output, outputCapacity, input, inputSize, zstdLevel);
+      return ZSTD_isError(outputSize) ? 0 : outputSize;
+    }
+#endif
+
+    return 0;
+  }
+
+  /**
+   * Decompresses the input with the given codec. Returns the decompressed size, or zero on failure
+   */
+  __INLINE__ size_t decompress(const codecType_t type, const bool useDictionary, const uint8_t *input, const size_t inputSize, uint8_t *output, const size_t outputCapacity) const
+  {
+    if (type == codecType_t::zlib)
+    {
+      uLongf outputSize = outputCapacity;
+      return uncompress(output, &outputSize, input, inputSize) == Z_OK ? outputSize : 0;
+    }
+
+#ifdef JAFFAR_USE_LZ4
+    if (type == codecType_t::lz4) return std::max(LZ4_decompress_safe((const char *)input, (char *)output, inputSize, outputCapacity), 0);
+#endif
+
+#ifdef JAFFAR_USE_ZSTD
+    if (type == codecType_t::zstd)
+    {
+      auto        *context    = getZstdContexts().decompression;
+      const size_t outputSize = useDictionary ? ZSTD_decompress_usingDDict(context, output, outputCapacity, input, inputSize, _zstdDecompressionDictionary)
+                                              : ZSTD_decompressDCtx(context, output, outputCapacity, input, inputSize);
+      return ZSTD_isError(outputSize) ? 0 : outputSize;
+    }
+#endif
+
+    return 0;
+  }
+
+#ifdef JAFFAR_USE_ZSTD
+  /**
+   * Zstd contexts are reused across calls, one set per thread
+   */
+  struct zstdContexts_t
+  {
+    ZSTD_CCtx *compression   = ZSTD_createCCtx();
+    ZSTD_DCtx *decompression = ZSTD_createDCtx();
+
+    ~zstdContexts_t()
+    {
+      ZSTD_freeCCtx(compression);
+      ZSTD_freeDCtx(decompression);
+    }
+  };
+
+  static __INLINE__ zstdContexts_t &getZstdContexts()
+  {
+    thread_local zstdContexts_t contexts;
+    return contexts;
+  }
+#endif
+
+  /**
+   * Keeps a copy of the given input as a sample, if there are still samples to collect
+   */
+  void addSample(const uint8_t *input, const size_t inputSize)
+  {
+    std::lock_guard<std::mutex> lock(_samplesMutex);
+    if (_samplesCollected.load() >= _sampleTarget) return;
+
+    _samples.insert(_samples.end(), input, input + inputSize);
+    _sampleSizes.push_back(inputSize);
+    _samplesCollected++;
+  }
+
+  /**
+   * Measures the average encoded size and encode / decode times of the given codec over the samples
+   */
+  benchmarkResult_t benchmark(const codecType_t type, const bool useDictionary) const
+  {
+    const size_t         sampleCount = _sampleSizes.size();
+    const size_t         maxSize     = *std::max_element(_sampleSizes.begin(), _sampleSizes.end());
+    std::vector<uint8_t> encoded(sampleCount * (maxSize + headerSize) + compressBound(maxSize));
+    std::vector<size_t>  encodedSizes(sampleCount);
+    std::vector<uint8_t> decoded(maxSize);
+
+    // Encoding all samples (the codec 'none' just copies them)
+    size_t     encodedBytes = 0;
+    const auto t0           = jaffarCommon::timing::now();
+    for (size_t i = 0, inputOffset = 0; i < sampleCount; inputOffset += _sampleSizes[i], i++)
+    {
+      const auto *input = &_samples[inputOffset];
+      encodedSizes[i]   = type == codecType_t::none ? _sampleSizes[i] : compress(type, useDictionary, input, _sampleSizes[i], &encoded[encodedBytes], encoded.size() - encodedBytes);
+      if (type == codecType_t::none) memcpy(&encoded[encodedBytes], input, _sampleSizes[i]);
+      encodedBytes += encodedSizes[i];
+    }
+    const auto encodeTime = jaffarCommon::timing::timeDeltaNanoseconds(jaffarCommon::timing::now(), t0);
+
+    // Decoding them back
+    const auto t1 = jaffarCommon::timing::now();
+    for (size_t i = 0, encodedOffset = 0; i < sampleCount; encodedOffset += encodedSizes[i], i++)
+    {
+      if (type == codecType_t::none) memcpy(decoded.data(), &encoded[encodedOffset], encodedSizes[i]);
+      else
+        decompress(type, useDictionary, &encoded[encodedOffset], encodedSizes[i], decoded.data(), decoded.size());
+    }
+    const auto decodeTime = jaffarCommon::timing::timeDeltaNanoseconds(jaffarCommon::timing::now(), t1);
+
+    return benchmarkResult_t{.name               = std::string(getTypeName(type)) + (useDictionary ? " + dictionary" : ""),
+                             .bytesPerState      = (double)(encodedBytes + (type == codecType_t::none ? 0 : sampleCount * headerSize)) / (double)sampleCount,
+                             .encodeTimePerState = (double)encodeTime / (double)sampleCount,
+                             .decodeTimePerState = (double)decodeTime / (double)sampleCount};
+  }
+
+  // Configured codec
+  codecType_t _type;
+
+  // Number of states to sample, and whether to train a Zstd dictionary on them
+  size_t _sampleTarget;
+  bool   _useZstdDictionary;
+
+  // Sampled states (concatenated) and their sizes
+  std::mutex           _samplesMutex;
+  std::atomic<size_t>  _samplesCollected = 0;
+  std::vector<uint8_t> _samples;
+  std::vector<size_t>  _sampleSizes;
+  bool                 _samplesProcessed;
+
+  // Results of benchmarking the codecs on the samples
+  std::vector<benchmarkResult_t> _benchmarkResults;
+
+  // Trained dictionary (empty if none)
+  std::vector<uint8_t> _dictionary;
+
+#ifdef JAFFAR_USE_ZSTD
+  // Digested forms of the dictionary
+  ZSTD_CDict *_zstdCompressionDictionary   = nullptr;
+  ZSTD_DDict *_zstdDecompressionDictionary = nullptr;
+#endif
+
+  // Per-thread encode / decode statistics
+  std::vector<threadStatistics_t> _threadStatistics;
+};
+
+} // namespace stateDb
+
+} // namespace jaffarPlus
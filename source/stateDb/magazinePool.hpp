@@ -0,0 +1,324 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include <jaffarCommon/concurrent.hpp>
+#include <jaffarCommon/logger.hpp>
+#include <jaffarCommon/parallel.hpp>
+
+namespace jaffarPlus
+{
+
+namespace stateDb
+{
+
+/**
+ * Pool of free state pointers, where each thread caches free states in small local magazines.
+ *
+ * A thread only touches the shared queues when its magazines run out (or fill up), in which case it exchanges a whole
+ * magazine at once. This reduces the atomic operations on the shared queues by a factor of the magazine size, and makes
+ * a thread reuse the states it just freed, while they are still in its cache. Each thread holds two magazines, so that
+ * alternating gets and returns around a magazine boundary do not cause an exchange every time.
+ *
+ * The pool starts with all states unissued: when there are no returned states in the shared queue, magazines are
+ * filled by an issuer (for a contiguous storage, by bumping a pointer over it). This way, no free state list needs to
+ * be built at startup. Likewise, magazines are only created as states are issued.
+ *
+ * The issuer may take states from storage shared with other pools (e.g., one per state size class), in which case the
+ * owner can take back free states while no other thread uses the pool (see drainFreeStates and refillFreeStates).
+ */
+class MagazinePool final
+{
+  public:
+
+  // Number of free state pointers held by a magazine
+  static constexpr size_t magazineCapacity = 64;
+
+  /**
+   * Function that fills the given slots with up to the given number of newly issued states, and returns how many it issued.
+   * The last slot filled holds the first state to hand out
+   */
+  typedef std::function<size_t(void **slots, const size_t maxCount)> issuer_t;
+
+  /**
+   * Creates the pool for the given contiguous state storage
+   */
+  MagazinePool(uint8_t *const stateStorage, const size_t stateSize, const size_t maxStates)
+    : MagazinePool(maxStates,
+                   [this, stateStorage, stateSize, maxStates](void **slots, const size_t maxCount)
+                   {
+                     // Checking first, to prevent the counter from growing unboundedly once all states are issued
+                     if (_nextUnissuedState.load(std::memory_order_relaxed) >= maxStates) return (size_t)0;
+
+                     // Claiming the next unissued states
+                     const size_t firstState = _nextUnissuedState.fetch_add(maxCount, std::memory_order_relaxed);
+                     if (firstState >= maxStates) return (size_t)0;
+                     const size_t stateCount = std::min(maxCount, maxStates - firstState);
+
+                     // Filling the slots in reverse, so that states are handed out in storage order
+                     for (size_t i = 0; i < stateCount; i++) slots[i] = &stateStorage[(firstState + stateCount - 1 - i) * stateSize];
+                     return stateCount;
+                   })
+  {}
+
+  /**
+   * Creates the pool for states issued by the given function, of which there can be at most maxStates at any time
+   */
+  MagazinePool(const size_t maxStates, const issuer_t &issuer)
+    : _issuer(issuer)
+  {
+    // There can be as many magazines as needed for all the states (one of them possibly partial), plus the two
+    // magazines held by each thread, plus the spare ones
+    _threadCount                  = jaffarCommon::parallel::getMaxThreadCount();
+    const size_t maxMagazineCount = getRequiredMagazineCount(maxStates);
+
+    // Creating the shared magazine queues
+    _fullMagazines  = std::make_unique<jaffarCommon::concurrent::atomicQueue_t<magazine_t *>>(maxMagazineCount);
+    _emptyMagazines = std::make_unique<jaffarCommon::concurrent::atomicQueue_t<magazine_t *>>(maxMagazineCount);
+
+    // Giving two magazines to each thread, and making the spare ones available. The rest are created as states are issued
+    _threadCaches = std::vector<threadCache_t>(_threadCount);
+    for (auto &cache : _threadCaches)
+    {
+      cache.loaded   = createMagazine();
+      cache.previous = createMagazine();
+    }
+    addEmptyMagazines(0);
+  }
+
+  ~MagazinePool() = default;
+
+  /**
+   * Gets a free state from the calling thread's magazines, refilling them from the unissued states or the shared queue if needed
+   *
+   * Returns a null pointer if there are no free states left in the calling thread's magazines, the unissued states, nor the shared queue
+   */
+  __INLINE__ void *getFreeState()
+  {
+    auto &cache = _threadCaches[jaffarCommon::parallel::getThreadId()];
+
+    // If the loaded magazine is empty, try to replace it
+    if (cache.loaded->count == 0)
+    {
+      // If the previous magazine has states, just swap them
+      if (cache.previous->count > 0) std::swap(cache.loaded, cache.previous);
+
+      // Otherwise, exchange the (empty) previous magazine for a full one from the shared queue, and if there are none
+      // left, try to fill the loaded magazine with unissued states
+      else
+      {
+        magazine_t *fullMagazine;
+        if (_fullMagazines->try_pop(fullMagazine) == true)
+        {
+          returnEmptyMagazine(cache.previous);
+          cache.previous = cache.loaded;
+          cache.loaded   = fullMagazine;
+        }
+        else if (issueStates(cache.loaded) == false) return nullptr;
+      }
+    }
+
+    return cache.loaded->slots[--cache.loaded->count];
+  }
+
+  /**
+   * Returns a free state into the calling thread's magazines, sending a full one to the shared queue if needed
+   */
+  __INLINE__ void returnFreeState(void *const statePtr)
+  {
+    auto &cache = _threadCaches[jaffarCommon::parallel::getThreadId()];
+
+    // If the loaded magazine is full, try to replace it
+    if (cache.loaded->count == magazineCapacity)
+    {
+      // If the previous magazine is empty, just swap them
+      if (cache.previous->count == 0) std::swap(cache.loaded, cache.previous);
+
+      // Otherwise, send the (full) previous magazine to the shared queue, and continue with an empty one
+      else
+      {
+        magazine_t *emptyMagazine;
+        if (getEmptyMagazine(emptyMagazine) == false) JAFFAR_THROW_RUNTIME("Ran out of empty magazines for free states. This must be a bug in Jaffar\n");
+        returnFullMagazine(cache.previous);
+        cache.previous = cache.loaded;
+        cache.loaded   = emptyMagazine;
+      }
+    }
+
+    cache.loaded->slots[cache.loaded->count++] = statePtr;
+  }
+
+  /**
+   * Takes all the free states out of the pool (from the thread magazines and the shared queue), appending them to the given vector
+   *
+   * Must only be called while no other thread is using the pool
+   */
+  __INLINE__ void drainFreeStates(std::vector<void *> &states)
+  {
+    // Emptying the magazines held by the threads
+    for (auto &cache : _threadCaches)
+      for (auto *magazine : {cache.loaded, cache.previous})
+      {
+        states.insert(states.end(), magazine->slots, magazine->slots + magazine->count);
+        magazine->count = 0;
+      }
+
+    // Emptying the magazines in the shared queue
+    magazine_t *magazine;
+    while (_fullMagazines->try_pop(magazine) == true)
+    {
+      states.insert(states.end(), magazine->slots, magazine->slots + magazine->count);
+      magazine->count = 0;
+      returnEmptyMagazine(magazine);
+    }
+  }
+
+  /**
+   * Puts the given free states back into the shared queue, to be handed out in the given order. The given number of
+   * issued states, which were drained and not put back, are no longer counted as issued
+   *
+   * Must only be called while no other thread is using the pool
+   */
+  __INLINE__ void refillFreeStates(const std::vector<void *> &states, const size_t releasedStateCount)
+  {
+    _issuedStateCount.fetch_sub(releasedStateCount, std::memory_order_relaxed);
+
+    for (size_t firstState = 0; firstState < states.size(); firstState += magazineCapacity)
+    {
+      magazine_t *magazine;
+      if (getEmptyMagazine(magazine) == false) JAFFAR_THROW_RUNTIME("Ran out of empty magazines for free states. This must be a bug in Jaffar\n");
+
+      // Filling the magazine in reverse, so that states are handed out in the given order
+      magazine->count = std::min(magazineCapacity, states.size() - firstState);
+      for (size_t i = 0; i < magazine->count; i++) magazine->slots[i] = states[firstState + magazine->count - 1 - i];
+      returnFullMagazine(magazine);
+    }
+  }
+
+  private:
+
+  /**
+   * A fixed-size stack of free state pointers
+   */
+  struct magazine_t
+  {
+    size_t count = 0;
+    void  *slots[magazineCapacity];
+  };
+
+  /**
+   * The magazines held by a thread, padded to prevent false sharing
+   */
+  struct alignas(64) threadCache_t
+  {
+    magazine_t *loaded;
+    magazine_t *previous;
+  };
+
+  /**
+   * Gets how many magazines are needed to hold the given number of issued states (one of them possibly partial),
+   * plus the two magazines held by each thread, plus two spare ones
+   */
+  __INLINE__ size_t getRequiredMagazineCount(const size_t issuedStateCount) const { return issuedStateCount / magazineCapacity + 2 * _threadCount + 3; }
+
+  /**
+   * Fills the given (empty) magazine with newly issued states, if any are left
+   */
+  __INLINE__ bool issueStates(magazine_t *const magazine)
+  {
+    const size_t stateCount = _issuer(magazine->slots, magazineCapacity);
+    if (stateCount == 0) return false;
+    magazine->count = stateCount;
+
+    // Adding empty magazines, so that there are always enough of them to hold all the issued states
+    addEmptyMagazines(_issuedStateCount.fetch_add(stateCount, std::memory_order_relaxed) + stateCount);
+
+    return true;
+  }
+
+  /**
+   * Creates empty magazines until there are enough to hold the given number of issued states
+   */
+  __INLINE__ void addEmptyMagazines(const size_t issuedStateCount)
+  {
+    std::lock_guard<std::mutex> lock(_magazinesMutex);
+    while (_magazines.size() < getRequiredMagazineCount(issuedStateCount))
+    {
+      _magazines.push_back(std::make_unique<magazine_t>());
+      returnEmptyMagazine(_magazines.back().get());
+    }
+  }
+
+  /**
+   * Creates a new (empty) magazine, owned by the pool
+   */
+  __INLINE__ magazine_t *createMagazine()
+  {
+    std::lock_guard<std::mutex> lock(_magazinesMutex);
+    _magazines.push_back(std::make_unique<magazine_t>());
+    return _magazines.back().get();
+  }
+
+  __INLINE__ bool getEmptyMagazine(magazine_t *&magazine) { return _emptyMagazines->try_pop(magazine); }
+
+  __INLINE__ void returnEmptyMagazine(magazine_t *const magazine)
+  {
+    if (_emptyMagazines->try_push(magazine) == false) JAFFAR_THROW_RUNTIME("Failed on pushing empty magazine back. This must be a bug in Jaffar\n");
+  }
+
+  __INLINE__ void returnFullMagazine(magazine_t *const magazine)
+  {
+    if (_fullMagazines->try_push(magazine) == false) JAFFAR_THROW_RUNTIME("Failed on pushing full magazine back. This must be a bug in Jaffar\n");
+  }
+
+  /**
+   * Function issuing new states into the magazines
+   */
+  const issuer_t _issuer;
+
+  /**
+   * Index of the next state that has never been issued, for a contiguous state storage
+   */
+  std::atomic<size_t> _nextUnissuedState = 0;
+
+  /**
+   * Number of states issued so far, minus those released with refillFreeStates
+   */
+  std::atomic<size_t> _issuedStateCount = 0;
+
+  /**
+   * Number of threads using the pool
+   */
+  size_t _threadCount;
+
+  /**
+   * Storage for all the magazines created so far
+   */
+  std::vector<std::unique_ptr<magazine_t>> _magazines;
+  std::mutex                               _magazinesMutex;
+
+  /**
+   * Shared queue of magazines with free states
+   */
+  std::unique_ptr<jaffarCommon::concurrent::atomicQueue_t<magazine_t *>> _fullMagazines;
+
+  /**
+   * Shared queue of empty magazines
+   */
+  std::unique_ptr<jaffarCommon::concurrent::atomicQueue_t<magazine_t *>> _emptyMagazines;
+
+  /**
+   * Per-thread magazines
+   */
+  std::vector<threadCache_t> _threadCaches;
+
+};
+
+} // namespace stateDb
+
+} // namespace jaffarPlus
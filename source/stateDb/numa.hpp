@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <cstdlib>
 #include <memory>
 #include <numa.h>
@@ -9,7 +10,9 @@
 #include <jaffarCommon/json.hpp>
 #include <jaffarCommon/logger.hpp>
 #include <jaffarCommon/parallel.hpp>
+#include "../hugePages.hpp"
 #include "base.hpp"
+#include "slabPool.hpp"
 
 namespace jaffarPlus
 {
@@ -44,9 +47,15 @@ class Numa : public stateDb::Base
     // Getting scavenge depth
     _scavengerQueuesSize = jaffarCommon::json::getNumber<size_t>(config, "Scavenger Queues Size");
     _scavengingDepth     = jaffarCommon::json::getNumber<size_t>(config, "Scavenging Depth");
+
+    // Getting the page backing to use for the state storage
+    _hugePageMode = hugePages::parseMode(config);
   }
 
-  ~Numa() = default;
+  ~Numa()
+  {
+    if (_internalBuffer != nullptr) hugePages::release(_internalBuffer, _internalBufferSize, _hugePageMode);
+  }
 
   void initializeImpl() override
   {
@@ -81,55 +90,95 @@ class Numa : public stateDb::Base
       if (_maxSizePerNuma[i] > (size_t)maxFreeMemoryPerNuma[i])
         JAFFAR_THROW_RUNTIME("The requested memory (%lu) for NUMA domain %d exceeds its available free space (%lu)\n", _maxSizePerNuma[i], i, maxFreeMemoryPerNuma[i]);
 
-    // Getting maximum number of states for each NUMA domain
+    // Getting the size of the pages backing the state storage (typically 4K, or 2M / 1G if huge pages are used)
+    const size_t pageSize = hugePages::getPageSize(_hugePageMode);
+
+    // Getting number of bytes to allocate for each NUMA domain. With several size classes, they are split into the chunks they take
+    _allocableBytesPerNuma.resize(_numaCount);
+    for (int i = 0; i < _numaCount; i++) _allocableBytesPerNuma[i] = SlabPool::getStorageSize(_maxSizePerNuma[i], _sizeClassSizes);
+
+    // Getting maximum number of states for each NUMA domain (if they were all of the largest size class)
     _maxStatesPerNuma.resize(_numaCount);
-    for (int i = 0; i < _numaCount; i++) _maxStatesPerNuma[i] = std::max(_maxSizePerNuma[i] / _stateSize, 1ul);
+    for (int i = 0; i < _numaCount; i++) _maxStatesPerNuma[i] = _allocableBytesPerNuma[i] / _stateSize;
 
     // Getting totals for statistics
     _maxSize   = 0;
     _maxStates = 0;
     for (int i = 0; i < _numaCount; i++)
     {
-      _maxSize += _maxSizePerNuma[i];
+      _maxSize += _allocableBytesPerNuma[i];
       _maxStates += _maxStatesPerNuma[i];
     }
 
-    // Getting number of bytes to reserve for each NUMA domain
-    _allocableBytesPerNuma.resize(_numaCount);
-    for (int i = 0; i < _numaCount; i++) _allocableBytesPerNuma[i] = _maxStatesPerNuma[i] * _stateSize;
+    // Getting the size of the (power of two) slice reserved for each NUMA domain, so that the domain of a state can be obtained with a shift
+    // The slices are at least a page long, so that each of them starts at a page boundary
+    const size_t maxReservedBytes = hugePages::roundToPageSize(*std::max_element(_allocableBytesPerNuma.begin(), _allocableBytesPerNuma.end()), _hugePageMode);
+    _numaSliceShift               = 0;
+    while (((size_t)1 << _numaSliceShift) < maxReservedBytes) _numaSliceShift++;
+
+    // Reserving a single virtual range for all NUMA domains. Physical pages are only assigned on first touch
+    _internalBufferSize = (size_t)_numaCount << _numaSliceShift;
+    _internalBuffer     = hugePages::reserveAddressSpace(_internalBufferSize, _hugePageMode);
 
-    // Creating internal buffers, one per NUMA domain
+    // Committing the part of each domain's slice that is used (not the padding up to the power of two), and binding it to its NUMA domain
     _internalBuffersStart.resize(_numaCount);
-    _internalBuffersEnd.resize(_numaCount);
     for (int i = 0; i < _numaCount; i++)
     {
-      _internalBuffersStart[i] = (uint8_t *)numa_alloc_onnode(_allocableBytesPerNuma[i], i);
-      if (_internalBuffersStart[i] == NULL) JAFFAR_THROW_RUNTIME("Error trying to allocate memory for numa domain %d\n", i);
-      _internalBuffersEnd[i] = &_internalBuffersStart[i][_allocableBytesPerNuma[i]];
+      _internalBuffersStart[i] = &_internalBuffer[(size_t)i << _numaSliceShift];
+      hugePages::commit(_internalBuffersStart[i], _allocableBytesPerNuma[i], _hugePageMode);
+      numa_tonode_memory(_internalBuffersStart[i], hugePages::roundToPageSize(_allocableBytesPerNuma[i], _hugePageMode), i);
     }
 
     // Determining the preferred numa domain for each thread. This depends on OpenMP using always the same set of threads.
+    std::vector<int> threadNumaDomains(jaffarCommon::parallel::getMaxThreadCount());
     JAFFAR_PARALLEL
     {
       int cpu             = sched_getcpu();
       int node            = numa_node_of_cpu(cpu);
       preferredNumaDomain = node;
-    }
 
-    // Getting system's page size (typically 4K but it may change in the future)
-    const size_t pageSize = sysconf(_SC_PAGESIZE);
+      // Remembering it for the first touch
+      threadNumaDomains[jaffarCommon::parallel::getThreadId()] = node;
+    }
 
-    // Initializing the internal buffers
-    for (int numaNodeIdx = 0; numaNodeIdx < _numaCount; numaNodeIdx++) JAFFAR_PARALLEL_FOR
-    for (size_t i = 0; i < _allocableBytesPerNuma[numaNodeIdx]; i += pageSize) _internalBuffersStart[numaNodeIdx][i] = 1;
+    // Ranking the threads within their domain, so that each of them touches its own part of the domain's buffer
+    std::vector<size_t> numaThreadCounts(_numaCount, 0);
+    std::vector<size_t> threadNumaRanks(threadNumaDomains.size());
+    for (size_t i = 0; i < threadNumaDomains.size(); i++) threadNumaRanks[i] = numaThreadCounts[threadNumaDomains[i]]++;
 
-    // Adding the state pointers to the free state queues
-    _freeStateQueues.resize(_numaCount);
-    for (int numaNodeIdx = 0; numaNodeIdx < _numaCount; numaNodeIdx++)
+    // Initializing the internal buffers. Each domain's pages are first-touched by the threads running on it, so they are zeroed by local cores
+    // With several size classes, it is not known in advance which pages will be used, so they are touched as their states are issued instead
+    if (_sizeClassSizes.size() == 1)
     {
-      _freeStateQueues[numaNodeIdx] = std::make_unique<jaffarCommon::concurrent::atomicQueue_t<void *>>(_maxStatesPerNuma[numaNodeIdx]);
-      for (size_t i = 0; i < _maxStatesPerNuma[numaNodeIdx]; i++) _freeStateQueues[numaNodeIdx]->try_push((void *)&_internalBuffersStart[numaNodeIdx][i * _stateSize]);
+      JAFFAR_PARALLEL
+      {
+        const int    threadId  = jaffarCommon::parallel::getThreadId();
+        const int    numaIdx   = threadNumaDomains[threadId];
+        const size_t pageCount = (_allocableBytesPerNuma[numaIdx] + pageSize - 1) / pageSize;
+        const size_t firstPage = pageCount * threadNumaRanks[threadId] / numaThreadCounts[numaIdx];
+        const size_t lastPage  = pageCount * (threadNumaRanks[threadId] + 1) / numaThreadCounts[numaIdx];
+        for (size_t i = firstPage; i < lastPage; i++) _internalBuffersStart[numaIdx][i * pageSize] = 1;
+      }
+
+      // Domains without threads of their own (e.g., memory-only domains) are touched by all threads
+      for (int numaNodeIdx = 0; numaNodeIdx < _numaCount; numaNodeIdx++)
+        if (numaThreadCounts[numaNodeIdx] == 0)
+        {
+          JAFFAR_PARALLEL_FOR
+          for (size_t i = 0; i < _allocableBytesPerNuma[numaNodeIdx]; i += pageSize) _internalBuffersStart[numaNodeIdx][i] = 1;
+        }
     }
+
+    // Creating the free state pools. States are issued from each domain's buffer lazily, as they are requested
+    _freeStatePools.resize(_numaCount);
+    for (int numaNodeIdx = 0; numaNodeIdx < _numaCount; numaNodeIdx++)
+      _freeStatePools[numaNodeIdx] = std::make_unique<SlabPool>(_internalBuffersStart[numaNodeIdx], _maxSizePerNuma[numaNodeIdx], _sizeClassSizes);
+  }
+
+  // All states are kept in memory, so only the chunks of the size classes that ran out of them are reclaimed
+  void advanceStepImpl() override
+  {
+    for (auto &freeStatePool : _freeStatePools) freeStatePool->reclaimChunks();
   }
 
   // Function to print relevant information
@@ -139,8 +188,16 @@ class Numa : public stateDb::Base
       jaffarCommon::logger::log("[J+]  + NUMA Domain %d                  Max States: %lu, Size: %.3f Mb (%.6f Gb)\n",
                                 i,
                                 _maxStatesPerNuma[i],
-                                (double)_maxSizePerNuma[i] / (1024.0 * 1024.0),
-                                (double)_maxSizePerNuma[i] / (1024.0 * 1024.0 * 1024.0));
+                                (double)_allocableBytesPerNuma[i] / (1024.0 * 1024.0),
+                                (double)_allocableBytesPerNuma[i] / (1024.0 * 1024.0 * 1024.0));
+    if (_sizeClassSizes.size() > 1)
+      for (int i = 0; i < _numaCount; i++)
+        jaffarCommon::logger::log("[J+]  + NUMA Domain %d Size Class Chunks: %lu / %lu in use (%.3f Mb each)\n",
+                                  i,
+                                  _freeStatePools[i]->getUsedChunkCount(),
+                                  _freeStatePools[i]->getChunkCount(),
+                                  (double)_freeStatePools[i]->getChunkSize() / (1024.0 * 1024.0));
+    jaffarCommon::logger::log("[J+]  + Use Huge Pages:                %s\n", hugePages::getModeName(_hugePageMode));
 
     size_t totalFreeStatesRequested = _numaNonLocalFreeStateCount + _numaLocalFreeStateCount + _numaFreeStateNotFoundCount;
     jaffarCommon::logger::log("[J+] + Numa Locality Success Rate:                     %5.3f%%\n",
@@ -153,28 +210,28 @@ class Numa : public stateDb::Base
 
   __INLINE__ void *getFreeState() override
   {
-    // Storage for the new free state space
-    void *stateSpace;
+    // New states are of the largest size class
+    const size_t sizeClass = _sizeClassSizes.size() - 1;
 
-    // Trying to get free space for a new state
-    bool success = _freeStateQueues[preferredNumaDomain]->try_pop(stateSpace);
+    // Trying to get free space for a new state from this thread's magazines for its preferred domain
+    void *stateSpace = _freeStatePools[preferredNumaDomain]->getFreeState(sizeClass);
 
     // If successful, return the pointer immediately
-    if (success == true) return stateSpace;
+    if (stateSpace != nullptr) return stateSpace;
 
-    // Trying all other free state queues now
-    for (int i = 0; (size_t)i < _freeStateQueues.size(); i++)
+    // Trying all other free state pools now
+    for (int i = 0; (size_t)i < _freeStatePools.size(); i++)
       if (i != preferredNumaDomain)
       {
         // Trying to get free space for a new state
-        bool success = _freeStateQueues[i]->try_pop(stateSpace);
+        stateSpace = _freeStatePools[i]->getFreeState(sizeClass);
 
         // If successful, return the pointer immediately
-        if (success == true) return stateSpace;
+        if (stateSpace != nullptr) return stateSpace;
       }
 
     // If failed, then try to get it from the back of the current state database
-    success = _currentStateDb.pop_back_get(stateSpace);
+    bool success = _currentStateDb.pop_back_get(stateSpace);
 
     // If successful, return the pointer immediately
     if (success == true) return stateSpace;
@@ -183,25 +240,27 @@ class Numa : public stateDb::Base
     return nullptr;
   }
 
-  __INLINE__ int getStateNumaDomain(void *const statePtr)
+  __INLINE__ void *getFreeSizeClassState(const size_t sizeClass) override
   {
-    for (int i = 0; i < _numaCount; i++)
-      if ((statePtr >= _internalBuffersStart[i]) && (statePtr <= _internalBuffersEnd[i])) return i;
+    // Trying the preferred domain first, and then all the others
+    void *stateSpace = _freeStatePools[preferredNumaDomain]->getFreeState(sizeClass);
+    for (int i = 0; stateSpace == nullptr && (size_t)i < _freeStatePools.size(); i++)
+      if (i != preferredNumaDomain) stateSpace = _freeStatePools[i]->getFreeState(sizeClass);
 
-    // Check for error
-    JAFFAR_THROW_RUNTIME("Did not find the corresponding numa domain for the provided state pointer. This must be a bug in Jaffar\n");
+    return stateSpace;
   }
 
+  __INLINE__ int getStateNumaDomain(const void *const statePtr) const { return (int)(((const uint8_t *)statePtr - _internalBuffer) >> _numaSliceShift); }
+
+  __INLINE__ size_t getStateSizeClass(const void *const statePtr) const override { return _freeStatePools[getStateNumaDomain(statePtr)]->getSizeClass(statePtr); }
+
   __INLINE__ void returnFreeState(void *const statePtr) override
   {
     // Finding out to which database this state pointer belongs to
     const auto numaIdx = getStateNumaDomain(statePtr);
 
-    // Pushing the state in the corresponding queue
-    bool success = _freeStateQueues[numaIdx]->try_push(statePtr);
-
-    // Check for success
-    if (success == false) JAFFAR_THROW_RUNTIME("Failed on pushing free state back. This must be a bug in Jaffar\n");
+    // Returning the state into this thread's magazines for the corresponding domain
+    _freeStatePools[numaIdx]->returnFreeState(statePtr);
   }
 
   __INLINE__ void *popState() override
@@ -320,19 +379,34 @@ class Numa : public stateDb::Base
   size_t _scavengingDepth;
 
   /**
-   * This queue will hold pointers to all the free state storage
+   * These pools (one per NUMA domain) will hold pointers to all the free state storage
    */
-  std::vector<std::unique_ptr<jaffarCommon::concurrent::atomicQueue_t<void *>>> _freeStateQueues;
+  std::vector<std::unique_ptr<SlabPool>> _freeStatePools;
 
   /**
-   * Start pointer for the internal buffers for the state database
+   * Single virtual range holding the internal buffers of all NUMA domains
    */
-  std::vector<uint8_t *> _internalBuffersStart;
+  uint8_t *_internalBuffer = nullptr;
+
+  /**
+   * Size of the virtual range, in bytes
+   */
+  size_t _internalBufferSize = 0;
+
+  /**
+   * Each NUMA domain owns a slice of (1 << _numaSliceShift) bytes of the virtual range
+   */
+  size_t _numaSliceShift;
 
   /**
-   * End pointer for each of the internal buffers
+   * Page backing for the virtual range
    */
-  std::vector<uint8_t *> _internalBuffersEnd;
+  hugePages::hugePageMode_t _hugePageMode;
+
+  /**
+   * Start pointer for each NUMA domain's slice of the virtual range
+   */
+  std::vector<uint8_t *> _internalBuffersStart;
 
   /**
    * Number of bytes to allocate per NUMA domain
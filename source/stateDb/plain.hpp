@@ -6,7 +6,9 @@
 #include <jaffarCommon/json.hpp>
 #include <jaffarCommon/logger.hpp>
 #include <jaffarCommon/parallel.hpp>
+#include "../hugePages.hpp"
 #include "base.hpp"
+#include "slabPool.hpp"
 
 namespace jaffarPlus
 {
@@ -26,36 +28,47 @@ class Plain : public stateDb::Base
 
     // For testing purposes, the maximum size can be overriden by environment variables
     if (auto *value = std::getenv("JAFFAR_ENGINE_OVERRIDE_MAX_STATEDB_SIZE_MB")) _maxSizeMb = std::stoul(value);
+
+    // Getting the page backing to use for the state storage
+    _hugePageMode = hugePages::parseMode(config);
   }
 
-  ~Plain() = default;
+  ~Plain()
+  {
+    if (_internalBuffer != nullptr) hugePages::release(_internalBuffer, _internalBufferSize, _hugePageMode);
+  }
 
   void initializeImpl() override
   {
     // Converting it to pure bytes
-    _maxSize = _maxSizeMb * 1024ul * 1024ul;
-
-    // Getting maximum number of states
-    _maxStates = _maxSize / _stateSize;
+    const size_t maxSize = _maxSizeMb * 1024ul * 1024ul;
 
-    // Creating free state queue
-    _freeStateQueue = std::make_unique<jaffarCommon::concurrent::atomicQueue_t<void *>>(_maxStates);
+    // Getting the size of the pages backing the state storage (typically 4K, or 2M / 1G if huge pages are used)
+    const size_t pageSize = hugePages::getPageSize(_hugePageMode);
 
-    // Getting system's page size (typically 4K but it may change in the future)
-    const size_t pageSize = sysconf(_SC_PAGESIZE);
+    // Allocating space for the states. With several size classes, it is split into the chunks they take
+    _internalBufferSize = SlabPool::getStorageSize(maxSize, _sizeClassSizes);
+    _internalBuffer     = hugePages::reserve(_internalBufferSize, _hugePageMode);
 
-    // Allocating space for the states
-    auto status = posix_memalign((void **)&_internalBuffer, pageSize, _maxSize);
-    if (status != 0) JAFFAR_THROW_RUNTIME("Could not allocate aligned memory for the state database");
+    // Getting the usable size and maximum number of states (if they were all of the largest size class)
+    _maxSize   = _internalBufferSize;
+    _maxStates = _maxSize / _stateSize;
 
-    // Doing first touch for every page
-    JAFFAR_PARALLEL_FOR
-    for (size_t i = 0; i < _maxSize; i += pageSize) _internalBuffer[i] = 1;
+    // Doing first touch for every page. With several size classes, it is not known in advance which pages will be
+    // used, so they are touched as their states are issued instead
+    if (_sizeClassSizes.size() == 1)
+    {
+      JAFFAR_PARALLEL_FOR
+      for (size_t i = 0; i < _maxSize; i += pageSize) _internalBuffer[i] = 1;
+    }
 
-    // Adding the state pointers to the free state queue
-    for (size_t i = 0; i < _maxStates; i++) _freeStateQueue->try_push((void *)&_internalBuffer[i * _stateSize]);
+    // Creating free state pool. States are issued from the buffer lazily, as they are requested
+    _freeStatePool = std::make_unique<SlabPool>(_internalBuffer, maxSize, _sizeClassSizes);
   }
 
+  // All states are kept in memory, so only the chunks of the size classes that ran out of them are reclaimed
+  void advanceStepImpl() override { _freeStatePool->reclaimChunks(); }
+
   // Function to print relevant information
   void printInfoImpl() const override
   {
@@ -63,21 +76,24 @@ class Plain : public stateDb::Base
                               _maxStates,
                               (double)_maxSize / (1024.0 * 1024.0),
                               (double)_maxSize / (1024.0 * 1024.0 * 1024.0));
+    if (_sizeClassSizes.size() > 1)
+      jaffarCommon::logger::log("[J+]  + Size Class Chunks:             %lu / %lu in use (%.3f Mb each)\n",
+                                _freeStatePool->getUsedChunkCount(),
+                                _freeStatePool->getChunkCount(),
+                                (double)_freeStatePool->getChunkSize() / (1024.0 * 1024.0));
+    jaffarCommon::logger::log("[J+]  + Use Huge Pages:                %s\n", hugePages::getModeName(_hugePageMode));
   }
 
   __INLINE__ void *getFreeState() override
   {
-    // Storage for the new free state space
-    void *stateSpace;
-
-    // Trying to get free space for a new state
-    bool success = _freeStateQueue->try_pop(stateSpace);
+    // Trying to get free space for a new state (of the largest size class) from this thread's magazines
+    void *stateSpace = _freeStatePool->getFreeState(_sizeClassSizes.size() - 1);
 
     // If successful, return the pointer immediately
-    if (success == true) return stateSpace;
+    if (stateSpace != nullptr) return stateSpace;
 
     // If failed, then try to get it from the back of the current state database
-    success = _currentStateDb.pop_back_get(stateSpace);
+    bool success = _currentStateDb.pop_back_get(stateSpace);
 
     // If successful, return the pointer immediately
     if (success == true) return stateSpace;
@@ -86,13 +102,14 @@ class Plain : public stateDb::Base
     return nullptr;
   }
 
+  __INLINE__ void *getFreeSizeClassState(const size_t sizeClass) override { return _freeStatePool->getFreeState(sizeClass); }
+
+  __INLINE__ size_t getStateSizeClass(const void *const statePtr) const override { return _freeStatePool->getSizeClass(statePtr); }
+
   __INLINE__ void returnFreeState(void *const statePtr) override
   {
-    // Trying to get free space for a new state
-    bool success = _freeStateQueue->try_push(statePtr);
-
-    // If successful, return the pointer immediately
-    if (success == false) JAFFAR_THROW_RUNTIME("Failed on pushing free state back. This must be a bug in Jaffar\n");
+    // Returning the state into this thread's magazines
+    _freeStatePool->returnFreeState(statePtr);
   }
 
   __INLINE__ void *popState() override
@@ -117,14 +134,24 @@ class Plain : public stateDb::Base
   private:
 
   /**
-   * This queue will hold pointers to all the free state storage
+   * This pool will hold pointers to all the free state storage
    */
-  std::unique_ptr<jaffarCommon::concurrent::atomicQueue_t<void *>> _freeStateQueue;
+  std::unique_ptr<SlabPool> _freeStatePool;
 
   /**
    * Internal buffer for the state database
    */
-  uint8_t *_internalBuffer;
+  uint8_t *_internalBuffer = nullptr;
+
+  /**
+   * Size of the internal buffer, in bytes
+   */
+  size_t _internalBufferSize = 0;
+
+  /**
+   * Page backing for the internal buffer
+   */
+  hugePages::hugePageMode_t _hugePageMode;
 
   /**
    * Configured maximum size (Mb) for the state database to grow to
@@ -0,0 +1,321 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <jaffarCommon/logger.hpp>
+#include <jaffarCommon/parallel.hpp>
+#include "magazinePool.hpp"
+
+namespace jaffarPlus
+{
+
+namespace stateDb
+{
+
+/**
+ * Pool of free states of several size classes (slabs), sharing a single storage.
+ *
+ * The storage is split into chunks, which the size classes take as they need them. A chunk only holds states of the
+ * class that took it, so the class of a state is that of its chunk. Physical memory is only used by the chunks taken
+ * so far, as long as the storage was reserved without committing it.
+ *
+ * Freed states are reused for states of the same class. When a class needs a chunk and none are left, the chunks whose
+ * states are all free are given back at the next step (see reclaimChunks), so that any class can take them again.
+ *
+ * With a single size class, the whole storage is a single chunk, that is, a plain contiguous pool.
+ */
+class SlabPool final
+{
+  public:
+
+  // Minimum number of states of the largest size class a chunk can hold. The end of a chunk that cannot hold a whole state is left unused
+  static constexpr size_t minStatesPerChunk = 16;
+
+  /**
+   * Gets the size of the chunks for the given budget and size classes
+   */
+  static __INLINE__ size_t getChunkSize(const size_t maxSize, const std::vector<size_t> &sizeClassSizes)
+  {
+    if (sizeClassSizes.size() == 1) return std::max(maxSize, sizeClassSizes.back());
+    return minStatesPerChunk * sizeClassSizes.back();
+  }
+
+  /**
+   * Gets the number of chunks for the given budget and chunk size. There is at least one, even if the budget is smaller
+   */
+  static __INLINE__ size_t getChunkCount(const size_t maxSize, const size_t chunkSize) { return std::max(maxSize / chunkSize, (size_t)1); }
+
+  /**
+   * Gets the size of the storage to reserve for the given budget and size classes. It does not exceed the budget, unless
+   * the budget is smaller than a chunk
+   */
+  static __INLINE__ size_t getStorageSize(const size_t maxSize, const std::vector<size_t> &sizeClassSizes)
+  {
+    const size_t chunkSize = getChunkSize(maxSize, sizeClassSizes);
+    return getChunkCount(maxSize, chunkSize) * chunkSize;
+  }
+
+  SlabPool(uint8_t *const storage, const size_t maxSize, const std::vector<size_t> &sizeClassSizes)
+    : _storage(storage)
+    , _chunkSize(getChunkSize(maxSize, sizeClassSizes))
+    , _chunkCount(getChunkCount(maxSize, _chunkSize))
+    , _chunkClasses(_chunkCount, 0)
+  {
+    for (size_t i = 0; i < sizeClassSizes.size(); i++)
+    {
+      auto sizeClass            = std::make_unique<sizeClass_t>();
+      sizeClass->stateSize      = sizeClassSizes[i];
+      sizeClass->statesPerChunk = _chunkSize / sizeClassSizes[i];
+      sizeClass->pool           = std::make_unique<MagazinePool>(_chunkCount * sizeClass->statesPerChunk,
+                                                       [this, i](void **slots, const size_t maxCount) { return issueStates(i, slots, maxCount); });
+      _sizeClasses.push_back(std::move(sizeClass));
+    }
+  }
+
+  ~SlabPool() = default;
+
+  /**
+   * Gets a free state of the given size class, or a null pointer if there are none left
+   */
+  __INLINE__ void *getFreeState(const size_t sizeClass) { return _sizeClasses[sizeClass]->pool->getFreeState(); }
+
+  /**
+   * Returns a free state into the pool of its size class
+   */
+  __INLINE__ void returnFreeState(void *const statePtr) { _sizeClasses[getSizeClass(statePtr)]->pool->returnFreeState(statePtr); }
+
+  /**
+   * Gets the size class of the given state
+   */
+  __INLINE__ size_t getSizeClass(const void *const statePtr) const { return _chunkClasses[((const uint8_t *)statePtr - _storage) / _chunkSize]; }
+
+  /**
+   * Gets the maximum number of states of the given size class, if they took all the chunks
+   */
+  __INLINE__ size_t getMaxStates(const size_t sizeClass) const { return _chunkCount * _sizeClasses[sizeClass]->statesPerChunk; }
+
+  /**
+   * Gets the size of the chunks
+   */
+  __INLINE__ size_t getChunkSize() const { return _chunkSize; }
+
+  /**
+   * Gets the number of chunks in the storage
+   */
+  __INLINE__ size_t getChunkCount() const { return _chunkCount; }
+
+  /**
+   * Gets the number of chunks taken by the size classes
+   */
+  __INLINE__ size_t getUsedChunkCount() const { return _usedChunkCount.load(); }
+
+  /**
+   * Gives back the chunks whose states are all free, if a size class ran out of them since the last call. The free
+   * states left in the other chunks are then handed out starting with the fullest chunks, so that the emptiest ones
+   * get a chance to become free as well
+   *
+   * Must only be called while no other thread is using the pool (e.g., between steps)
+   */
+  __INLINE__ void reclaimChunks()
+  {
+    // With a single size class, its only chunk is never given back
+    if (_sizeClasses.size() == 1) return;
+    if (_isOutOfChunks.exchange(false) == false) return;
+
+    // Number of free states in each chunk
+    std::vector<uint32_t> chunkFreeStateCounts(_chunkCount, 0);
+
+    JAFFAR_PARALLEL_FOR
+    for (size_t sizeClassIdx = 0; sizeClassIdx < _sizeClasses.size(); sizeClassIdx++)
+    {
+      auto &sizeClass = *_sizeClasses[sizeClassIdx];
+
+      // Taking all the free states of this class, and counting them per chunk. The states not yet issued from the
+      // current chunk count as free as well
+      std::vector<void *> freeStates;
+      sizeClass.pool->drainFreeStates(freeStates);
+      for (const auto statePtr : freeStates) chunkFreeStateCounts[getChunkIdx(statePtr)]++;
+      if (sizeClass.currentChunk != noChunk) chunkFreeStateCounts[sizeClass.currentChunk] += sizeClass.statesPerChunk - sizeClass.nextStateInChunk;
+
+      // Giving back the chunks with all their states free
+      size_t releasedStateCount = 0;
+      auto   isReleased         = [&](const size_t chunkIdx) { return chunkFreeStateCounts[chunkIdx] == sizeClass.statesPerChunk; };
+      for (const auto statePtr : freeStates)
+        if (isReleased(getChunkIdx(statePtr)) == true) releasedStateCount++;
+      if (sizeClass.currentChunk != noChunk && isReleased(sizeClass.currentChunk) == true)
+      {
+        chunkFreeStateCounts[sizeClass.currentChunk] = 0;
+        releaseChunk(sizeClass.currentChunk);
+        sizeClass.currentChunk = noChunk;
+      }
+      for (const auto statePtr : freeStates)
+      {
+        const size_t chunkIdx = getChunkIdx(statePtr);
+        if (isReleased(chunkIdx) == false) continue;
+        chunkFreeStateCounts[chunkIdx] = 0;
+        releaseChunk(chunkIdx);
+      }
+
+      // Putting back the rest, starting with the fullest chunks
+      std::erase_if(freeStates, [&](const void *statePtr) { return chunkFreeStateCounts[getChunkIdx(statePtr)] == 0; });
+      std::sort(freeStates.begin(),
+                freeStates.end(),
+                [&](const void *a, const void *b)
+                {
+                  const auto aCount = chunkFreeStateCounts[getChunkIdx(a)];
+                  const auto bCount = chunkFreeStateCounts[getChunkIdx(b)];
+                  return aCount != bCount ? aCount < bCount : a < b;
+                });
+      sizeClass.pool->refillFreeStates(freeStates, releasedStateCount);
+
+      // Letting the class take chunks again
+      sizeClass.isOutOfChunks = false;
+    }
+  }
+
+  private:
+
+  // Marks a size class without a chunk to issue states from
+  static constexpr size_t noChunk = (size_t)-1;
+
+  /**
+   * The state of a size class
+   */
+  struct sizeClass_t
+  {
+    // Size of its states
+    size_t stateSize;
+
+    // Number of its states that a chunk holds
+    size_t statesPerChunk;
+
+    // Chunk from which it currently issues states, and the next of them to issue
+    size_t currentChunk     = noChunk;
+    size_t nextStateInChunk = 0;
+
+    // Whether it found no chunk left to take, so it does not try again until chunks are reclaimed
+    std::atomic<bool> isOutOfChunks = false;
+
+    // Serializes the issuing of its states
+    std::mutex mutex;
+
+    // Its free states
+    std::unique_ptr<MagazinePool> pool;
+  };
+
+  __INLINE__ size_t getChunkIdx(const void *const statePtr) const { return ((const uint8_t *)statePtr - _storage) / _chunkSize; }
+
+  /**
+   * Fills the given slots with up to the given number of new states of the given size class, taking new chunks as needed
+   */
+  __INLINE__ size_t issueStates(const size_t sizeClassIdx, void **slots, const size_t maxCount)
+  {
+    auto &sizeClass = *_sizeClasses[sizeClassIdx];
+    if (sizeClass.isOutOfChunks.load(std::memory_order_relaxed) == true) return 0;
+
+    std::lock_guard<std::mutex> lock(sizeClass.mutex);
+    size_t                      stateCount = 0;
+    while (stateCount < maxCount)
+    {
+      // Taking a new chunk, if the current one is used up
+      if (sizeClass.currentChunk == noChunk || sizeClass.nextStateInChunk == sizeClass.statesPerChunk)
+      {
+        sizeClass.currentChunk     = takeChunk(sizeClassIdx);
+        sizeClass.nextStateInChunk = 0;
+        if (sizeClass.currentChunk == noChunk)
+        {
+          sizeClass.isOutOfChunks = true;
+          _isOutOfChunks          = true;
+          break;
+        }
+      }
+
+      // Issuing as many states from it as possible
+      const size_t chunkStateCount = std::min(maxCount - stateCount, sizeClass.statesPerChunk - sizeClass.nextStateInChunk);
+      uint8_t     *chunkStart      = &_storage[sizeClass.currentChunk * _chunkSize];
+      for (size_t i = 0; i < chunkStateCount; i++) slots[stateCount++] = &chunkStart[(sizeClass.nextStateInChunk++) * sizeClass.stateSize];
+    }
+
+    // Reversing the slots, so that states are handed out in storage order
+    std::reverse(slots, slots + stateCount);
+    return stateCount;
+  }
+
+  /**
+   * Takes a chunk for the given size class, preferring those given back (whose pages are already in use) over unused ones
+   * Returns noChunk if there are none left
+   */
+  __INLINE__ size_t takeChunk(const size_t sizeClassIdx)
+  {
+    std::lock_guard<std::mutex> lock(_chunksMutex);
+
+    size_t chunkIdx = noChunk;
+    if (_releasedChunks.empty() == false)
+    {
+      chunkIdx = _releasedChunks.back();
+      _releasedChunks.pop_back();
+    }
+    else if (_nextUnusedChunk < _chunkCount) chunkIdx = _nextUnusedChunk++;
+
+    if (chunkIdx == noChunk) return noChunk;
+    _chunkClasses[chunkIdx] = (uint16_t)sizeClassIdx;
+    _usedChunkCount++;
+    return chunkIdx;
+  }
+
+  __INLINE__ void releaseChunk(const size_t chunkIdx)
+  {
+    std::lock_guard<std::mutex> lock(_chunksMutex);
+    _releasedChunks.push_back(chunkIdx);
+    _usedChunkCount--;
+  }
+
+  /**
+   * Storage holding the chunks
+   */
+  uint8_t *const _storage;
+
+  /**
+   * Size of each chunk, in bytes
+   */
+  const size_t _chunkSize;
+
+  /**
+   * Number of chunks in the storage
+   */
+  const size_t _chunkCount;
+
+  /**
+   * Size class of the states in each chunk
+   */
+  std::vector<uint16_t> _chunkClasses;
+
+  /**
+   * Chunks given back by their size classes, and the next chunk never taken so far
+   */
+  std::vector<size_t> _releasedChunks;
+  size_t              _nextUnusedChunk = 0;
+  std::mutex          _chunksMutex;
+
+  /**
+   * Number of chunks currently taken by the size classes
+   */
+  std::atomic<size_t> _usedChunkCount = 0;
+
+  /**
+   * Whether a size class ran out of chunks since the last reclaim
+   */
+  std::atomic<bool> _isOutOfChunks = false;
+
+  /**
+   * State of each size class
+   */
+  std::vector<std::unique_ptr<sizeClass_t>> _sizeClasses;
+};
+
+} // namespace stateDb
+
+} // namespace jaffarPlus
@@ -0,0 +1,465 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+#include <jaffarCommon/concurrent.hpp>
+#include <jaffarCommon/json.hpp>
+#include <jaffarCommon/logger.hpp>
+#include <jaffarCommon/parallel.hpp>
+#include "../hugePages.hpp"
+#include "base.hpp"
+#include "magazinePool.hpp"
+
+namespace jaffarPlus
+{
+
+namespace stateDb
+{
+
+/**
+ * A state database that extends the memory-resident storage with a file (ideally on a fast NVMe drive).
+ *
+ * New states are stored in memory while there is space left. Once it runs out, the thread that needs space writes the
+ * lower-reward half (up to a batch) of the in-memory states it has produced in the current step, as a single sequential
+ * run, into the spill file, and reuses their memory. This choice is local to each thread: a spilled state may have a
+ * higher reward than states other threads kept in memory.
+ *
+ * Spilled states are not set apart. At the end of the step, they are sorted by reward together with the in-memory ones,
+ * so the next step reads them back (through a memory mapping of the file) interleaved with those, as their reward comes
+ * up. Within each run, the states are written by descending reward, so reading a run back moves forward through the file.
+ *
+ * The spill file is split in two regions: one holds the spilled states of the current step, and the other receives those
+ * of the next one. Since every step consumes all of its base states, the regions are simply swapped after each step.
+ */
+class Tiered : public stateDb::Base
+{
+  public:
+
+  // Size of the runs of states written to the spill file at once (per thread)
+  static constexpr size_t spillBatchSize = 4ul * 1024ul * 1024ul;
+
+  Tiered(Runner &r, const nlohmann::json &config)
+    : stateDb::Base(r, config)
+  {
+    // Getting maximum (in-memory) state db size in Mb
+    _maxSizeMb = jaffarCommon::json::getNumber<size_t>(config, "Max Size (Mb)");
+
+    // For testing purposes, the maximum size can be overriden by environment variables
+    if (auto *value = std::getenv("JAFFAR_ENGINE_OVERRIDE_MAX_STATEDB_SIZE_MB")) _maxSizeMb = std::stoul(value);
+
+    // Getting the page backing to use for the in-memory state storage
+    _hugePageMode = hugePages::parseMode(config);
+
+    // Getting spill file configuration
+    _spillFilePath  = jaffarCommon::json::getString(config, "Spill File Path");
+    _maxSpillSizeMb = jaffarCommon::json::getNumber<size_t>(config, "Max Spill Size (Mb)");
+
+    // Spilled states are stored at the full state size, so size classes would only save memory until they are spilled
+    if (_useSizeClasses == true) JAFFAR_THROW_LOGIC("State size classes are not supported by the Tiered state database");
+  }
+
+  ~Tiered()
+  {
+    if (_internalBuffer != nullptr) hugePages::release(_internalBuffer, _maxMemorySize, _hugePageMode);
+    if (_spillBuffer != nullptr) munmap(_spillBuffer, _spillSize);
+    if (_spillFileDescriptor >= 0) close(_spillFileDescriptor);
+  }
+
+  void initializeImpl() override
+  {
+    ///////// In-memory tier
+
+    // Converting it to pure bytes
+    _maxMemorySize = _maxSizeMb * 1024ul * 1024ul;
+
+    // Getting maximum number of in-memory states
+    _maxMemoryStates = _maxMemorySize / _stateSize;
+
+    // Getting the size of the pages backing the state storage (typically 4K, or 2M / 1G if huge pages are used)
+    const size_t pageSize = hugePages::getPageSize(_hugePageMode);
+
+    // Allocating space for the states
+    _internalBuffer = hugePages::reserve(_maxMemorySize, _hugePageMode);
+
+    // Doing first touch for every page
+    JAFFAR_PARALLEL_FOR
+    for (size_t i = 0; i < _maxMemorySize; i += pageSize) _internalBuffer[i] = 1;
+
+    // Creating free state pool. States are issued from the buffer lazily, as they are requested
+    _freeStatePool = std::make_unique<MagazinePool>(_internalBuffer, _stateSize, _maxMemoryStates);
+
+    ///////// Spill file tier
+
+    // Each of the two regions holds a whole number of states
+    _spillRegionStates = (_maxSpillSizeMb * 1024ul * 1024ul / 2) / _stateSize;
+    _spillRegionSize   = _spillRegionStates * _stateSize;
+    _spillSize         = 2 * _spillRegionSize;
+
+    // Creating the spill file. It is unlinked right away, so that it is removed even if the run does not finish cleanly
+    _spillFileDescriptor = open(_spillFilePath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (_spillFileDescriptor < 0) JAFFAR_THROW_RUNTIME("[ERROR] Could not create state database spill file '%s': %s\n", _spillFilePath.c_str(), strerror(errno));
+    unlink(_spillFilePath.c_str());
+
+    // Sizing it. The file is sparse, so disk space is only used as states are spilled
+    if (ftruncate(_spillFileDescriptor, _spillSize) != 0)
+      JAFFAR_THROW_RUNTIME("[ERROR] Could not resize state database spill file '%s' to %lu bytes: %s\n", _spillFilePath.c_str(), _spillSize, strerror(errno));
+
+    // Mapping it, so that the spilled states can be read back as any other state
+    if (_spillSize > 0)
+    {
+      void *mapping = mmap(nullptr, _spillSize, PROT_READ | PROT_WRITE, MAP_SHARED, _spillFileDescriptor, 0);
+      if (mapping == MAP_FAILED) JAFFAR_THROW_RUNTIME("[ERROR] Could not map state database spill file '%s': %s\n", _spillFilePath.c_str(), strerror(errno));
+      _spillBuffer = (uint8_t *)mapping;
+    }
+
+    // The maximum state count and size cover both the in-memory states and those of one spill region
+    _maxStates = _maxMemoryStates + _spillRegionStates;
+    _maxSize   = _maxMemorySize + _spillRegionSize;
+
+    // Creating per-thread spill staging buffers, sized to a whole number of states
+    _spillBatchStates    = std::max(spillBatchSize / _stateSize, (size_t)1);
+    _spillStagingBuffers = std::vector<spillStagingBuffer_t>(jaffarCommon::parallel::getMaxThreadCount());
+  }
+
+  // Function to print relevant information
+  void printInfoImpl() const override
+  {
+    jaffarCommon::logger::log("[J+]  + State Databse                  Max States: %lu, Size: %.3f Mb (%.6f Gb)\n",
+                              _maxMemoryStates,
+                              (double)_maxMemorySize / (1024.0 * 1024.0),
+                              (double)_maxMemorySize / (1024.0 * 1024.0 * 1024.0));
+    jaffarCommon::logger::log("[J+]  + Use Huge Pages:                %s\n", hugePages::getModeName(_hugePageMode));
+    jaffarCommon::logger::log("[J+]  + Spill File:                    '%s', Max States: %lu per step, Size: %.3f Mb (%.6f Gb)\n",
+                              _spillFilePath.c_str(),
+                              _spillRegionStates,
+                              (double)_spillSize / (1024.0 * 1024.0),
+                              (double)_spillSize / (1024.0 * 1024.0 * 1024.0));
+    jaffarCommon::logger::log("[J+]  + Spilled States:                %lu (%5.2f%% of the spill capacity)\n",
+                              _currentSpilledStates,
+                              _spillRegionStates > 0 ? 100.0 * (double)_currentSpilledStates / (double)_spillRegionStates : 0.0);
+    jaffarCommon::logger::log("[J+]  + Dropped Spilled States:        %lu\n", _droppedSpilledStates.load());
+  }
+
+  __INLINE__ void *getFreeState() override
+  {
+    // Trying to get free space for a new state from this thread's magazines
+    void *stateSpace = _freeStatePool->getFreeState();
+
+    // If successful, return the pointer immediately
+    if (stateSpace != nullptr) return stateSpace;
+
+    // If failed, then spill the lowest-reward states this thread produced so far, and use their memory
+    if (spillNextStates() == true)
+    {
+      stateSpace = _freeStatePool->getFreeState();
+      if (stateSpace != nullptr) return stateSpace;
+    }
+
+    // If there was nothing to spill, store the new state directly in the spill file
+    stateSpace = claimSpillStates(1);
+    if (stateSpace != nullptr) return stateSpace;
+
+    // If the spill file is full too, then try to get it from the back of the current state database. Only in-memory
+    // states can be reused, since the spill region they belong to is about to be recycled
+    while (_currentStateDb.pop_back_get(stateSpace) == true)
+    {
+      if (isSpilled(stateSpace) == false) return stateSpace;
+      _droppedSpilledStates++;
+    }
+
+    // Otherwise, return a null pointer. The state will be discarded
+    return nullptr;
+  }
+
+  // Size classes are not supported, so all states are of the full size
+  __INLINE__ void *getFreeSizeClassState(const size_t sizeClass) override { return nullptr; }
+
+  __INLINE__ size_t getStateSizeClass(const void *const statePtr) const override { return 0; }
+
+  __INLINE__ void returnFreeState(void *const statePtr) override
+  {
+    // Spilled states are not returned individually. Their region is reused as a whole once the step finishes
+    if (isSpilled(statePtr) == true) return;
+
+    // Returning the state into this thread's magazines
+    _freeStatePool->returnFreeState(statePtr);
+  }
+
+  __INLINE__ void *popState() override
+  {
+    // Pointer to return
+    void *statePtr;
+
+    // Trying to pop the next state from the current state database
+    const auto success = _currentStateDb.pop_front_get(statePtr);
+
+    // If not successful, return a null pointer
+    if (success == false) return nullptr;
+
+    return statePtr;
+  }
+
+  /**
+   * Gets the current number of states in the current state database
+   */
+  __INLINE__ size_t getStateCount() const override { return _currentStateDb.wasSize(); }
+
+  /**
+   * All the base states of the step were consumed, so the states spilled during it become the current ones, and the
+   * region of the previous ones can receive those of the next step
+   */
+  void advanceStepImpl() override
+  {
+    const size_t readRegion = _spillWriteRegion;
+    _spillWriteRegion ^= 1;
+
+    // Keeping track of the states spilled in the current step
+    _currentSpilledStates = std::min(_spillWriteUsage.load(), _spillRegionStates);
+
+    // Discarding the contents of the now unused region, so that its pages are neither kept in memory nor written back
+    const size_t discardedSize = std::min(_spillRegionUsage[_spillWriteRegion], _spillRegionSize);
+    if (discardedSize > 0) discardSpillFile(_spillWriteRegion * _spillRegionSize, discardedSize);
+
+    _spillRegionUsage[readRegion] = _currentSpilledStates * _stateSize;
+    _spillWriteUsage              = 0;
+
+    // The next state buffers were emptied, so the spill candidates start over
+    for (auto &staging : _spillStagingBuffers)
+    {
+      staging.candidates.clear();
+      staging.scannedStates = 0;
+    }
+  }
+
+  private:
+
+  /**
+   * Per-thread scratch space for spilling states, padded to prevent false sharing
+   */
+  struct alignas(64) spillStagingBuffer_t
+  {
+    // Contiguous copy of the states to write
+    std::vector<uint8_t> data;
+
+    // Indexes of the thread's next states that are candidates for spilling (those in memory), as a heap with the lowest reward on top
+    std::vector<size_t> candidates;
+
+    // Number of the thread's next states already considered as candidates
+    size_t scannedStates = 0;
+
+    // Indexes of the next states being spilled, by descending reward
+    std::vector<size_t> spilled;
+  };
+
+  /**
+   * Determines whether the given state is stored in the spill file
+   */
+  __INLINE__ bool isSpilled(const void *const statePtr) const { return statePtr >= _spillBuffer && statePtr < _spillBuffer + _spillSize; }
+
+  /**
+   * Claims space for the given number of contiguous states in the spill region of the next step, if there is enough left
+   */
+  __INLINE__ uint8_t *claimSpillStates(const size_t count)
+  {
+    // Checking first, to prevent the counter from growing unboundedly once the region is full
+    if (_spillWriteUsage.load(std::memory_order_relaxed) + count > _spillRegionStates) return nullptr;
+
+    const size_t firstState = _spillWriteUsage.fetch_add(count, std::memory_order_relaxed);
+    if (firstState + count > _spillRegionStates) return nullptr;
+
+    return &_spillBuffer[_spillWriteRegion * _spillRegionSize + firstState * _stateSize];
+  }
+
+  /**
+   * Moves the lowest-reward, in-memory states produced by the calling thread during this step into the spill file, with
+   * a single sequential write, and returns their memory into the thread's magazines.
+   *
+   * Returns false if the thread has no in-memory states to spill, or the spill file is full
+   */
+  __INLINE__ bool spillNextStates()
+  {
+    const auto threadId = jaffarCommon::parallel::getThreadId();
+    auto      &states   = _nextStateBuffers[threadId].states;
+    auto      &staging  = _spillStagingBuffers[threadId];
+
+    // Adding the thread's next states pushed since the last spill, if still in memory, to the candidates. This way, each
+    // state is only considered once per step
+    const auto isBetterThan = [&states](const size_t a, const size_t b) { return states[a].reward > states[b].reward; };
+    for (; staging.scannedStates < states.size(); staging.scannedStates++)
+      if (isSpilled(states[staging.scannedStates].statePtr) == false)
+      {
+        staging.candidates.push_back(staging.scannedStates);
+        std::push_heap(staging.candidates.begin(), staging.candidates.end(), isBetterThan);
+      }
+    if (staging.candidates.empty() == true) return false;
+
+    // Spilling (up to a batch of) the lower-reward half, claiming their space in the spill file
+    const size_t count      = std::min(std::max(staging.candidates.size() / 2, (size_t)1), _spillBatchStates);
+    auto        *spillSpace = claimSpillStates(count);
+    if (spillSpace == nullptr) return false;
+
+    // Taking them off the heap, sorted by descending reward, which is the order the next step reaches them in
+    staging.spilled.resize(count);
+    for (size_t i = 0; i < count; i++)
+    {
+      std::pop_heap(staging.candidates.begin(), staging.candidates.end(), isBetterThan);
+      staging.spilled[count - 1 - i] = staging.candidates.back();
+      staging.candidates.pop_back();
+    }
+
+    // Gathering them contiguously and writing them at once
+    staging.data.resize(_spillBatchStates * _stateSize);
+    for (size_t i = 0; i < count; i++) memcpy(&staging.data[i * _stateSize], states[staging.spilled[i]].statePtr, _stateSize);
+    writeSpillFile(staging.data.data(), count * _stateSize, spillSpace - _spillBuffer);
+
+    // Pointing the next states to their spilled copies, and reusing their memory
+    for (size_t i = 0; i < count; i++)
+    {
+      auto &state = states[staging.spilled[i]];
+      _freeStatePool->returnFreeState(state.statePtr);
+      state.statePtr = &spillSpace[i * _stateSize];
+    }
+
+    return true;
+  }
+
+  /**
+   * Writes the given data into the spill file at the given offset, and starts writing it back to disk right away, so
+   * that dirty pages do not accumulate in memory
+   */
+  __INLINE__ void writeSpillFile(const uint8_t *data, size_t size, off_t offset)
+  {
+    const off_t  startOffset = offset;
+    const size_t totalSize   = size;
+
+    while (size > 0)
+    {
+      const ssize_t writtenSize = pwrite(_spillFileDescriptor, data, size, offset);
+      if (writtenSize < 0 && errno == EINTR) continue;
+      if (writtenSize <= 0) JAFFAR_THROW_RUNTIME("[ERROR] Could not write to state database spill file '%s': %s\n", _spillFilePath.c_str(), strerror(errno));
+      data += writtenSize;
+      offset += writtenSize;
+      size -= writtenSize;
+    }
+
+    sync_file_range(_spillFileDescriptor, startOffset, totalSize, SYNC_FILE_RANGE_WRITE);
+  }
+
+  /**
+   * Discards the given range of the spill file, punching a hole in it. If the file system does not support it, the
+   * (already written back) pages are at least dropped from the page cache
+   */
+  __INLINE__ void discardSpillFile(const off_t offset, const size_t size)
+  {
+    if (_isPunchHoleSupported == true)
+    {
+      if (fallocate(_spillFileDescriptor, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, size) == 0) return;
+      if (errno != EOPNOTSUPP && errno != ENOSYS)
+        JAFFAR_THROW_RUNTIME("[ERROR] Could not discard %lu bytes of state database spill file '%s': %s\n", size, _spillFilePath.c_str(), strerror(errno));
+
+      jaffarCommon::logger::log("[J+] The file system of spill file '%s' cannot punch holes, its discarded states will take disk space\n", _spillFilePath.c_str());
+      _isPunchHoleSupported = false;
+    }
+
+    fdatasync(_spillFileDescriptor);
+    posix_fadvise(_spillFileDescriptor, offset, size, POSIX_FADV_DONTNEED);
+  }
+
+  /**
+   * This pool will hold pointers to all the free in-memory state storage
+   */
+  std::unique_ptr<MagazinePool> _freeStatePool;
+
+  /**
+   * Internal buffer for the in-memory states
+   */
+  uint8_t *_internalBuffer = nullptr;
+
+  /**
+   * Page backing for the internal buffer
+   */
+  hugePages::hugePageMode_t _hugePageMode;
+
+  /**
+   * Configured maximum size (Mb) for the in-memory states
+   */
+  size_t _maxSizeMb;
+
+  /**
+   * Size (bytes) and number of the in-memory states
+   */
+  size_t _maxMemorySize;
+  size_t _maxMemoryStates;
+
+  /**
+   * Path to the spill file
+   */
+  std::string _spillFilePath;
+
+  /**
+   * Configured maximum size (Mb) for the spill file
+   */
+  size_t _maxSpillSizeMb;
+
+  /**
+   * Spill file descriptor and mapping
+   */
+  int      _spillFileDescriptor = -1;
+  uint8_t *_spillBuffer         = nullptr;
+
+  /**
+   * Size of the spill file, and number of states and size of each of its two regions
+   */
+  size_t _spillSize;
+  size_t _spillRegionStates;
+  size_t _spillRegionSize;
+
+  /**
+   * Region receiving the states spilled during the current step, and how many of its states have been claimed
+   */
+  size_t              _spillWriteRegion = 0;
+  std::atomic<size_t> _spillWriteUsage  = 0;
+
+  /**
+   * Bytes used in each region, to discard them once the region is reused
+   */
+  size_t _spillRegionUsage[2] = {0, 0};
+
+  /**
+   * Whether the file system of the spill file can punch holes into it
+   */
+  bool _isPunchHoleSupported = true;
+
+  /**
+   * Number of states of the current state database stored in the spill file
+   */
+  size_t _currentSpilledStates = 0;
+
+  /**
+   * Number of spilled states dropped to make space for new states, once the spill file was full
+   */
+  std::atomic<size_t> _droppedSpilledStates = 0;
+
+  /**
+   * Maximum number of states written to the spill file at once
+   */
+  size_t _spillBatchStates;
+
+  /**
+   * Per-thread spill scratch space
+   */
+  std::vector<spillStagingBuffer_t> _spillStagingBuffers;
+};
+
+} // namespace stateDb
+
+} // namespace jaffarPlus
@@ -0,0 +1,298 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <jaffarCommon/logger.hpp>
+
+#ifdef __x86_64__
+  #include <immintrin.h>
+#endif
+
+namespace jaffarPlus
+{
+
+namespace stateDb
+{
+
+/**
+ * Block XOR-delta encoding of raw states against a reference state.
+ *
+ * The raw state is split into 32-byte blocks and XORed against the reference. The encoded delta is a bitmap with one
+ * bit per block telling whether it differs, followed by the XORed contents of the differing blocks only (the last one
+ * may be shorter). Unlike the generic differential serializer, this needs no knowledge of the state layout, and both
+ * encoding and decoding are straight vector loads, XORs and stores.
+ *
+ * The bitmap is read in 64-bit words, assuming a little-endian host.
+ */
+class XorDelta final
+{
+  public:
+
+  static constexpr size_t blockSize = 32;
+
+  static __INLINE__ size_t getBlockCount(const size_t rawSize) { return (rawSize + blockSize - 1) / blockSize; }
+
+  static __INLINE__ size_t getBitmapSize(const size_t rawSize) { return (getBlockCount(rawSize) + 7) / 8; }
+
+  /**
+   * Gets the maximum size of an encoded delta, if at most the given number of bytes may differ
+   */
+  static __INLINE__ size_t getMaxEncodedSize(const size_t rawSize, const size_t maxDifference) { return getBitmapSize(rawSize) + std::min(rawSize, maxDifference); }
+
+  /**
+   * Encodes the XOR delta between the input and the reference into the output. Returns the encoded size, or zero if
+   * it does not fit in the output capacity
+   */
+  static __INLINE__ size_t encode(const uint8_t *input, const uint8_t *reference, const size_t rawSize, uint8_t *output, const size_t outputCapacity)
+  {
+    const size_t bitmapSize = getBitmapSize(rawSize);
+    if (bitmapSize > outputCapacity) return 0;
+
+    uint8_t *bitmap = output;
+    memset(bitmap, 0, bitmapSize);
+
+    // Encoding the full blocks with the widest vectors the running CPU supports
+    const size_t fullBlockCount = rawSize / blockSize;
+    size_t       outputSize     = getKernels().encodeBlocks(input, reference, fullBlockCount, output, bitmapSize, outputCapacity);
+    if (outputSize == 0) return 0;
+
+    // The last block may be shorter than the others
+    const size_t tailSize = rawSize - fullBlockCount * blockSize;
+    if (tailSize > 0)
+    {
+      const size_t offset = fullBlockCount * blockSize;
+      uint8_t      delta[blockSize];
+      uint8_t      differences = 0;
+      for (size_t i = 0; i < tailSize; i++)
+      {
+        delta[i] = input[offset + i] ^ reference[offset + i];
+        differences |= delta[i];
+      }
+
+      if (differences != 0)
+      {
+        if (outputSize + tailSize > outputCapacity) return 0;
+        memcpy(&output[outputSize], delta, tailSize);
+        bitmap[fullBlockCount / 8] |= 1 << (fullBlockCount % 8);
+        outputSize += tailSize;
+      }
+    }
+
+    return outputSize;
+  }
+
+  /**
+   * Decodes the XOR delta into the output, by copying the reference and XORing the differing blocks into it
+   */
+  static __INLINE__ void decode(const uint8_t *input, const uint8_t *reference, const size_t rawSize, uint8_t *output)
+  {
+    memcpy(output, reference, rawSize);
+
+    // Decoding the full blocks with the widest vectors the running CPU supports
+    const size_t fullBlockCount = rawSize / blockSize;
+    const auto  *tailData       = getKernels().decodeBlocks(input, getBitmapSize(rawSize), fullBlockCount, output);
+
+    // The last block may be shorter than the others
+    const size_t tailOffset = fullBlockCount * blockSize;
+    if (tailOffset < rawSize && (input[fullBlockCount / 8] & (1 << (fullBlockCount % 8))) != 0)
+      for (size_t i = 0; i < rawSize - tailOffset; i++) output[tailOffset + i] ^= tailData[i];
+  }
+
+  /**
+   * Gets the name of the instruction set used to encode and decode, as chosen for the running CPU
+   */
+  static __INLINE__ const char *getInstructionSetName() { return getKernels().instructionSetName; }
+
+  private:
+
+  /**
+   * Encodes the full blocks into the output, after the bitmap. Returns the output size, or zero if they do not fit in the output capacity
+   */
+  typedef size_t (*blockEncoder_t)(const uint8_t *input, const uint8_t *reference, const size_t fullBlockCount, uint8_t *output, const size_t bitmapSize, const size_t outputCapacity);
+
+  /**
+   * XORs the differing full blocks into the output. Returns where the data of the (shorter) last block starts, if any
+   */
+  typedef const uint8_t *(*blockDecoder_t)(const uint8_t *input, const size_t bitmapSize, const size_t fullBlockCount, uint8_t *output);
+
+  /**
+   * Implementations of the block encoding and decoding for an instruction set
+   */
+  struct kernels_t
+  {
+    const char    *instructionSetName;
+    blockEncoder_t encodeBlocks;
+    blockDecoder_t decodeBlocks;
+  };
+
+  /**
+   * Gets the implementations for the running CPU. They are chosen once, as the vectorized ones are built regardless of
+   * the target the rest is built for (e.g., without -march=native)
+   */
+  static __INLINE__ const kernels_t &getKernels()
+  {
+    static const kernels_t kernels = selectKernels();
+    return kernels;
+  }
+
+  static kernels_t selectKernels()
+  {
+#ifdef __x86_64__
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512bw")) return {"AVX-512", encodeBlocksAvx512, decodeBlocksAvx2};
+    if (__builtin_cpu_supports("avx2")) return {"AVX2", encodeBlocksAvx2, decodeBlocksAvx2};
+#endif
+    return {"Scalar", encodeBlocksScalar, decodeBlocksScalar};
+  }
+
+  /**
+   * Gets the 64 bitmap entries starting at the given byte
+   */
+  static __INLINE__ uint64_t getBitmapWord(const uint8_t *bitmap, const size_t bitmapSize, const size_t wordOffset)
+  {
+    uint64_t bits = 0;
+    memcpy(&bits, &bitmap[wordOffset], std::min(sizeof(uint64_t), bitmapSize - wordOffset));
+    return bits;
+  }
+
+  static size_t encodeBlocksScalar(const uint8_t *input, const uint8_t *reference, const size_t fullBlockCount, uint8_t *output, const size_t bitmapSize, const size_t outputCapacity)
+  {
+    size_t outputSize = bitmapSize;
+    for (size_t blockIdx = 0; blockIdx < fullBlockCount; blockIdx++)
+    {
+      const size_t offset = blockIdx * blockSize;
+      uint64_t     delta[blockSize / sizeof(uint64_t)];
+      uint64_t     inputWords[blockSize / sizeof(uint64_t)];
+      uint64_t     referenceWords[blockSize / sizeof(uint64_t)];
+      memcpy(inputWords, &input[offset], blockSize);
+      memcpy(referenceWords, &reference[offset], blockSize);
+      for (size_t i = 0; i < blockSize / sizeof(uint64_t); i++) delta[i] = inputWords[i] ^ referenceWords[i];
+      if ((delta[0] | delta[1] | delta[2] | delta[3]) == 0) continue;
+      if (outputSize + blockSize > outputCapacity) return 0;
+      memcpy(&output[outputSize], delta, blockSize);
+
+      output[blockIdx / 8] |= 1 << (blockIdx % 8);
+      outputSize += blockSize;
+    }
+
+    return outputSize;
+  }
+
+  static const uint8_t *decodeBlocksScalar(const uint8_t *input, const size_t bitmapSize, const size_t fullBlockCount, uint8_t *output)
+  {
+    const auto *blockData = &input[bitmapSize];
+
+    // Going over the differing blocks only, 64 bitmap entries at a time
+    for (size_t wordOffset = 0; wordOffset < bitmapSize; wordOffset += sizeof(uint64_t))
+      for (uint64_t bits = getBitmapWord(input, bitmapSize, wordOffset); bits != 0; bits &= bits - 1, blockData += blockSize)
+      {
+        const size_t blockIdx = wordOffset * 8 + __builtin_ctzll(bits);
+        if (blockIdx == fullBlockCount) return blockData;
+
+        const size_t offset = blockIdx * blockSize;
+        uint64_t     delta[blockSize / sizeof(uint64_t)];
+        uint64_t     outputWords[blockSize / sizeof(uint64_t)];
+        memcpy(delta, blockData, blockSize);
+        memcpy(outputWords, &output[offset], blockSize);
+        for (size_t i = 0; i < blockSize / sizeof(uint64_t); i++) outputWords[i] ^= delta[i];
+        memcpy(&output[offset], outputWords, blockSize);
+      }
+
+    return blockData;
+  }
+
+#ifdef __x86_64__
+
+  __attribute__((target("avx2"))) static size_t encodeBlocksAvx2(const uint8_t *input,
+                                                                  const uint8_t *reference,
+                                                                  const size_t   fullBlockCount,
+                                                                  uint8_t       *output,
+                                                                  const size_t   bitmapSize,
+                                                                  const size_t   outputCapacity)
+  {
+    return encodeBlocksAvx2From(0, input, reference, fullBlockCount, output, bitmapSize, outputCapacity);
+  }
+
+  __attribute__((target("avx2"))) static size_t encodeBlocksAvx2From(size_t         blockIdx,
+                                                                      const uint8_t *input,
+                                                                      const uint8_t *reference,
+                                                                      const size_t   fullBlockCount,
+                                                                      uint8_t       *output,
+                                                                      size_t         outputSize,
+                                                                      const size_t   outputCapacity)
+  {
+    for (; blockIdx < fullBlockCount; blockIdx++)
+    {
+      const size_t  offset = blockIdx * blockSize;
+      const __m256i delta  = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)&input[offset]), _mm256_loadu_si256((const __m256i *)&reference[offset]));
+      if (_mm256_testz_si256(delta, delta) != 0) continue;
+      if (outputSize + blockSize > outputCapacity) return 0;
+      _mm256_storeu_si256((__m256i *)&output[outputSize], delta);
+
+      output[blockIdx / 8] |= 1 << (blockIdx % 8);
+      outputSize += blockSize;
+    }
+
+    return outputSize;
+  }
+
+  __attribute__((target("avx512f,avx512bw"))) static size_t encodeBlocksAvx512(const uint8_t *input,
+                                                                                const uint8_t *reference,
+                                                                                const size_t   fullBlockCount,
+                                                                                uint8_t       *output,
+                                                                                const size_t   bitmapSize,
+                                                                                const size_t   outputCapacity)
+  {
+    size_t outputSize = bitmapSize;
+    size_t blockIdx   = 0;
+
+    // Testing two blocks at a time, each spanning four of the 64-bit lanes, and storing only the differing ones contiguously
+    for (; blockIdx + 2 <= fullBlockCount; blockIdx += 2)
+    {
+      const size_t  offset = blockIdx * blockSize;
+      const __m512i delta  = _mm512_xor_si512(_mm512_loadu_si512(&input[offset]), _mm512_loadu_si512(&reference[offset]));
+      const auto    mask   = _mm512_test_epi64_mask(delta, delta);
+      if (mask == 0) continue;
+
+      const bool     isFirstDifferent  = (mask & 0x0F) != 0;
+      const bool     isSecondDifferent = (mask & 0xF0) != 0;
+      const __mmask8 storeMask         = (isFirstDifferent ? 0x0F : 0x00) | (isSecondDifferent ? 0xF0 : 0x00);
+      const size_t   storeSize         = (isFirstDifferent + isSecondDifferent) * blockSize;
+      if (outputSize + storeSize > outputCapacity) return 0;
+
+      _mm512_mask_compressstoreu_epi64(&output[outputSize], storeMask, delta);
+      if (isFirstDifferent == true) output[blockIdx / 8] |= 1 << (blockIdx % 8);
+      if (isSecondDifferent == true) output[(blockIdx + 1) / 8] |= 1 << ((blockIdx + 1) % 8);
+      outputSize += storeSize;
+    }
+
+    // The odd block left, if any
+    return encodeBlocksAvx2From(blockIdx, input, reference, fullBlockCount, output, outputSize, outputCapacity);
+  }
+
+  __attribute__((target("avx2"))) static const uint8_t *decodeBlocksAvx2(const uint8_t *input, const size_t bitmapSize, const size_t fullBlockCount, uint8_t *output)
+  {
+    const auto *blockData = &input[bitmapSize];
+
+    // Going over the differing blocks only, 64 bitmap entries at a time
+    for (size_t wordOffset = 0; wordOffset < bitmapSize; wordOffset += sizeof(uint64_t))
+      for (uint64_t bits = getBitmapWord(input, bitmapSize, wordOffset); bits != 0; bits &= bits - 1, blockData += blockSize)
+      {
+        const size_t blockIdx = wordOffset * 8 + __builtin_ctzll(bits);
+        if (blockIdx == fullBlockCount) return blockData;
+
+        const size_t  offset = blockIdx * blockSize;
+        const __m256i delta  = _mm256_loadu_si256((const __m256i *)blockData);
+        _mm256_storeu_si256((__m256i *)&output[offset], _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)&output[offset]), delta));
+      }
+
+    return blockData;
+  }
+
+#endif
+};
+
+} // namespace stateDb
+
+} // namespace jaffarPlus
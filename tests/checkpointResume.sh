@@ -0,0 +1,42 @@
+#!/bin/bash
+
+# Checks that a search interrupted right after saving a checkpoint, and then resumed from it, ends the same way as an
+# uninterrupted search: at the same step, for the same reason, and with a solution of the same length
+#
+# Usage: checkpointResume.sh <path to jaffar> <script file> <step to interrupt at, where a checkpoint is due>
+
+set -e
+
+jaffarPath=${1}
+scriptFile=${2}
+interruptStep=${3}
+
+# Getting the checkpoint and best solution paths from the script
+checkpointPath=`grep -E '^\s*"Path"' ${scriptFile} | cut -d '"' -f 4`
+bestSolutionPath=`grep '"Best Solution Path"' ${scriptFile} | cut -d '"' -f 4`
+
+# Running on a single thread, so that both searches explore the states in the same order
+export OMP_NUM_THREADS=1
+export JAFFAR_OVERRIDE_RETURN_CODE=0
+
+# Running the uninterrupted search
+rm -rf ${checkpointPath} ${checkpointPath}.new ${checkpointPath}.old
+uninterruptedExit=`${jaffarPath} ${scriptFile} | grep "Exit Reason"`
+uninterruptedSolutionLength=`wc -l < ${bestSolutionPath}`
+cp ${bestSolutionPath} ${bestSolutionPath}.uninterrupted
+
+# Running the search up to the interrupt step, and resuming it from the checkpoint saved there
+rm -rf ${checkpointPath} ${checkpointPath}.new ${checkpointPath}.old
+JAFFAR_DRIVER_OVERRIDE_INTERRUPT_STEP=${interruptStep} ${jaffarPath} ${scriptFile} > /dev/null
+resumedExit=`${jaffarPath} ${scriptFile} --resume ${checkpointPath} | grep "Exit Reason"`
+resumedSolutionLength=`wc -l < ${bestSolutionPath}`
+
+echo "Uninterrupted: ${uninterruptedExit} (solution length ${uninterruptedSolutionLength})"
+echo "Resumed:       ${resumedExit} (solution length ${resumedSolutionLength})"
+
+if [ "${uninterruptedExit}" != "${resumedExit}" ] || [ ${uninterruptedSolutionLength} -ne ${resumedSolutionLength} ]; then
+  echo "The resumed search did not end as the uninterrupted one"
+  exit 1
+fi
+
+if ! cmp -s ${bestSolutionPath} ${bestSolutionPath}.uninterrupted; then echo "Note: the solutions differ in their inputs"; fi